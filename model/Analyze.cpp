@@ -0,0 +1,307 @@
+// analyze.out: summarizes the job-event logs written with --event-log.
+//
+// Every log is memory-mapped and its blocks are decoded by a pool of threads.
+// Each thread keeps its own summaries (histograms and counters, which merge
+// exactly), and they are merged once all blocks are read, so the results do
+// not depend on the number of threads.
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "EventLog.h"
+#include "Histogram.h"
+
+const int HOURS_PER_DAY{24};
+const double HOUR_SEC{3600.0};
+
+// The delays and rejections of a group of jobs
+struct DelaySummary {
+  long long jobs{0};
+  long long rejected{0};
+  double delaySum{0.0};    // of the accepted jobs
+  double serviceSum{0.0};  // of the accepted jobs
+  Histogram delays;        // of the accepted jobs
+
+  void add(const JobEvent& event) {
+    ++jobs;
+    if (event.rejected) {
+      ++rejected;
+      return;
+    }
+    delaySum += event.delay;
+    serviceSum += event.departure - event.arrival - event.delay;
+    delays.record(event.delay);
+  }
+
+  void merge(const DelaySummary& other) {
+    jobs += other.jobs;
+    rejected += other.rejected;
+    delaySum += other.delaySum;
+    serviceSum += other.serviceSum;
+    delays.merge(other.delays);
+  }
+};
+
+// The runs of consecutive rejections in a stretch of events.
+//
+// A stretch is summarized by the runs touching its ends (which may continue
+// into the next stretch) and the complete runs inside it, so the summaries
+// of consecutive blocks can be merged in order.
+struct RejectStreaks {
+  long long events{0};
+  long long prefix{0};   // the rejections the stretch starts with
+  long long suffix{0};   // the rejections the stretch ends with
+  long long longest{0};  // the longest run of rejections
+  long long bursts{0};   // the runs of at least minBurst touching neither end
+
+  bool isAllRejected() const { return events > 0 && prefix == events; }
+
+  void add(bool rejected, long long minBurst) {
+    RejectStreaks one;
+    one.events = 1;
+    one.prefix = one.suffix = one.longest = rejected ? 1 : 0;
+    merge(one, minBurst);
+  }
+
+  // append the stretch that follows this one
+  void merge(const RejectStreaks& next, long long minBurst) {
+    if (next.events == 0) return;
+    if (events == 0) {
+      *this = next;
+      return;
+    }
+
+    long long joined{suffix + next.prefix};
+    if (!isAllRejected() && !next.isAllRejected() && joined >= minBurst) {
+      ++bursts;
+    }
+    bursts += next.bursts;
+    longest = std::max({longest, next.longest, joined});
+    prefix = isAllRejected() ? events + next.prefix : prefix;
+    suffix = next.isAllRejected() ? next.events + suffix : next.suffix;
+    events += next.events;
+  }
+
+  // the number of runs of at least minBurst, once the stretch is complete
+  long long countBursts(long long minBurst) const {
+    if (isAllRejected()) return events >= minBurst ? 1 : 0;
+    return bursts + (prefix >= minBurst ? 1 : 0) + (suffix >= minBurst ? 1 : 0);
+  }
+};
+
+// The summaries of one run (model) of a log
+struct RunSummary {
+  std::vector<DelaySummary> nodes;      // by node
+  std::vector<DelaySummary> hours;      // by hour of the day
+  std::vector<long long> hourlyJobs;    // by hour since the start
+  std::vector<long long> hourlyRejects; // by hour since the start
+  RejectStreaks streaks;
+
+  RunSummary() : hours(HOURS_PER_DAY) {}
+
+  void add(const JobEvent& event) {
+    if (event.node >= static_cast<int>(nodes.size())) {
+      nodes.resize(event.node + 1);
+    }
+    nodes[event.node].add(event);
+
+    size_t hour{static_cast<size_t>(event.arrival / HOUR_SEC)};
+    hours[hour % HOURS_PER_DAY].add(event);
+    if (hour >= hourlyJobs.size()) {
+      hourlyJobs.resize(hour + 1, 0);
+      hourlyRejects.resize(hour + 1, 0);
+    }
+    ++hourlyJobs[hour];
+    if (event.rejected) ++hourlyRejects[hour];
+  }
+
+  // everything but the streaks, which have to be merged in block order
+  void merge(const RunSummary& other) {
+    if (other.nodes.size() > nodes.size()) nodes.resize(other.nodes.size());
+    for (size_t ii = 0; ii < other.nodes.size(); ii++) {
+      nodes[ii].merge(other.nodes[ii]);
+    }
+    for (int ii = 0; ii < HOURS_PER_DAY; ii++) hours[ii].merge(other.hours[ii]);
+    if (other.hourlyJobs.size() > hourlyJobs.size()) {
+      hourlyJobs.resize(other.hourlyJobs.size(), 0);
+      hourlyRejects.resize(other.hourlyJobs.size(), 0);
+    }
+    for (size_t ii = 0; ii < other.hourlyJobs.size(); ii++) {
+      hourlyJobs[ii] += other.hourlyJobs[ii];
+      hourlyRejects[ii] += other.hourlyRejects[ii];
+    }
+  }
+};
+
+// The summaries of a log, by run
+using LogSummary = std::vector<RunSummary>;
+
+/**
+ * @brief Summarize a log with a pool of threads
+ *
+ * @param log The log
+ * @param nThreads The number of threads decoding blocks
+ * @param minBurst The shortest run of rejections counted as a burst
+ * @param summary Filled with the summary of every run in the log
+ * @return true Every block was decoded
+ */
+bool analyzeLog(const EventLogReader& log, int nThreads, long long minBurst,
+                LogSummary& summary) {
+  const std::vector<EventBlockInfo>& blocks{log.getBlocks()};
+  std::vector<LogSummary> partials(nThreads);
+  std::vector<RejectStreaks> blockStreaks(blocks.size());
+  std::atomic<size_t> nextBlock{0};
+  std::atomic<bool> ok{true};
+
+  auto worker = [&](LogSummary& partial) {
+    std::vector<JobEvent> events;
+    for (size_t idx = nextBlock++; idx < blocks.size(); idx = nextBlock++) {
+      if (!log.readBlock(idx, events)) {
+        ok = false;
+        continue;
+      }
+      uint8_t run{blocks[idx].run};
+      if (run >= partial.size()) partial.resize(run + 1);
+      for (const JobEvent& event : events) {
+        partial[run].add(event);
+        blockStreaks[idx].add(event.rejected, minBurst);
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int ii = 1; ii < nThreads; ii++) {
+    threads.emplace_back(worker, std::ref(partials[ii]));
+  }
+  worker(partials[0]);
+  for (std::thread& thread : threads) thread.join();
+
+  // merge the threads' summaries, then the blocks' streaks in order
+  summary.clear();
+  for (const LogSummary& partial : partials) {
+    if (partial.size() > summary.size()) summary.resize(partial.size());
+    for (size_t run = 0; run < partial.size(); run++) {
+      summary[run].merge(partial[run]);
+    }
+  }
+  for (size_t idx = 0; idx < blocks.size(); idx++) {
+    uint8_t run{blocks[idx].run};
+    if (run >= summary.size()) summary.resize(run + 1);
+    summary[run].streaks.merge(blockStreaks[idx], minBurst);
+  }
+  return ok;
+}
+
+// the name of a run (the simulation tags runs with their Model)
+std::string runName(size_t run) {
+  if (run == 0) return "mqms";
+  if (run == 1) return "sqms";
+  return "run" + std::to_string(run);
+}
+
+// the policy a log was written with, from its header (the file's name if
+// the header has none)
+std::string policyName(const EventLogReader& log, const std::string& path) {
+  return log.getPolicy().empty() ? path : log.getPolicy();
+}
+
+// write the count, rejections, mean delay and service and delay percentiles
+void writeDelays(std::ostream& out, const DelaySummary& group) {
+  long long accepted{group.jobs - group.rejected};
+  out << group.jobs << "," << group.rejected << ","
+      << (accepted > 0 ? group.delaySum / accepted : 0.0) << ","
+      << (accepted > 0 ? group.serviceSum / accepted : 0.0) << ","
+      << group.delays.getPercentile(50.0) << ","
+      << group.delays.getPercentile(99.0) << ","
+      << group.delays.getPercentile(99.9) << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  std::string prefix{"events"};
+  int nThreads{static_cast<int>(std::thread::hardware_concurrency())};
+  long long minBurst{10};
+  std::vector<std::string> paths;
+
+  for (int ii = 1; ii < argc; ii++) {
+    std::string arg{argv[ii]};
+    bool hasValue{ii + 1 < argc};
+    if (arg == "--out" && hasValue) {
+      prefix = argv[++ii];
+    } else if (arg == "--threads" && hasValue) {
+      nThreads = atoi(argv[++ii]);
+    } else if (arg == "--burst" && hasValue) {
+      minBurst = atoll(argv[++ii]);
+    } else {
+      paths.push_back(arg);
+    }
+  }
+  nThreads = std::max(nThreads, 1);
+  minBurst = std::max(minBurst, 1LL);
+
+  if (paths.empty()) {
+    std::cout << "Usage: " << argv[0] << " [--out prefix] [--threads n] "
+              << "[--burst k] <log> [<log> ...]" << std::endl;
+    return 1;
+  }
+
+  std::ofstream nodes(prefix + "_nodes.csv");
+  std::ofstream hours(prefix + "_hours.csv");
+  std::ofstream timeline(prefix + "_timeline.csv");
+  std::ofstream bursts(prefix + "_bursts.csv");
+  const char* delayCols{"n_jobs,n_rej,avg_d,avg_s,p50_d,p99_d,p999_d"};
+  nodes << "policy,model,sid," << delayCols << std::endl;
+  hours << "policy,model,hour," << delayCols << std::endl;
+  timeline << "policy,model,hour,n_jobs,n_rej" << std::endl;
+  bursts << "policy,model,n_jobs,n_rej,n_bursts,longest" << std::endl;
+
+  int failures{0};
+  for (const std::string& path : paths) {
+    EventLogReader log(path);
+    if (!log.isOk()) {
+      std::cerr << "Could not read the event log " << path << std::endl;
+      ++failures;
+      continue;
+    }
+
+    LogSummary summary;
+    if (!analyzeLog(log, nThreads, minBurst, summary)) {
+      std::cerr << "Some blocks of " << path << " are corrupt, they were "
+                << "skipped" << std::endl;
+      ++failures;
+    }
+
+    std::string policy{policyName(log, path)};
+    for (size_t run = 0; run < summary.size(); run++) {
+      const RunSummary& result{summary[run]};
+      if (result.streaks.events == 0) continue;
+      std::string label{policy + "," + runName(run) + ","};
+
+      for (size_t sid = 0; sid < result.nodes.size(); sid++) {
+        if (result.nodes[sid].jobs == 0) continue;
+        nodes << label << sid << ",";
+        writeDelays(nodes, result.nodes[sid]);
+      }
+      for (int hour = 0; hour < HOURS_PER_DAY; hour++) {
+        hours << label << hour << ",";
+        writeDelays(hours, result.hours[hour]);
+      }
+      for (size_t hour = 0; hour < result.hourlyJobs.size(); hour++) {
+        timeline << label << hour << "," << result.hourlyJobs[hour] << ","
+                 << result.hourlyRejects[hour] << std::endl;
+      }
+
+      long long rejected{0};
+      for (long long count : result.hourlyRejects) rejected += count;
+      bursts << label << result.streaks.events << "," << rejected << ","
+             << result.streaks.countBursts(minBurst) << ","
+             << result.streaks.longest << std::endl;
+    }
+  }
+
+  return failures > 0;
+}
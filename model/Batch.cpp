@@ -0,0 +1,411 @@
+#include "Batch.h"
+
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "LoadBalancing.h"
+#include "Numa.h"
+#include "PerfCounters.h"
+#include "WallClock.h"
+#include "rngs.h"
+
+// A scenario of the input
+struct Scenario {
+  int nNodes;
+  std::string name;
+  lba_alg lba;
+  int qSize;
+  long long nJobs;
+  long seed;
+};
+
+// What a worker sends back after each scenario, followed by its rows
+struct ScenarioDone {
+  int32_t scenario;  // the scenario's index
+  int32_t worker;    // the worker that ran it
+  long long jobs;    // the jobs simulated (both models)
+  double seconds;    // the wall time it took
+  uint64_t bytes;    // the size of the rows that follow
+};
+
+/**
+ * @brief Write the rows of one model of a scenario
+ *
+ * @param out Where the rows are written to
+ * @param scenario The scenario's index
+ * @param line The scenario's settings, already formatted
+ * @param result The result of the model's run
+ */
+static void writeRows(std::ostream& out, int scenario, const std::string& line,
+                      const SimResult& result) {
+  std::string model{result.model == Model::mqms ? "mqms" : "sqms"};
+  double rejects{calcRejectRatio(result)};
+
+  for (const NodeStats& node : result.stats) {
+    out << scenario << "," << model << "," << line << "," << rejects << ","
+        << node.id << "," << node.util << "," << node.avgSt << ","
+        << node.avgQ << "," << node.avgD << "," << node.nJobs << ","
+        << node.sdSt << "," << node.avgW << "," << node.sdW << "," << node.sdD
+        << "," << node.pD50 << "," << node.pD99 << "," << node.pD999 << ","
+        << node.pW50 << "," << node.pW99 << "," << node.pW999 << "\n";
+  }
+}
+
+/**
+ * @brief Read a scenario from a line of the input
+ *
+ * @param line The line
+ * @param lineNum The line's number, for the error message
+ * @param scenario Set to the scenario
+ * @param errors Counts the invalid lines
+ * @return true The line holds a scenario; false if it's empty, a comment or
+ * invalid (which is reported)
+ */
+static bool parseScenario(const std::string& line, int lineNum,
+                          Scenario& scenario, int& errors) {
+  std::istringstream fields{line};
+  std::string first;
+  if (!(fields >> first) || first[0] == '#') return false;
+
+  // same order as the command line arguments
+  scenario.nNodes = atoi(first.c_str());
+  scenario.qSize = -1;
+  scenario.nJobs = -1;
+  scenario.seed = 123456789;
+  fields >> scenario.name >> scenario.qSize >> scenario.nJobs;
+  if (!(fields >> scenario.seed)) scenario.seed = 123456789;
+
+  scenario.lba = name_to_index(scenario.name);
+  if (scenario.nNodes <= 0 || scenario.lba < 0 || scenario.qSize < 0 ||
+      scenario.nJobs <= 0) {
+    std::cerr << "Skipping invalid scenario on line " << lineNum << ": "
+              << line << std::endl;
+    ++errors;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Make room for a scenario's node table before it's built
+ *
+ * A table that has to grow is allocated afresh and advised to use huge
+ * pages before its nodes are constructed, so they're backed from the first
+ * touch on.
+ *
+ * @param ws The workspace
+ * @param nNodes The nodes of the scenario
+ */
+static void reserveHugeNodes(SimWorkspace& ws, int nNodes) {
+  if (ws.nodes.capacity() >= static_cast<size_t>(nNodes)) return;
+  node_list fresh;
+  fresh.reserve(nNodes);
+  adviseHugePages(fresh.data(), fresh.capacity() * sizeof(ServiceNode));
+  ws.nodes.swap(fresh);
+}
+
+/**
+ * @brief Run both models of a scenario and write their rows
+ *
+ * @param scenario The scenario
+ * @param index The scenario's index
+ * @param ws The buffers to reuse
+ * @param opts The options for every simulation
+ * @param hugePages Back the node table with huge pages
+ * @param out Where the rows are written to
+ */
+static void runScenario(const Scenario& scenario, int index, SimWorkspace& ws,
+                        const SimOptions& opts, bool hugePages,
+                        std::ostream& out) {
+  if (hugePages) reserveHugeNodes(ws, scenario.nNodes);
+
+  // start from the same state as a fresh process
+  PutSeed(scenario.seed);
+  resetArrival();
+
+  std::ostringstream settings;
+  settings << scenario.name << "," << scenario.nNodes << "," << scenario.qSize
+           << "," << scenario.nJobs << "," << scenario.seed;
+
+  SimResult mqms{runModel(Model::mqms, scenario.nNodes, scenario.lba,
+                          scenario.qSize, scenario.nJobs, opts, &ws)};
+  perfEnter(PerfPhase::output);
+  writeRows(out, index, settings.str(), mqms);
+  SimResult sqms{runModel(Model::sqms, scenario.nNodes, scenario.lba,
+                          scenario.qSize, scenario.nJobs, opts, &ws)};
+  perfEnter(PerfPhase::output);
+  writeRows(out, index, settings.str(), sqms);
+  perfLeave();
+}
+
+// write all of a buffer to a pipe
+static bool writeAll(int fd, const void* data, size_t size) {
+  const char* bytes{static_cast<const char*>(data)};
+  while (size > 0) {
+    ssize_t n{write(fd, bytes, size)};
+    if (n <= 0) return false;
+    bytes += n;
+    size -= n;
+  }
+  return true;
+}
+
+/**
+ * @brief Run the scenarios handed out to one worker process, then exit
+ *
+ * @param worker The worker's index
+ * @param placement Where the worker runs
+ * @param cfg How the scenarios are spread over processes
+ * @param scenarios All the scenarios
+ * @param next The next scenario to hand out (shared by the workers)
+ * @param opts The options for every simulation
+ * @param fd The write end of the worker's pipe
+ */
+[[noreturn]] static void runWorker(int worker, const WorkerPlacement& placement,
+                                   const BatchWorkers& cfg,
+                                   const std::vector<Scenario>& scenarios,
+                                   std::atomic<size_t>& next,
+                                   const SimOptions& opts, int fd) {
+  if (cfg.pin && !pinToCpu(placement.cpu)) {
+    std::cerr << "Could not pin worker " << worker << " to CPU "
+              << placement.cpu << std::endl;
+  }
+
+  // built after pinning, so the first touch puts it on this worker's node
+  SimWorkspace ws;
+  std::ostringstream rows;
+  bool ok{true};
+  for (size_t idx = next++; ok && idx < scenarios.size(); idx = next++) {
+    rows.str("");
+    double start{wallTime()};
+    runScenario(scenarios[idx], idx, ws, opts, cfg.hugePages, rows);
+
+    std::string text{rows.str()};
+    ScenarioDone done{static_cast<int32_t>(idx), worker,
+                      2 * scenarios[idx].nJobs, wallTime() - start,
+                      text.size()};
+    ok = writeAll(fd, &done, sizeof(done)) &&
+         writeAll(fd, text.data(), text.size());
+  }
+  close(fd);
+
+  // leave without the exit handlers, which belong to the parent
+  _exit(ok ? 0 : 1);
+}
+
+// The throughput of the workers of one NUMA node
+struct SocketLoad {
+  int workers{0};
+  int scenarios{0};
+  long long jobs{0};
+  double busySeconds{0.0};
+};
+
+/**
+ * @brief Print the throughput of each NUMA node
+ *
+ * @param loads The loads by node
+ * @param seconds The wall time of the batch
+ */
+static void printSocketLoads(const std::map<int, SocketLoad>& loads,
+                             double seconds) {
+  std::cerr << std::setw(6) << "socket" << std::setw(9) << "workers"
+            << std::setw(11) << "scenarios" << std::setw(14) << "jobs"
+            << std::setw(14) << "jobs/s" << std::setw(16) << "jobs/s/worker"
+            << std::endl;
+  for (const auto& entry : loads) {
+    const SocketLoad& load{entry.second};
+    std::cerr << std::setw(6) << entry.first << std::setw(9) << load.workers
+              << std::setw(11) << load.scenarios << std::setw(14) << load.jobs
+              << std::setw(14) << std::fixed << std::setprecision(0)
+              << (seconds > 0.0 ? load.jobs / seconds : 0.0) << std::setw(16)
+              << (load.busySeconds > 0.0 ? load.jobs / load.busySeconds
+                                         : 0.0)
+              << std::defaultfloat << std::setprecision(6) << std::endl;
+  }
+}
+
+/**
+ * @brief Run the scenarios on a number of worker processes
+ *
+ * @param scenarios The scenarios
+ * @param out Where the results are written to, in the scenarios' order
+ * @param opts The options for every simulation
+ * @param cfg How the scenarios are spread over processes
+ * @return int The number of scenarios that were not finished
+ */
+static int runWorkers(const std::vector<Scenario>& scenarios,
+                      std::ostream& out, const SimOptions& opts,
+                      const BatchWorkers& cfg) {
+  std::vector<NumaNode> topology{readNumaTopology()};
+  std::vector<WorkerPlacement> placements{placeWorkers(topology, cfg.count)};
+
+  // the next scenario to hand out, in memory the workers share
+  void* shared{mmap(nullptr, sizeof(std::atomic<size_t>),
+                    PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1,
+                    0)};
+  if (shared == MAP_FAILED) {
+    std::cerr << "Could not map the workers' shared counter" << std::endl;
+    return scenarios.size();
+  }
+  std::atomic<size_t>* next{new (shared) std::atomic<size_t>{0}};
+
+  // anything still buffered would be written again by every child
+  out.flush();
+  std::cout.flush();
+  std::cerr.flush();
+  std::fflush(nullptr);
+
+  std::vector<pollfd> pipes;
+  std::vector<pid_t> pids;
+  for (int worker = 0; worker < cfg.count; worker++) {
+    int ends[2];
+    if (pipe(ends) != 0) {
+      std::cerr << "Could not create a pipe for worker " << worker
+                << std::endl;
+      continue;
+    }
+    pid_t pid{fork()};
+    if (pid == 0) {
+      close(ends[0]);
+      for (const pollfd& other : pipes) close(other.fd);
+      runWorker(worker, placements[worker], cfg, scenarios, *next, opts,
+                ends[1]);
+    }
+
+    close(ends[1]);
+    if (pid < 0) {
+      close(ends[0]);
+      std::cerr << "Could not fork worker " << worker << std::endl;
+      continue;
+    }
+    pipes.push_back(pollfd{ends[0], POLLIN, 0});
+    pids.push_back(pid);
+  }
+
+  // collect the rows, and write them out in order as they complete
+  double start{wallTime()};
+  std::vector<std::string> pending(pipes.size());
+  std::map<int, std::string> done;
+  std::map<int, SocketLoad> loads;
+  for (const WorkerPlacement& placement : placements) {
+    ++loads[placement.node].workers;
+  }
+  int nextOut{0};
+  size_t open{pipes.size()};
+  char buf[1 << 16];
+  while (open > 0) {
+    if (poll(pipes.data(), pipes.size(), -1) < 0) break;
+    for (size_t ii = 0; ii < pipes.size(); ii++) {
+      if (pipes[ii].fd < 0 || pipes[ii].revents == 0) continue;
+      ssize_t n{read(pipes[ii].fd, buf, sizeof(buf))};
+      if (n <= 0) {
+        close(pipes[ii].fd);
+        pipes[ii].fd = -1;
+        --open;
+        continue;
+      }
+
+      std::string& data{pending[ii]};
+      data.append(buf, n);
+      ScenarioDone msg;
+      while (data.size() >= sizeof(msg)) {
+        std::memcpy(&msg, data.data(), sizeof(msg));
+        if (data.size() < sizeof(msg) + msg.bytes) break;
+        done[msg.scenario] = data.substr(sizeof(msg), msg.bytes);
+        data.erase(0, sizeof(msg) + msg.bytes);
+
+        SocketLoad& load{loads[placements[msg.worker].node]};
+        ++load.scenarios;
+        load.jobs += msg.jobs;
+        load.busySeconds += msg.seconds;
+      }
+    }
+
+    for (auto found = done.find(nextOut); found != done.end();
+         found = done.find(nextOut)) {
+      out << found->second;
+      out.flush();
+      done.erase(found);
+      ++nextOut;
+    }
+  }
+  double seconds{wallTime() - start};
+
+  for (pid_t pid : pids) {
+    int status{0};
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      std::cerr << "A batch worker failed" << std::endl;
+    }
+  }
+  munmap(shared, sizeof(std::atomic<size_t>));
+
+  // a worker that died left a gap: the rows after it are still written, in
+  // order, and the scenarios missing are named by their index
+  std::vector<int> missing;
+  for (int idx = nextOut; idx < static_cast<int>(scenarios.size()); idx++) {
+    auto found = done.find(idx);
+    if (found == done.end()) {
+      missing.push_back(idx);
+      continue;
+    }
+    out << found->second;
+  }
+  out.flush();
+  if (!missing.empty()) {
+    std::cerr << missing.size() << " scenario(s) were not finished:";
+    for (int idx : missing) std::cerr << " " << idx;
+    std::cerr << std::endl;
+  }
+  printSocketLoads(loads, seconds);
+  return missing.size();
+}
+
+int runBatch(std::istream& in, std::ostream& out, const SimOptions& opts,
+             const BatchWorkers& workers) {
+  out << "scenario,model,alg,nodes,q_size,jobs,seed,reject_pct,"
+      << "sid,avg_x,avg_s,avg_q,avg_d,n_jobs,sd_s,avg_w,sd_w,sd_d,"
+      << "p50_d,p99_d,p999_d,p50_w,p99_w,p999_w" << std::endl;
+
+  int lineNum{0};
+  int errors{0};
+  std::string line;
+  Scenario scenario;
+
+  // the workers need every scenario up front
+  if (workers.count > 1) {
+    std::vector<Scenario> scenarios;
+    while (std::getline(in, line)) {
+      if (parseScenario(line, ++lineNum, scenario, errors)) {
+        scenarios.push_back(scenario);
+      }
+    }
+    return errors + runWorkers(scenarios, out, opts, workers);
+  }
+
+  // the buffers every scenario reuses
+  SimWorkspace ws;
+  int index{0};
+  while (std::getline(in, line)) {
+    if (!parseScenario(line, ++lineNum, scenario, errors)) continue;
+    runScenario(scenario, index, ws, opts, workers.hugePages, out);
+    out.flush();  // stream each scenario out as soon as it's done
+    ++index;
+  }
+
+  return errors;
+}
@@ -0,0 +1,48 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <istream>
+#include <ostream>
+
+#include "Simulation.h"
+
+// How runBatch() spreads the scenarios over worker processes
+struct BatchWorkers {
+  int count{1};           // the worker processes (1: run in this process)
+  bool pin{true};         // pin each worker to a CPU, spread over the NUMA
+                          // nodes
+  bool hugePages{false};  // back the node tables with transparent huge pages
+};
+
+/**
+ * @brief Run many scenarios in this process and stream out their results
+ *
+ * Every non-empty line of the input that doesn't start with '#' is one
+ * scenario, written like the command line arguments:
+ *
+ *   <nNodes> <lba_alg> <qSize> <nJobs> [seed]
+ *
+ * Each scenario runs the MQMS and then the SQMS simulation exactly as a
+ * separate run of main.out would, but the node tables and queues are reused
+ * from one scenario to the next and no per-run CSV files are written.
+ * Instead, one CSV row per node and model is written to 'out' (and flushed)
+ * as soon as the scenario finishes.
+ *
+ * With more than one worker, the scenarios are read first and handed out to
+ * forked worker processes as they become free (the engine's state is per
+ * process). Each worker is pinned to a CPU before it builds its node tables
+ * and queues, so they're allocated on its own NUMA node, and the rows are
+ * written in the order of the scenarios, as each next one is done. The
+ * throughput of each NUMA node is reported on stderr at the end.
+ *
+ * @param in The scenarios, one per line
+ * @param out Where the results are written to
+ * @param opts The options for every simulation
+ * @param workers How the scenarios are spread over processes
+ * @return int The number of lines that could not be parsed (plus the
+ * scenarios a worker failed to finish)
+ */
+int runBatch(std::istream& in, std::ostream& out, const SimOptions& opts,
+             const BatchWorkers& workers = BatchWorkers());
+
+#endif
@@ -0,0 +1,60 @@
+#include "Bench.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+
+// the most operations a calibration tries
+const long long MAX_CALIBRATED_OPS{1LL << 34};
+
+BenchSuite::BenchSuite(int reps, double minRepSec, const std::string& filter)
+    : reps{std::max(reps, 2)}, minRepNs{minRepSec * 1e9}, filter{filter} {}
+
+bool BenchSuite::isSelected(const std::string& name) const {
+  return filter.empty() || name.find(filter) != std::string::npos;
+}
+
+void BenchSuite::printHeader() const {
+  std::printf("%-28s %-22s %12s %12s %10s %7s %12s\n", "benchmark", "fixture",
+              "ops/rep", "ns/op", "sd", "cv %", "min ns/op");
+}
+
+void BenchSuite::run(const std::string& name, const std::string& param,
+                     const body_func& body, long long maxOps) {
+  if (!isSelected(name)) return;
+  long long limit{maxOps > 0 ? maxOps : MAX_CALIBRATED_OPS};
+
+  // find the operations that take at least the minimum time (the first
+  // calls also warm up the caches and the branch predictors)
+  long long ops{1};
+  while (ops < limit && body(ops) < minRepNs) {
+    ops = std::min(ops * 2, limit);
+  }
+
+  BenchStat stat{name, param, ops, RunningStat(),
+                 std::numeric_limits<double>::max()};
+  for (int rep = 0; rep < reps; rep++) {
+    double nsPerOp{body(ops) / ops};
+    stat.nsPerOp.add(nsPerOp);
+    stat.minNsPerOp = std::min(stat.minNsPerOp, nsPerOp);
+  }
+
+  double mean{stat.nsPerOp.getMean()};
+  double sd{stat.nsPerOp.getStdDev()};
+  std::printf("%-28s %-22s %12lld %12.2f %10.2f %7.2f %12.2f\n", name.c_str(),
+              param.c_str(), ops, mean, sd, mean > 0 ? 100.0 * sd / mean : 0.0,
+              stat.minNsPerOp);
+  std::fflush(stdout);
+  results.push_back(stat);
+}
+
+void BenchSuite::skip(const std::string& name, const std::string& param,
+                      const std::string& reason) {
+  if (!isSelected(name)) return;
+  std::printf("%-28s %-22s skipped: %s\n", name.c_str(), param.c_str(),
+              reason.c_str());
+}
+
+const std::vector<BenchStat>& BenchSuite::getResults() const {
+  return results;
+}
@@ -0,0 +1,100 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Stats.h"
+#include "WallClock.h"
+
+/**
+ * @brief Keep the compiler from optimizing a value (and its computation) away
+ *
+ * @param value The value a benchmark produced
+ */
+template <typename T>
+inline void benchKeep(const T& value) {
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+// The measurements of one benchmark
+struct BenchStat {
+  std::string name;     // what was measured
+  std::string param;    // the fixture's settings
+  long long opsPerRep;  // the operations timed in each repetition
+  RunningStat nsPerOp;  // over the repetitions
+  double minNsPerOp;    // the fastest repetition
+};
+
+// A self-contained benchmark harness.
+//
+// A benchmark is a body that performs a number of operations and returns the
+// nanoseconds spent in them (so it can leave its setup out of the timing).
+// The suite doubles the number of operations until one call takes at least
+// the minimum time, then times the repetitions and keeps the mean, variance
+// and minimum of the ns per operation.
+class BenchSuite {
+ public:
+  // a benchmark body: does 'ops' operations, returns the ns they took
+  using body_func = std::function<double(long long ops)>;
+
+  /**
+   * @brief Construct a new Bench Suite object
+   *
+   * @param reps The repetitions of each benchmark
+   * @param minRepSec The least time of a repetition, in seconds
+   * @param filter Only benchmarks whose name contains it are run
+   */
+  BenchSuite(int reps, double minRepSec, const std::string& filter);
+
+  /**
+   * @brief Check whether a benchmark passes the filter
+   *
+   * @param name The benchmark's name
+   * @return true It will run
+   */
+  bool isSelected(const std::string& name) const;
+
+  /**
+   * @brief Calibrate and time a benchmark, and print its line
+   *
+   * @param name The benchmark's name
+   * @param param The fixture's settings
+   * @param body The benchmark's body
+   * @param maxOps The most operations a repetition may need (0: no limit)
+   */
+  void run(const std::string& name, const std::string& param,
+           const body_func& body, long long maxOps = 0);
+
+  /**
+   * @brief Print a line for a benchmark that was left out
+   *
+   * @param name The benchmark's name
+   * @param param The fixture's settings
+   * @param reason Why it was left out
+   */
+  void skip(const std::string& name, const std::string& param,
+            const std::string& reason);
+
+  /**
+   * @brief Print the heading of the results
+   */
+  void printHeader() const;
+
+  /**
+   * @brief Get the measurements so far
+   *
+   * @return const std::vector<BenchStat>& One per benchmark that ran
+   */
+  const std::vector<BenchStat>& getResults() const;
+
+ private:
+  int reps;
+  double minRepNs;
+  std::string filter;
+  std::vector<BenchStat> results;
+};
+
+#endif
@@ -0,0 +1,688 @@
+// bench_e2e.out: end-to-end throughput of whole simulations (make bench-e2e).
+//
+// A fixed set of scenarios (cluster size x model x policy) is simulated from
+// a fixed seed. Each one reports jobs/s, events/s, its peak resident set and
+// a checksum of its statistics, and the whole set is written as JSON. Given
+// a baseline written by an earlier run, the throughput of every scenario is
+// compared against it and the run fails if one got slower than a threshold.
+//
+// A second set runs every policy on fleets of 10^3 to 10^6 nodes (see
+// Fleet.h) at the same load and jobs per node, and reports how each policy's
+// throughput changes as the fleet grows. Round-robin and random must stay
+// flat; the policies that keep a tournament tree may slow down by as much as
+// the tree deepens (see fleetTreeDepth()), plus one access to memory per job
+// (see runFleet()), which is measured, and no more. The run fails if a
+// policy misses its target by more than the threshold. Their throughput is
+// that of the jobs alone: building a fleet and summarizing its nodes grow
+// with it.
+//
+// --memcheck runs a cluster for 10^6 jobs, then ten times as many, and so on
+// up to a limit (10^10 for the whole test), and fails if the peak resident
+// set of a longer run is more than MEMCHECK_SLACK_KB above the first one's:
+// a run's memory must not depend on its length.
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Bench.h"
+#include "Fleet.h"
+#include "LoadBalancing.h"
+#include "Numa.h"
+#include "Simulation.h"
+#include "Stats.h"
+#include "rngs.h"
+
+// the seed of every scenario
+const long E2E_SEED{123456789};
+// the queue size of every scenario (the nodes' queue, or the dispatcher's)
+const size_t E2E_QUEUE{5};
+
+// A cluster size and the jobs simulated on it
+struct E2eSize {
+  std::string name;
+  int nNodes;
+  int nJobs;
+};
+
+// the jobs shrink as the clusters grow, so that every scenario takes a
+// similar time with the policies that look at every node
+const std::vector<E2eSize> E2E_SIZES{
+    {"small", 8, 1000000}, {"medium", 128, 200000}, {"huge", 2048, 20000}};
+
+// the fleets of the scaling scenarios, which all run the same jobs per node
+// at the same load (a fixed job count would fill a small fleet up and leave
+// a large one nearly empty), and as many fleets as make the same total
+const std::vector<int> E2E_FLEET_NODES{1000, 10000, 100000, 1000000};
+const int E2E_FLEET_JOBS_PER_NODE{8};
+const long long E2E_FLEET_JOBS{8000000};
+const double E2E_FLEET_LOAD{0.8};
+// the fewest repetitions of a fleet, whose scaling is checked against a
+// target: the mean of fewer is too noisy for the threshold
+const int E2E_FLEET_MIN_REPS{5};
+// the accesses the time of a miss is the mean of
+const long long E2E_MISS_STEPS{1 << 22};
+
+// the shortest run of the memory check, and the growth it tolerates
+const long long MEMCHECK_FIRST{1000000};
+const long MEMCHECK_SLACK_KB{1024};
+
+// The measurements of one scenario
+struct E2eResult {
+  std::string name;       // size/model/policy
+  int nNodes;
+  long long nJobs;
+  RunningStat seconds;    // the wall time of the repetitions
+  double bestJobsPerSec;  // of the fastest repetition (the least noisy)
+  double eventsPerSec;    // of the fastest repetition
+  long peakRssKb;
+  long long rejects;
+  std::string checksum;   // of the statistics (the same in every repetition)
+};
+
+// A scenario of a baseline file
+struct E2eBaseline {
+  double jobsPerSec;
+  std::string checksum;
+};
+
+// An FNV-1a hash of the bytes of some values
+struct Checksum {
+  uint64_t hash{14695981039346656037ULL};
+
+  void mix(const void* data, size_t size) {
+    const unsigned char* bytes{static_cast<const unsigned char*>(data)};
+    for (size_t ii = 0; ii < size; ii++) {
+      hash = (hash ^ bytes[ii]) * 1099511628211ULL;
+    }
+  }
+
+  std::string toHex() const {
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx",
+                  static_cast<unsigned long long>(hash));
+    return hex;
+  }
+};
+
+/**
+ * @brief Hash a run's statistics, so changed results can be told apart
+ *
+ * @param result The result of the run
+ * @return std::string The FNV-1a hash of the statistics, in hex
+ */
+static std::string checksumResult(const SimResult& result) {
+  Checksum checksum;
+  checksum.mix(&result.totalRejects, sizeof(result.totalRejects));
+  checksum.mix(&result.nJobs, sizeof(result.nJobs));
+  for (const NodeStats& stats : result.stats) {
+    checksum.mix(&stats.nJobs, sizeof(stats.nJobs));
+    for (double value : {stats.util, stats.avgSt, stats.avgQ, stats.avgD,
+                         stats.avgW, stats.pD99, stats.pW99}) {
+      checksum.mix(&value, sizeof(value));
+    }
+  }
+  return checksum.toHex();
+}
+
+/**
+ * @brief Add a fleet run's statistics to a hash
+ *
+ * @param checksum The hash
+ * @param result The result of the run
+ */
+static void mixFleet(Checksum& checksum, const FleetResult& result) {
+  checksum.mix(&result.rejects, sizeof(result.rejects));
+  for (const FleetSpread* spread :
+       {&result.util, &result.jobs, &result.avgDelay}) {
+    for (double value : {spread->stat.getMean(), spread->stat.getStdDev(),
+                         spread->min, spread->p50, spread->max}) {
+      checksum.mix(&value, sizeof(value));
+    }
+  }
+  double delay{result.delay.getMean()};
+  checksum.mix(&delay, sizeof(delay));
+}
+
+/**
+ * @brief Start measuring the peak resident set anew
+ *
+ * Linux resets the high-water mark of /proc/self/status on request; where
+ * it can't, the peak is the process's so far.
+ */
+static void resetPeakRss() {
+  std::ofstream clear{"/proc/self/clear_refs"};
+  if (clear) clear << "5" << std::flush;
+}
+
+/**
+ * @brief Get the peak resident set since resetPeakRss()
+ *
+ * @return long The peak in kB
+ */
+static long getPeakRss() {
+  std::ifstream status{"/proc/self/status"};
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmHWM:") == 0) return atol(line.c_str() + 6);
+  }
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+/**
+ * @brief Simulate a scenario a number of times
+ *
+ * @param size The cluster size
+ * @param model The model
+ * @param lba The policy
+ * @param reps The repetitions
+ * @return E2eResult The measurements
+ */
+static E2eResult runScenario(const E2eSize& size, Model model, lba_alg lba,
+                             int reps) {
+  E2eResult e2e;
+  e2e.name = size.name + "/" + (model == Model::mqms ? "mqms" : "sqms") +
+             "/" + LBA_NAMES[lba];
+  e2e.nNodes = size.nNodes;
+  e2e.nJobs = size.nJobs;
+  e2e.bestJobsPerSec = 0.0;
+  e2e.eventsPerSec = 0.0;
+
+  resetPeakRss();
+  SimOptions opts;
+  for (int rep = 0; rep < reps; rep++) {
+    // start from the same state as a fresh process
+    PutSeed(E2E_SEED);
+    resetArrival();
+
+    double start{wallTime()};
+    SimResult result{model == Model::mqms
+                         ? runMqms(size.nNodes, lba, E2E_QUEUE, size.nJobs,
+                                   opts)
+                         : runSqms(size.nNodes, lba, E2E_QUEUE, size.nJobs,
+                                   opts)};
+    double seconds{wallTime() - start};
+
+    // an arrival for every job and a departure for every job served
+    double events{2.0 * result.nJobs - result.totalRejects};
+    e2e.seconds.add(seconds);
+    if (result.nJobs / seconds > e2e.bestJobsPerSec) {
+      e2e.bestJobsPerSec = result.nJobs / seconds;
+      e2e.eventsPerSec = events / seconds;
+    }
+    e2e.rejects = result.totalRejects;
+    e2e.checksum = checksumResult(result);
+  }
+  e2e.peakRssKb = getPeakRss();
+  return e2e;
+}
+
+/**
+ * @brief Start the measurements of a fleet scenario
+ *
+ * Every repetition runs E2E_FLEET_JOBS jobs through fresh fleets of the
+ * size, E2E_FLEET_JOBS_PER_NODE jobs per node each.
+ *
+ * @param nNodes The size of the fleets
+ * @param lba The policy
+ * @return E2eResult The scenario, without any repetition
+ */
+static E2eResult startFleetScenario(int nNodes, lba_alg lba) {
+  E2eResult e2e;
+  e2e.name = "fleet/" + std::to_string(nNodes) + "/" + LBA_NAMES[lba];
+  e2e.nNodes = nNodes;
+  long long fleetJobs{static_cast<long long>(E2E_FLEET_JOBS_PER_NODE) *
+                      nNodes};
+  e2e.nJobs = std::max(E2E_FLEET_JOBS / fleetJobs, 1LL) * fleetJobs;
+  e2e.bestJobsPerSec = 0.0;
+  e2e.eventsPerSec = 0.0;
+  e2e.peakRssKb = 0;
+  return e2e;
+}
+
+/**
+ * @brief Simulate one more repetition of a fleet scenario
+ *
+ * @param e2e The scenario, which takes the measurements
+ * @param lba The policy
+ */
+static void runFleetRep(E2eResult& e2e, lba_alg lba) {
+  long long fleetJobs{static_cast<long long>(E2E_FLEET_JOBS_PER_NODE) *
+                      e2e.nNodes};
+  PutSeed(E2E_SEED);
+  resetPeakRss();
+
+  double seconds{0.0};
+  long long rejects{0};
+  Checksum checksum;
+  for (long long jobs = 0; jobs < e2e.nJobs; jobs += fleetJobs) {
+    resetArrival();
+    setArrivalRate(loadToRate(e2e.nNodes, E2E_FLEET_LOAD));
+
+    FleetResult result{runFleet(e2e.nNodes, lba, E2E_QUEUE, fleetJobs)};
+    seconds += result.loopSeconds;
+    rejects += result.rejects;
+    mixFleet(checksum, result);
+  }
+
+  double events{2.0 * e2e.nJobs - rejects};
+  e2e.seconds.add(seconds);
+  if (e2e.nJobs / seconds > e2e.bestJobsPerSec) {
+    e2e.bestJobsPerSec = e2e.nJobs / seconds;
+    e2e.eventsPerSec = events / seconds;
+  }
+  e2e.peakRssKb = std::max(e2e.peakRssKb, getPeakRss());
+  e2e.rejects = rejects;
+  e2e.checksum = checksum.toHex();
+}
+
+/**
+ * @brief Check that the memory of a run doesn't grow with its length
+ *
+ * Runs both models of the small cluster, with the warm-up detection on, for
+ * MEMCHECK_FIRST jobs and every tenfold of it up to maxJobs.
+ *
+ * @param maxJobs The length of the longest run
+ * @return int The number of runs whose peak grew past the slack
+ */
+static int runMemcheck(long long maxJobs) {
+  const E2eSize& size{E2E_SIZES[0]};
+  SimOptions opts;
+  opts.detectWarmup = true;
+
+  std::printf("%-12s %14s %14s %10s %10s  %s\n", "memcheck", "jobs",
+              "jobs/s", "rss kB", "growth kB", "verdict");
+  int failures{0};
+  for (Model model : {Model::mqms, Model::sqms}) {
+    long firstRssKb{0};
+    for (long long nJobs = MEMCHECK_FIRST; nJobs <= maxJobs; nJobs *= 10) {
+      PutSeed(E2E_SEED);
+      resetArrival();
+      resetPeakRss();
+
+      double start{wallTime()};
+      SimResult result{model == Model::mqms
+                           ? runMqms(size.nNodes, 0, E2E_QUEUE, nJobs, opts)
+                           : runSqms(size.nNodes, 0, E2E_QUEUE, nJobs, opts)};
+      double seconds{wallTime() - start};
+
+      long rssKb{getPeakRss()};
+      if (nJobs == MEMCHECK_FIRST) firstRssKb = rssKb;
+      long growthKb{rssKb - firstRssKb};
+      bool isFlat{growthKb <= MEMCHECK_SLACK_KB};
+      if (!isFlat) ++failures;
+      std::printf("%-12s %14lld %14.0f %10ld %10ld  %s\n",
+                  model == Model::mqms ? "mqms" : "sqms",
+                  result.nJobs + result.resetJob, nJobs / seconds, rssKb,
+                  growthKb, isFlat ? "ok" : "GREW");
+      std::fflush(stdout);
+    }
+  }
+  return failures;
+}
+
+/**
+ * @brief Print a scenario's measurements as a line of the table
+ *
+ * @param e2e The measurements
+ */
+static void printResult(const E2eResult& e2e) {
+  double mean{e2e.seconds.getMean()};
+  std::printf("%-28s %8d %10lld %14.0f %14.0f %10ld %8.2f  %s\n",
+              e2e.name.c_str(), e2e.nNodes, e2e.nJobs, e2e.bestJobsPerSec,
+              e2e.eventsPerSec, e2e.peakRssKb,
+              mean > 0 ? 100.0 * e2e.seconds.getStdDev() / mean : 0.0,
+              e2e.checksum.c_str());
+  std::fflush(stdout);
+}
+
+/**
+ * @brief Measure how long a job waits for a node of a fleet that isn't in
+ * the cache
+ *
+ * Walks a random cycle through the cache lines of an array as large as the
+ * fleet's nodes, on huge pages as those, every access waiting for the one
+ * before, as the job of a tree policy waits for the node the previous job's
+ * update picked.
+ *
+ * @param nNodes The size of the fleet
+ * @return double The seconds per access
+ */
+static double measureNodeMiss(int nNodes) {
+  const size_t lineWords{64 / sizeof(uint64_t)};
+  size_t lines{(nNodes * sizeof(FleetNode) + 63) / 64};
+  std::vector<uint64_t> words;
+  words.reserve(lines * lineWords);
+  adviseHugePages(words.data(), words.capacity() * sizeof(uint64_t));
+  words.assign(lines * lineWords, 0);
+
+  // Sattolo's shuffle, which leaves a single cycle, from a fixed LCG
+  std::vector<uint64_t> next(lines);
+  for (size_t line = 0; line < lines; line++) next[line] = line;
+  uint64_t state{E2E_SEED};
+  for (size_t line = lines - 1; line > 0; line--) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    std::swap(next[line], next[(state >> 33) % line]);
+  }
+  for (size_t line = 0; line < lines; line++) {
+    words[line * lineWords] = next[line] * lineWords;
+  }
+
+  uint64_t at{0};
+  double start{wallTime()};
+  for (long long step = 0; step < E2E_MISS_STEPS; step++) at = words[at];
+  double seconds{wallTime() - start};
+  volatile uint64_t last{at};  // so that the walk isn't optimized out
+  (void)last;
+  return seconds / E2E_MISS_STEPS;
+}
+
+/**
+ * @brief Report how the throughput of each policy changes with the fleet size
+ *
+ * The target of a policy is the throughput of the largest fleet relative to
+ * the smallest one's: 1 for those that take O(1) per job. The others' time
+ * per job may grow by the ratio of the depths of their trees, plus the time
+ * of one access to the largest fleet's nodes that misses the cache
+ * (measureNodeMiss()). The throughputs compared are those of the mean
+ * repetition: the repetitions of the sizes are interleaved, so a lucky one
+ * of a single size would skew a ratio of the fastest ones.
+ *
+ * @param results The measurements, including the fleet scenarios
+ * @param threshold How far below its target a policy may end up, in percent
+ * @return int The number of policies that missed their target
+ */
+static int printFleetScaling(const std::vector<E2eResult>& results,
+                             double threshold) {
+  bool isHeaderPrinted{false};
+  int misses{0};
+  for (lba_alg lba = 0; lba < static_cast<lba_alg>(LBA_NAMES.size()); lba++) {
+    const std::string& policy{LBA_NAMES[lba]};
+    // the throughput of the smallest and the largest fleet that were run
+    const E2eResult* smallest{nullptr};
+    const E2eResult* largest{nullptr};
+    for (const E2eResult& e2e : results) {
+      if (e2e.name.compare(0, 6, "fleet/") != 0 ||
+          e2e.name.substr(e2e.name.rfind('/') + 1) != policy) {
+        continue;
+      }
+      if (!smallest || e2e.nNodes < smallest->nNodes) smallest = &e2e;
+      if (!largest || e2e.nNodes > largest->nNodes) largest = &e2e;
+    }
+    if (!smallest || smallest == largest) continue;
+
+    if (!isHeaderPrinted) {
+      std::printf("\n%-12s %10s %14s %10s %14s %9s %9s %9s\n",
+                  "fleet policy", "nodes", "jobs/s", "nodes", "jobs/s",
+                  "miss ns", "ratio", "target");
+      isHeaderPrinted = true;
+    }
+    double smallRate{smallest->nJobs / smallest->seconds.getMean()};
+    double largeRate{largest->nJobs / largest->seconds.getMean()};
+    double ratio{largeRate / smallRate};
+    int smallDepth{fleetTreeDepth(smallest->nNodes, lba)};
+    int largeDepth{fleetTreeDepth(largest->nNodes, lba)};
+    double miss{0.0};
+    double target{1.0};
+    if (largeDepth > 0) {
+      miss = measureNodeMiss(largest->nNodes);
+      double smallTime{1.0 / smallRate};
+      double largeTime{smallTime * largeDepth / std::max(smallDepth, 1) +
+                       miss};
+      target = smallTime / largeTime;
+    }
+    bool isMissed{ratio < target * (1.0 - threshold / 100.0)};
+    if (isMissed) ++misses;
+    std::printf("%-12s %10d %14.0f %10d %14.0f %9.1f %9.2f %9.2f%s\n",
+                policy.c_str(), smallest->nNodes, smallRate, largest->nNodes,
+                largeRate, miss * 1e9, ratio, target,
+                isMissed ? "  MISSED" : "");
+  }
+  return misses;
+}
+
+/**
+ * @brief Write the measurements as JSON, one scenario per line
+ *
+ * @param path The file to write
+ * @param results The measurements
+ * @param reps The repetitions of each scenario (at least E2E_FLEET_MIN_REPS
+ * for the fleets)
+ * @return true The file was written
+ */
+static bool writeJson(const std::string& path,
+                      const std::vector<E2eResult>& results, int reps) {
+  std::ofstream out{path};
+  out << "{\n  \"sim_version\": \"" << SIM_VERSION << "\",\n"
+      << "  \"reps\": " << reps << ",\n  \"scenarios\": [\n";
+  char line[512];
+  for (size_t ii = 0; ii < results.size(); ii++) {
+    const E2eResult& e2e{results[ii]};
+    std::snprintf(line, sizeof(line),
+                  "    {\"name\": \"%s\", \"nodes\": %d, \"jobs\": %lld, "
+                  "\"seconds\": %.6f, \"seconds_sd\": %.6f, "
+                  "\"jobs_per_sec\": %.1f, \"events_per_sec\": %.1f, "
+                  "\"peak_rss_kb\": %ld, \"rejects\": %lld, "
+                  "\"checksum\": \"%s\"}%s\n",
+                  e2e.name.c_str(), e2e.nNodes, e2e.nJobs,
+                  e2e.seconds.getMean(), e2e.seconds.getStdDev(),
+                  e2e.bestJobsPerSec, e2e.eventsPerSec, e2e.peakRssKb,
+                  e2e.rejects, e2e.checksum.c_str(),
+                  ii + 1 < results.size() ? "," : "");
+    out << line;
+  }
+  out << "  ]\n}\n";
+  return static_cast<bool>(out);
+}
+
+/**
+ * @brief Find the value of a key in a line of JSON written by writeJson()
+ *
+ * @param line The line
+ * @param key The key
+ * @return std::string The value without its quotes (empty if there's none)
+ */
+static std::string findJsonValue(const std::string& line,
+                                 const std::string& key) {
+  size_t at{line.find("\"" + key + "\":")};
+  if (at == std::string::npos) return "";
+  at = line.find_first_not_of(' ', at + key.size() + 3);
+  if (at == std::string::npos) return "";
+  if (line[at] == '"') {
+    size_t end{line.find('"', at + 1)};
+    return end == std::string::npos ? "" : line.substr(at + 1, end - at - 1);
+  }
+  size_t end{line.find_first_of(",}", at)};
+  return line.substr(at, end == std::string::npos ? end : end - at);
+}
+
+/**
+ * @brief Read a baseline written by writeJson()
+ *
+ * @param path The baseline file
+ * @param simVersion Set to the SIM_VERSION the baseline was made with
+ * @param baseline Filled with the scenarios by name
+ * @return true The file could be read
+ */
+static bool readBaseline(const std::string& path, std::string& simVersion,
+                         std::map<std::string, E2eBaseline>& baseline) {
+  std::ifstream in{path};
+  if (!in) return false;
+
+  std::string line;
+  while (std::getline(in, line)) {
+    std::string version{findJsonValue(line, "sim_version")};
+    if (!version.empty()) simVersion = version;
+    std::string name{findJsonValue(line, "name")};
+    if (name.empty()) continue;
+    baseline[name] = E2eBaseline{atof(findJsonValue(line, "jobs_per_sec")
+                                          .c_str()),
+                                 findJsonValue(line, "checksum")};
+  }
+  return true;
+}
+
+/**
+ * @brief Compare the measurements with a baseline and report the changes
+ *
+ * A scenario regresses when its throughput dropped by more than the
+ * threshold, or when its statistics changed although SIM_VERSION didn't.
+ *
+ * @param results The measurements
+ * @param path The baseline file
+ * @param threshold The tolerated drop in throughput, in percent
+ * @return int The number of regressions (-1 if the baseline can't be read)
+ */
+static int compareBaseline(const std::vector<E2eResult>& results,
+                           const std::string& path, double threshold) {
+  std::string simVersion;
+  std::map<std::string, E2eBaseline> baseline;
+  if (!readBaseline(path, simVersion, baseline)) return -1;
+  bool isSameVersion{simVersion == SIM_VERSION};
+
+  std::printf("\n%-28s %14s %14s %9s  %s\n", "scenario",
+              "base jobs/s", "jobs/s", "change %", "verdict");
+  int regressions{0};
+  for (const E2eResult& e2e : results) {
+    auto found = baseline.find(e2e.name);
+    if (found == baseline.end()) {
+      std::printf("%-28s %14s %14.0f %9s  new\n", e2e.name.c_str(), "-",
+                  e2e.bestJobsPerSec, "-");
+      continue;
+    }
+
+    const E2eBaseline& base{found->second};
+    double change{base.jobsPerSec > 0
+                      ? 100.0 * (e2e.bestJobsPerSec / base.jobsPerSec - 1)
+                      : 0.0};
+    std::string verdict{"ok"};
+    if (change < -threshold) {
+      verdict = "REGRESSION";
+      ++regressions;
+    }
+    if (base.checksum != e2e.checksum) {
+      if (isSameVersion) {
+        verdict += ", RESULTS CHANGED";
+        ++regressions;
+      } else {
+        verdict += ", results changed (new SIM_VERSION)";
+      }
+    }
+    std::printf("%-28s %14.0f %14.0f %9.1f  %s\n", e2e.name.c_str(),
+                base.jobsPerSec, e2e.bestJobsPerSec, change, verdict.c_str());
+  }
+  return regressions;
+}
+
+int main(int argc, char* argv[]) {
+  int reps{3};
+  std::string filter;
+  std::string outFile{"bench_e2e.json"};
+  std::string baselineFile;
+  double threshold{10.0};
+  long long memcheckJobs{0};
+
+  for (int ii = 1; ii < argc; ii++) {
+    std::string arg{argv[ii]};
+    bool hasValue{ii + 1 < argc};
+    if (arg == "--reps" && hasValue) {
+      reps = std::max(atoi(argv[++ii]), 1);
+    } else if (arg == "--filter" && hasValue) {
+      filter = argv[++ii];
+    } else if (arg == "--out" && hasValue) {
+      outFile = argv[++ii];
+    } else if (arg == "--baseline" && hasValue) {
+      baselineFile = argv[++ii];
+    } else if (arg == "--threshold" && hasValue) {
+      threshold = atof(argv[++ii]);
+    } else if (arg == "--memcheck" && hasValue) {
+      // as a double, so 1e10 can be given
+      memcheckJobs = static_cast<long long>(atof(argv[++ii]));
+    } else {
+      std::cout << "Usage: " << argv[0] << " [--reps n] [--filter text] "
+                << "[--out file.json] [--baseline file.json] "
+                << "[--threshold percent]" << std::endl;
+      std::cout << "       " << argv[0] << " --memcheck maxJobs" << std::endl;
+      return 1;
+    }
+  }
+
+  if (memcheckJobs > 0) {
+    int failures{runMemcheck(memcheckJobs)};
+    std::printf("%d run(s) grew more than %ld kB\n", failures,
+                MEMCHECK_SLACK_KB);
+    return failures > 0 ? 2 : 0;
+  }
+
+  std::printf("%-28s %8s %10s %14s %14s %10s %8s  %s\n", "scenario", "nodes",
+              "jobs", "jobs/s", "events/s", "rss kB", "cv %", "checksum");
+  std::vector<E2eResult> results;
+  for (const E2eSize& size : E2E_SIZES) {
+    for (Model model : {Model::mqms, Model::sqms}) {
+      for (lba_alg lba = 0; lba < static_cast<lba_alg>(LBA_NAMES.size());
+           lba++) {
+        std::string name{size.name + "/" +
+                         (model == Model::mqms ? "mqms" : "sqms") + "/" +
+                         LBA_NAMES[lba]};
+        if (!filter.empty() && name.find(filter) == std::string::npos) {
+          continue;
+        }
+
+        E2eResult e2e{runScenario(size, model, lba, reps)};
+        printResult(e2e);
+        results.push_back(e2e);
+      }
+    }
+  }
+  for (lba_alg lba = 0; lba < static_cast<lba_alg>(LBA_NAMES.size()); lba++) {
+    std::vector<E2eResult> fleets;
+    for (int nNodes : E2E_FLEET_NODES) {
+      std::string name{"fleet/" + std::to_string(nNodes) + "/" +
+                       LBA_NAMES[lba]};
+      if (!filter.empty() && name.find(filter) == std::string::npos) continue;
+      fleets.push_back(startFleetScenario(nNodes, lba));
+    }
+
+    // the sizes take turns, so that a machine that speeds up or slows down
+    // during the run doesn't favour one of them
+    for (int rep = 0; rep < std::max(reps, E2E_FLEET_MIN_REPS); rep++) {
+      for (E2eResult& e2e : fleets) runFleetRep(e2e, lba);
+    }
+    for (const E2eResult& e2e : fleets) {
+      printResult(e2e);
+      results.push_back(e2e);
+    }
+  }
+  int misses{printFleetScaling(results, threshold)};
+
+  if (!writeJson(outFile, results, reps)) {
+    std::cerr << "Could not write " << outFile << std::endl;
+    return 1;
+  }
+  std::cout << "Wrote " << outFile << std::endl;
+
+  if (misses > 0) {
+    std::printf("%d fleet policy(ies) missed the scaling target "
+                "(threshold %.1f%%)\n",
+                misses, threshold);
+  }
+  if (baselineFile.empty()) return misses > 0 ? 2 : 0;
+  int regressions{compareBaseline(results, baselineFile, threshold)};
+  if (regressions < 0) {
+    std::cerr << "Could not read the baseline " << baselineFile << std::endl;
+    return 1;
+  }
+  std::printf("%d regression(s) against %s (threshold %.1f%%)\n", regressions,
+              baselineFile.c_str(), threshold);
+  return regressions > 0 || misses > 0 ? 2 : 0;
+}
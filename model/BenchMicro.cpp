@@ -0,0 +1,311 @@
+// bench_micro.out: microbenchmarks of the policies, the node operations, the
+// process calendar and the random number generators (make bench).
+//
+// Every fixture is built from a fixed seed with buildNodeList(), so two runs
+// (or two builds) time exactly the same work.
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "Bench.h"
+#include "Job.h"
+#include "LoadBalancing.h"
+#include "Node.h"
+#include "Process.h"
+#include "Simulation.h"
+#include "rngs.h"
+#include "rvgs.h"
+
+// the seed of every fixture
+const long BENCH_SEED{20240101};
+// the queue size of the nodes the policies choose from
+const size_t POLICY_QUEUE{5};
+// the jobs per node the policies' fixture is loaded with, and its load
+const int LOAD_JOBS_PER_NODE{4};
+const double POLICY_LOAD{0.8};
+// the queue sizes the node operations are timed at
+const std::vector<size_t> QUEUE_DEPTHS{0, 1, 4, 16, 64, 256};
+// the load of the node operations' fixture (above 1, so queues fill up)
+const double NODE_LOAD{2.0};
+// the jobs generated at a time for enterNode() (the generation isn't timed)
+const long long JOB_CHUNK{4096};
+// the nodes drained at a time for processQueue()
+const long long DRAIN_NODES{256};
+// the events pending on the calendars
+const std::vector<int> CALENDAR_DEPTHS{16, 1024, 65536};
+
+/**
+ * @brief Build a node table loaded with jobs, the same on every call
+ *
+ * @param nNodes The number of nodes
+ * @return node_list The nodes, after LOAD_JOBS_PER_NODE jobs each
+ */
+static node_list buildLoadedNodes(int nNodes) {
+  PutSeed(BENCH_SEED);
+  node_list nodes{buildNodeList(nNodes, POLICY_QUEUE)};
+
+  double t{START};
+  double gap{SERVICE_MEAN / (POLICY_LOAD * nNodes)};
+  for (long long ii = 0; ii < static_cast<long long>(nNodes) *
+                                  LOAD_JOBS_PER_NODE; ii++) {
+    t += Exponential(gap);
+    Job job{t};
+    nodes[ii % nNodes].enterNode(job);
+  }
+  return nodes;
+}
+
+/**
+ * @brief Time the choices of one policy on a loaded node table
+ *
+ * The policies take the arrival time and draw the probe job's service time,
+ * as they do in the run loops.
+ *
+ * @tparam Policy The policy's class
+ * @param suite The benchmark suite
+ * @param name The policy's name in LBA_NAMES
+ * @param param The benchmark's parameter
+ * @param nodes The loaded node table
+ * @param now The arrival time of the jobs placed
+ */
+template <typename Policy>
+static void benchPolicy(BenchSuite& suite, const std::string& name,
+                        const std::string& param, const node_list& nodes,
+                        double now) {
+  Policy policy;
+  PutSeed(BENCH_SEED);
+  suite.run("lba::" + name, param, [&](long long ops) {
+    double start{wallTime()};
+    for (long long ii = 0; ii < ops; ii++) {
+      int chosen{policy.pick(nodes, now)};
+      benchKeep(chosen);
+    }
+    return (wallTime() - start) * 1e9;
+  });
+}
+
+/**
+ * @brief Time every policy, with the node count known at compile time or not
+ *
+ * @tparam NODES The node count compiled in (0: taken from the table)
+ * @param suite The benchmark suite
+ * @param param The benchmark's parameter
+ * @param nodes The loaded node table (NODES long, if NODES > 0)
+ * @param now The arrival time of the jobs placed
+ */
+template <int NODES>
+static void benchPolicyClasses(BenchSuite& suite, const std::string& param,
+                               const node_list& nodes, double now) {
+  benchPolicy<lba::RoundRobin<NODES>>(suite, LBA_NAMES[0], param, nodes, now);
+  benchPolicy<lba::Random<NODES>>(suite, LBA_NAMES[1], param, nodes, now);
+  benchPolicy<lba::UtilizationBased<NODES>>(suite, LBA_NAMES[2], param, nodes,
+                                            now);
+  benchPolicy<lba::LeastConnections<NODES>>(suite, LBA_NAMES[3], param, nodes,
+                                            now);
+}
+
+static void benchPolicies(BenchSuite& suite, int maxNodes, double maxMb) {
+  for (long long nNodes = 4; nNodes <= maxNodes; nNodes *= 4) {
+    std::string param{"nodes=" + std::to_string(nNodes)};
+
+    bool isWanted{false};
+    for (const std::string& name : LBA_NAMES) {
+      isWanted = isWanted || suite.isSelected("lba::" + name);
+    }
+    if (!isWanted) continue;
+
+    double mb{nNodes * sizeof(ServiceNode) / (1024.0 * 1024.0)};
+    if (mb > maxMb) {
+      for (const std::string& name : LBA_NAMES) {
+        suite.skip("lba::" + name, param,
+                   "the node table needs " + std::to_string(int(mb)) +
+                       " MB (--max-mb)");
+      }
+      continue;
+    }
+
+    node_list nodes{buildLoadedNodes(nNodes)};
+    double now{nodes.size() * LOAD_JOBS_PER_NODE * SERVICE_MEAN /
+               (POLICY_LOAD * nodes.size())};
+    benchPolicyClasses<0>(suite, param, nodes, now);
+
+    // the small clusters the run loops are also compiled for
+    if (nNodes == 4) benchPolicyClasses<4>(suite, param + ",fixed", nodes, now);
+    if (nNodes == 16) {
+      benchPolicyClasses<16>(suite, param + ",fixed", nodes, now);
+    }
+  }
+}
+
+static void benchEnterNode(BenchSuite& suite) {
+  for (size_t depth : QUEUE_DEPTHS) {
+    std::string param{"queue=" + std::to_string(depth)};
+    PutSeed(BENCH_SEED);
+    node_list nodes{buildNodeList(1, depth)};
+    ServiceNode& node{nodes[0]};
+    double t{START};
+
+    // an overloaded node, so the queue stays close to full
+    std::vector<Job> jobs(JOB_CHUNK);
+    suite.run("ServiceNode::enterNode", param, [&](long long ops) {
+      double elapsed{0.0};
+      for (long long done = 0; done < ops; done += JOB_CHUNK) {
+        long long n{std::min(JOB_CHUNK, ops - done)};
+        for (long long ii = 0; ii < n; ii++) {
+          t += Exponential(SERVICE_MEAN / NODE_LOAD);
+          jobs[ii] = Job{t};
+        }
+
+        double start{wallTime()};
+        for (long long ii = 0; ii < n; ii++) {
+          bool isEntered{node.enterNode(jobs[ii])};
+          benchKeep(isEntered);
+        }
+        elapsed += (wallTime() - start) * 1e9;
+      }
+      return elapsed;
+    });
+  }
+}
+
+static void benchProcessQueue(BenchSuite& suite) {
+  for (size_t depth : QUEUE_DEPTHS) {
+    if (depth == 0) continue;  // nodes without a queue never process one
+    std::string param{"drain=" + std::to_string(depth)};
+    PutSeed(BENCH_SEED);
+    node_list nodes{buildNodeList(DRAIN_NODES, depth)};
+
+    // every op drains a full queue: the jobs all arrive at once, and the
+    // queue is processed once they have all left
+    suite.run("ServiceNode::processQueue", param, [&](long long ops) {
+      double elapsed{0.0};
+      for (long long done = 0; done < ops; done += DRAIN_NODES) {
+        long long n{std::min(DRAIN_NODES, ops - done)};
+        for (long long ii = 0; ii < n; ii++) {
+          nodes[ii].reset(ii, depth);
+          for (size_t jj = 0; jj <= depth; jj++) {
+            Job job{START};
+            nodes[ii].enterNode(job);
+          }
+        }
+
+        double start{wallTime()};
+        for (long long ii = 0; ii < n; ii++) nodes[ii].processQueue(1e300);
+        elapsed += (wallTime() - start) * 1e9;
+      }
+      return elapsed;
+    });
+  }
+}
+
+// the delays of the calendar benchmarks: a cheap generator, so the events,
+// not the random numbers, are timed
+static double nextDelay(uint64_t& state) {
+  state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+  return static_cast<double>(state >> 40);
+}
+
+// a process that only waits, over and over
+static Process ticker(FramePool& pool, Calendar& cal, uint64_t& state) {
+  for (;;) co_await cal.delay(nextDelay(state));
+}
+
+// a suspension of a process against a raw event: a bare time popped from a
+// heap and pushed back later
+static void benchCalendar(BenchSuite& suite) {
+  for (int depth : CALENDAR_DEPTHS) {
+    std::string param{"pending=" + std::to_string(depth)};
+
+    uint64_t state{BENCH_SEED};
+    std::priority_queue<double, std::vector<double>, std::greater<double>>
+        raw;
+    for (int ii = 0; ii < depth; ii++) raw.push(nextDelay(state));
+    suite.run("event::raw", param, [&](long long ops) {
+      double start{wallTime()};
+      for (long long ii = 0; ii < ops; ii++) {
+        double now{raw.top()};
+        raw.pop();
+        raw.push(now + nextDelay(state));
+      }
+      return (wallTime() - start) * 1e9;
+    });
+
+    state = BENCH_SEED;
+    Calendar cal;
+    FramePool pool;
+    for (int ii = 0; ii < depth; ii++) cal.start(ticker(pool, cal, state));
+    suite.run("Process::delay", param, [&](long long ops) {
+      double start{wallTime()};
+      for (long long ii = 0; ii < ops; ii++) cal.step();
+      return (wallTime() - start) * 1e9;
+    });
+  }
+}
+
+static void benchRng(BenchSuite& suite) {
+  PutSeed(BENCH_SEED);
+  suite.run("Random", "", [](long long ops) {
+    double start{wallTime()};
+    for (long long ii = 0; ii < ops; ii++) benchKeep(Random());
+    return (wallTime() - start) * 1e9;
+  });
+  suite.run("Exponential", "m=" + std::to_string(SERVICE_MEAN),
+            [](long long ops) {
+              double start{wallTime()};
+              for (long long ii = 0; ii < ops; ii++) {
+                benchKeep(Exponential(SERVICE_MEAN));
+              }
+              return (wallTime() - start) * 1e9;
+            });
+  suite.run("Uniform", "0.." + std::to_string(HOUR_SEC), [](long long ops) {
+    double start{wallTime()};
+    for (long long ii = 0; ii < ops; ii++) benchKeep(Uniform(0, HOUR_SEC));
+    return (wallTime() - start) * 1e9;
+  });
+  suite.run("Equilikely", "0..7", [](long long ops) {
+    double start{wallTime()};
+    for (long long ii = 0; ii < ops; ii++) benchKeep(Equilikely(0, 7));
+    return (wallTime() - start) * 1e9;
+  });
+}
+
+int main(int argc, char* argv[]) {
+  int reps{10};
+  double minTime{0.05};
+  std::string filter;
+  int maxNodes{1 << 20};
+  double maxMb{2048};
+
+  for (int ii = 1; ii < argc; ii++) {
+    std::string arg{argv[ii]};
+    bool hasValue{ii + 1 < argc};
+    if (arg == "--reps" && hasValue) {
+      reps = atoi(argv[++ii]);
+    } else if (arg == "--min-time" && hasValue) {
+      minTime = atof(argv[++ii]);
+    } else if (arg == "--filter" && hasValue) {
+      filter = argv[++ii];
+    } else if (arg == "--max-nodes" && hasValue) {
+      maxNodes = atoi(argv[++ii]);
+    } else if (arg == "--max-mb" && hasValue) {
+      maxMb = atof(argv[++ii]);
+    } else {
+      std::cout << "Usage: " << argv[0] << " [--reps n] [--min-time sec] "
+                << "[--filter text] [--max-nodes n] [--max-mb mb]"
+                << std::endl;
+      return 1;
+    }
+  }
+
+  BenchSuite suite{reps, minTime, filter};
+  suite.printHeader();
+  benchPolicies(suite, maxNodes, maxMb);
+  benchEnterNode(suite);
+  benchProcessQueue(suite);
+  benchCalendar(suite);
+  benchRng(suite);
+}
@@ -0,0 +1,196 @@
+#include "Branch.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "LoadBalancing.h"
+#include "Stats.h"
+
+BranchRunner::BranchRunner(const std::vector<BranchSpec>& specs,
+                           long long forkJob, int maxParallel)
+    : specs{specs},
+      forkJob{forkJob},
+      maxParallel{maxParallel > 0 ? maxParallel : 1},
+      branch{-1},
+      fd{-1},
+      outcomes(specs.size(), BranchOutcome{}) {}
+
+const BranchSpec* BranchRunner::fork() {
+  // anything still buffered would be written again by every child
+  std::cout.flush();
+  std::cerr.flush();
+  std::fflush(nullptr);
+
+  std::vector<Child> running;
+  for (size_t idx = 0; idx < specs.size(); idx++) {
+    while (static_cast<int>(running.size()) >= maxParallel) reapOne(running);
+
+    int ends[2];
+    if (pipe(ends) != 0) {
+      std::cerr << "Could not create a pipe for branch " << idx << std::endl;
+      continue;
+    }
+    pid_t pid{::fork()};
+    if (pid == 0) {
+      // the branch: only the write end of its own pipe is needed
+      close(ends[0]);
+      for (const Child& child : running) close(child.fd);
+      branch = idx;
+      fd = ends[1];
+      return &specs[idx];
+    }
+
+    close(ends[1]);
+    if (pid < 0) {
+      close(ends[0]);
+      std::cerr << "Could not fork branch " << idx << std::endl;
+      continue;
+    }
+    running.push_back(Child{pid, ends[0], idx});
+  }
+
+  while (!running.empty()) reapOne(running);
+  return nullptr;
+}
+
+void BranchRunner::reapOne(std::vector<Child>& running) {
+  int status{0};
+  pid_t pid{waitpid(-1, &status, 0)};
+  for (size_t ii = 0; ii < running.size(); ii++) {
+    if (running[ii].pid != pid) continue;
+
+    // the outcome is smaller than PIPE_BUF, so it's written in one go and
+    // waits in the pipe for the parent
+    BranchOutcome outcome{};
+    bool isRead{read(running[ii].fd, &outcome, sizeof(outcome)) ==
+                sizeof(outcome)};
+    outcome.ok = isRead && outcome.ok && WIFEXITED(status) &&
+                 WEXITSTATUS(status) == 0;
+    outcomes[running[ii].idx] = outcome;
+
+    close(running[ii].fd);
+    running.erase(running.begin() + ii);
+    return;
+  }
+  if (pid < 0) running.clear();  // no children left to wait for
+}
+
+void BranchRunner::finish(const SimResult& result) {
+  BranchOutcome outcome{};
+  outcome.ok = true;
+  outcome.nJobs = result.nJobs;
+  outcome.rejects = result.totalRejects;
+  outcome.rejectPct = calcRejectRatio(result);
+  outcome.avgDelay = calcMeanDelay(result);
+  outcome.p99Delay = result.delayHist.getPercentile(99.0);
+  RunningStat util;
+  for (const NodeStats& node : result.stats) util.add(node.util);
+  outcome.avgUtil = util.getMean();
+
+  bool ok{write(fd, &outcome, sizeof(outcome)) == sizeof(outcome)};
+  close(fd);
+
+  // leave without the exit handlers, which belong to the parent
+  _exit(ok ? 0 : 1);
+}
+
+int readBranches(std::istream& in, std::vector<BranchSpec>& specs) {
+  int lineNum{0};
+  int errors{0};
+  std::string line;
+  while (std::getline(in, line)) {
+    ++lineNum;
+
+    std::istringstream fields{line};
+    std::string name;
+    if (!(fields >> name) || name[0] == '#') continue;
+
+    int qSize{-1};
+    double rate{1.0};
+    fields >> qSize;
+    if (!(fields >> rate)) rate = 1.0;
+
+    lba_alg lba{name_to_index(name)};
+    if (lba < 0 || qSize < 0 || rate <= 0.0) {
+      std::cerr << "Skipping invalid branch on line " << lineNum << ": "
+                << line << std::endl;
+      ++errors;
+      continue;
+    }
+    specs.push_back(BranchSpec{lba, static_cast<size_t>(qSize), rate});
+  }
+  return errors;
+}
+
+/**
+ * @brief Print and write the outcomes of a model's branches
+ *
+ * @param model The model
+ * @param specs The branches
+ * @param outcomes Their outcomes
+ */
+static void reportBranches(Model model, const std::vector<BranchSpec>& specs,
+                           const std::vector<BranchOutcome>& outcomes) {
+  std::string modelName{model == Model::mqms ? "mqms" : "sqms"};
+  std::ofstream data(modelName + "_branches.csv");
+  data << "branch,alg,q_size,rate,jobs,rejects,reject_pct,avg_d,p99_d,avg_x"
+       << std::endl;
+
+  std::cout << std::setw(6) << "branch" << std::setw(12) << "alg"
+            << std::setw(7) << "qSize" << std::setw(7) << "rate"
+            << std::setw(10) << "jobs" << std::setw(10) << "reject %"
+            << std::setw(12) << "avg_d" << std::setw(12) << "p99_d"
+            << std::setw(9) << "avg_x" << std::endl;
+  for (size_t ii = 0; ii < specs.size(); ii++) {
+    const BranchSpec& spec{specs[ii]};
+    const BranchOutcome& outcome{outcomes[ii]};
+    std::cout << std::setw(6) << ii << std::setw(12) << LBA_NAMES[spec.lba]
+              << std::setw(7) << spec.qSize << std::setw(7) << spec.rate;
+    if (!outcome.ok) {
+      std::cout << "  failed" << std::endl;
+      continue;
+    }
+    std::cout << std::setw(10) << outcome.nJobs << std::setw(10)
+              << outcome.rejectPct << std::setw(12) << outcome.avgDelay
+              << std::setw(12) << outcome.p99Delay << std::setw(9)
+              << outcome.avgUtil << std::endl;
+
+    data << ii << "," << LBA_NAMES[spec.lba] << "," << spec.qSize << ","
+         << spec.rate << "," << outcome.nJobs << "," << outcome.rejects << ","
+         << outcome.rejectPct << "," << outcome.avgDelay << ","
+         << outcome.p99Delay << "," << outcome.avgUtil << std::endl;
+  }
+}
+
+void runBranches(int nNodes, lba_alg lba, size_t qSize, long long nJobs,
+                 const std::vector<BranchSpec>& specs, long long warmJobs,
+                 int maxParallel, const SimOptions& opts) {
+  // both models warm up from the same state
+  EngineState start{saveEngineState()};
+
+  for (Model model : {Model::mqms, Model::sqms}) {
+    restoreEngineState(start);
+    std::cout << "-------------------------------------------------"
+              << std::endl;
+    std::cout << (model == Model::mqms ? "MQMS" : "SQMS") << " BRANCHES: "
+              << warmJobs << " jobs of " << LBA_NAMES[lba]
+              << " warm-up, then " << specs.size() << " branches of "
+              << nJobs - warmJobs << " jobs" << std::endl;
+
+    BranchRunner runner{specs, warmJobs, maxParallel};
+    SimOptions branchOpts{opts};
+    branchOpts.branches = &runner;
+    SimResult result{model == Model::mqms
+                         ? runMqms(nNodes, lba, qSize, nJobs, branchOpts)
+                         : runSqms(nNodes, lba, qSize, nJobs, branchOpts)};
+    if (runner.isBranch()) runner.finish(result);
+
+    reportBranches(model, specs, runner.getOutcomes());
+  }
+}
@@ -0,0 +1,141 @@
+#ifndef BRANCH_H
+#define BRANCH_H
+
+#include <sys/types.h>
+
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "Simulation.h"
+
+// A what-if change to a warmed-up run
+struct BranchSpec {
+  lba_alg lba;   // the algorithm from the fork on
+  size_t qSize;  // the queue size from the fork on (the nodes' or the
+                 // dispatcher's, as in the command line)
+  double rate;   // the arrival rate from the fork on, relative to the default
+};
+
+// What a branch reports back to the process it was forked from
+struct BranchOutcome {
+  bool ok;           // the branch finished
+  long long nJobs;    // the jobs after the fork
+  long long rejects;  // the rejections after the fork
+  double rejectPct;  // the rejections in percent
+  double avgDelay;   // the mean delay
+  double p99Delay;   // the 99th percentile of the delay
+  double avgUtil;    // the mean utilization of the nodes
+};
+
+// Forks the what-if branches of a run from inside its loop.
+//
+// When the run reaches the fork job, fork() starts one child process per
+// branch, at most maxParallel at a time, and waits for them all. fork()
+// shares the warmed-up state copy-on-write, so a branch only copies the
+// pages it changes. Each child switches to its branch's settings, runs to
+// the end, sends its outcome back through a pipe and exits; the parent's
+// loop stops at the fork.
+class BranchRunner {
+ public:
+  /**
+   * @brief Construct a new Branch Runner object
+   *
+   * @param specs The branches
+   * @param forkJob The job before which the run forks
+   * @param maxParallel The most branches running at a time
+   */
+  BranchRunner(const std::vector<BranchSpec>& specs, long long forkJob,
+               int maxParallel);
+
+  /**
+   * @brief Get the job before which the run forks
+   *
+   * @return long long The job's index
+   */
+  long long getForkJob() const { return forkJob; }
+
+  /**
+   * @brief Fork the branches
+   *
+   * @return const BranchSpec* In a branch: its settings. In the parent:
+   * nullptr, once every branch has finished.
+   */
+  const BranchSpec* fork();
+
+  /**
+   * @brief Check whether this process is one of the branches
+   *
+   * @return true fork() returned a branch in this process
+   */
+  bool isBranch() const { return branch >= 0; }
+
+  /**
+   * @brief Send a branch's result to the parent and end the process
+   *
+   * @param result The result of the branch's run
+   */
+  [[noreturn]] void finish(const SimResult& result);
+
+  /**
+   * @brief Get the outcomes of the branches, in the order of the specs
+   *
+   * @return const std::vector<BranchOutcome>& One per branch
+   */
+  const std::vector<BranchOutcome>& getOutcomes() const { return outcomes; }
+
+ private:
+  // a branch that is still running
+  struct Child {
+    pid_t pid;
+    int fd;      // the read end of its pipe
+    size_t idx;  // its spec
+  };
+
+  // wait for one of the running branches and collect its outcome
+  void reapOne(std::vector<Child>& running);
+
+  std::vector<BranchSpec> specs;
+  long long forkJob;
+  int maxParallel;
+  int branch;  // the branch this process runs (-1: the parent)
+  int fd;      // the write end of the branch's pipe
+  std::vector<BranchOutcome> outcomes;
+};
+
+/**
+ * @brief Read the branches of a what-if experiment
+ *
+ * Every non-empty line of the input that doesn't start with '#' is a
+ * branch:
+ *
+ *   <lba_alg> <qSize> [rate]
+ *
+ * @param in The branches, one per line
+ * @param specs Filled with the branches
+ * @return int The number of lines that could not be parsed
+ */
+int readBranches(std::istream& in, std::vector<BranchSpec>& specs);
+
+/**
+ * @brief Warm both models up once, then run every branch from there
+ *
+ * Each model runs warmJobs jobs with the command line's settings, then forks
+ * the branches, which run the remaining jobs with their own settings and
+ * only count those in their statistics. The outcomes are printed and
+ * written to <model>_branches.csv.
+ *
+ * @param nNodes The number of nodes
+ * @param lba The algorithm of the warm-up
+ * @param qSize The queue size of the warm-up
+ * @param nJobs The jobs of a run, warm-up included
+ * @param specs The branches
+ * @param warmJobs The jobs before the fork
+ * @param maxParallel The most branches running at a time
+ * @param opts The simulation options
+ */
+void runBranches(int nNodes, lba_alg lba, size_t qSize, long long nJobs,
+                 const std::vector<BranchSpec>& specs, long long warmJobs,
+                 int maxParallel, const SimOptions& opts);
+
+#endif
@@ -0,0 +1,219 @@
+#include "Checkpoint.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#include "WallClock.h"
+
+// the first bytes of every checkpoint
+const char CHECKPOINT_MAGIC[4] = {'L', 'B', 'C', 'K'};
+
+const uint32_t Checkpointer::VERSION;
+const int Checkpointer::CHECK_EVERY;
+volatile sig_atomic_t Checkpointer::saveRequested{0};
+
+// ask for a checkpoint at the next job (only sets a flag, so it's safe
+// whatever the simulation is doing)
+static void onSaveSignal(int) { Checkpointer::requestSave(); }
+
+Checkpointer::Checkpointer(const std::string& path, double interval)
+    : path{path},
+      interval{path.empty() ? 0.0 : interval},
+      lastTime{wallTime()},
+      isResumePending{false},
+      resumeKey{},
+      resumeEngine{},
+      resumeJob{0},
+      resumeRejects{0},
+      resumeResetJob{0},
+      resumeSteadyJob{0} {
+  if (path.empty()) return;
+
+  struct sigaction action {};
+  action.sa_handler = onSaveSignal;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESTART;
+  sigaction(SIGUSR1, &action, nullptr);
+}
+
+void Checkpointer::requestSave() { saveRequested = 1; }
+
+bool Checkpointer::isTimeUp() const {
+  return wallTime() - lastTime >= interval;
+}
+
+bool Checkpointer::save(const CheckpointKey& key, const RunState& state) {
+  saveRequested = 0;
+  if (path.empty()) return false;
+
+  SnapshotWriter out;
+  out.put(CHECKPOINT_MAGIC);
+  out.put(VERSION);
+  out.putString(SIM_VERSION);
+
+  out.put<uint8_t>(static_cast<uint8_t>(key.model));
+  out.put<int32_t>(key.lba);
+  out.put<int32_t>(key.nNodes);
+  out.put<uint64_t>(key.qSize);
+  out.put<int64_t>(key.nJobs);
+  out.put<uint8_t>(key.detectWarmup);
+
+  EngineState engine{saveEngineState()};
+  out.put<int64_t>(engine.rngSeed);
+  out.put(engine.arrival);
+
+  out.put<int64_t>(state.job);
+  out.put<int64_t>(state.totalRejects);
+  out.put<int64_t>(state.resetJob);
+  out.put<int64_t>(state.steadyJob);
+  state.warmup.saveState(out);
+
+  // the policy's state is stored whole, so it can be read back before the
+  // policy exists
+  SnapshotWriter policy;
+  state.policy.saveState(policy);
+  out.putString(policy.data());
+
+  out.put<uint64_t>(state.nodes.size());
+  for (const ServiceNode& node : state.nodes) node.saveState(out);
+
+  std::queue<Job> jobs{state.jobQueue};
+  out.put<uint64_t>(jobs.size());
+  for (; !jobs.empty(); jobs.pop()) jobs.front().saveState(out);
+
+  // write next to the checkpoint, then rename over it, so there's always a
+  // whole one on disk
+  const std::string& buf{out.data()};
+  std::string tmp{path + ".tmp"};
+  int fd{open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)};
+  bool ok{fd >= 0};
+  for (size_t done = 0; ok && done < buf.size();) {
+    ssize_t wrote{write(fd, buf.data() + done, buf.size() - done)};
+    ok = wrote > 0;
+    if (ok) done += wrote;
+  }
+  ok = ok && fsync(fd) == 0;
+  if (fd >= 0) ok = (close(fd) == 0) && ok;
+  ok = ok && rename(tmp.c_str(), path.c_str()) == 0;
+
+  if (ok) {
+    std::cerr << "Checkpoint before job " << state.job << " written to "
+              << path << " (" << buf.size() / 1024 << " KB)" << std::endl;
+  } else {
+    unlink(tmp.c_str());
+    std::cerr << "Could not write the checkpoint " << path << std::endl;
+  }
+  lastTime = wallTime();  // don't count the writing towards the interval
+  return ok;
+}
+
+bool Checkpointer::load(const std::string& path, std::string& error) {
+  std::ifstream file{path, std::ios::binary};
+  if (!file) {
+    error = "could not open " + path;
+    return false;
+  }
+  std::string buf{std::istreambuf_iterator<char>(file),
+                  std::istreambuf_iterator<char>()};
+
+  SnapshotReader in{buf};
+  char magic[sizeof(CHECKPOINT_MAGIC)];
+  for (char& c : magic) c = in.get<char>();
+  if (!in.isGood() ||
+      !std::equal(magic, magic + sizeof(magic), CHECKPOINT_MAGIC)) {
+    error = path + " is not a checkpoint";
+    return false;
+  }
+  if (in.get<uint32_t>() != VERSION) {
+    error = path + " was written by another version of the checkpoints";
+    return false;
+  }
+  if (in.getString() != SIM_VERSION) {
+    error = path + " was written by another version of the simulation";
+    return false;
+  }
+
+  CheckpointKey key;
+  key.model = static_cast<Model>(in.get<uint8_t>());
+  key.lba = in.get<int32_t>();
+  key.nNodes = in.get<int32_t>();
+  key.qSize = in.get<uint64_t>();
+  key.nJobs = in.get<int64_t>();
+  key.detectWarmup = in.get<uint8_t>() != 0;
+
+  EngineState engine;
+  engine.rngSeed = in.get<int64_t>();
+  engine.arrival = in.get<double>();
+
+  resumeJob = in.get<int64_t>();
+  resumeRejects = in.get<int64_t>();
+  resumeResetJob = in.get<int64_t>();
+  resumeSteadyJob = in.get<int64_t>();
+  resumeWarmup.restoreState(in);
+  resumePolicy = in.getString();
+
+  size_t nNodes{in.getCount(sizeof(int))};
+  if (in.isGood() && nNodes != static_cast<size_t>(key.nNodes)) in.fail();
+  resumeNodes.clear();
+  for (size_t ii = 0; ii < nNodes && in.isGood(); ii++) {
+    resumeNodes.push_back(ServiceNode(ii));
+    resumeNodes.back().restoreState(in);
+  }
+
+  size_t nQueued{in.getCount(3 * sizeof(double))};
+  while (!resumeQueue.empty()) resumeQueue.pop();
+  for (size_t ii = 0; ii < nQueued; ii++) {
+    Job job;
+    job.restoreState(in);
+    resumeQueue.push(job);
+  }
+
+  if (!in.isDone() || resumeJob < 0 || resumeJob > key.nJobs) {
+    error = path + " is damaged";
+    resumeNodes.clear();
+    return false;
+  }
+
+  resumeKey = key;
+  resumeEngine = engine;
+  isResumePending = true;
+  return true;
+}
+
+bool Checkpointer::hasResume() const { return isResumePending; }
+
+const CheckpointKey& Checkpointer::getResumeKey() const { return resumeKey; }
+
+bool Checkpointer::resume(const CheckpointKey& key, const RunState& state) {
+  if (!isResumePending || key.model != resumeKey.model) return false;
+  isResumePending = false;
+
+  SnapshotReader policy{resumePolicy};
+  state.policy.restoreState(policy);
+  if (!policy.isDone()) {
+    std::cerr << "The policy's state in the checkpoint is damaged, the run "
+              << "starts over" << std::endl;
+    return false;
+  }
+
+  // the nodes are swapped in, so the run keeps the loaded table's memory
+  state.nodes.swap(resumeNodes);
+  std::swap(state.jobQueue, resumeQueue);
+  state.warmup = resumeWarmup;
+  state.job = resumeJob;
+  state.totalRejects = resumeRejects;
+  state.resetJob = resumeResetJob;
+  state.steadyJob = resumeSteadyJob;
+  restoreEngineState(resumeEngine);
+
+  resumeNodes.clear();
+  while (!resumeQueue.empty()) resumeQueue.pop();
+
+  std::cerr << "Resumed the run before job " << resumeJob << std::endl;
+  return true;
+}
@@ -0,0 +1,151 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <csignal>
+#include <queue>
+#include <string>
+
+#include "LoadBalancing.h"
+#include "Simulation.h"
+#include "Snapshot.h"
+#include "Warmup.h"
+
+// What a checkpoint was taken of: it only resumes a run with the same settings
+struct CheckpointKey {
+  Model model;        // the model of the run
+  lba_alg lba;        // the algorithm
+  int nNodes;         // the number of nodes
+  size_t qSize;       // the queue size
+  long long nJobs;    // the jobs of the run
+  bool detectWarmup;  // whether the warm-up is truncated
+};
+
+// The variables of a run's loop, so they can be saved and restored in place
+struct RunState {
+  long long& job;             // the next job to dispatch
+  long long& totalRejects;    // the rejections so far
+  long long& resetJob;        // the first job counted in the statistics
+  long long& steadyJob;       // the first job of the steady phase
+  WarmupDetector& warmup;     // the warm-up detector
+  node_list& nodes;           // the node table
+  std::queue<Job>& jobQueue;  // the dispatcher's queue (sqms)
+  lba::PolicyState& policy;   // the load-balancing policy
+};
+
+// Saves the state of a run to a file between two jobs, and resumes a run
+// from such a file.
+//
+// A checkpoint holds everything the rest of the run depends on: the node
+// tables with their queues, pending changes and statistics, the dispatcher's
+// queue, the warm-up detector, the loop's counters, the state of the policy
+// (the round-robin cursor) and the EngineState (the RNG seed and the arrival
+// clock). A resumed run therefore gives the same results, to the bit, as one
+// that was never stopped.
+//
+// Checkpoints are taken every so often (checking the clock once every
+// CHECK_EVERY jobs) and whenever the process gets SIGUSR1. They are written to
+// a temporary file and renamed into place, so a crash while writing one
+// leaves the previous one intact.
+class Checkpointer {
+ public:
+  static const uint32_t VERSION{3};
+  // the jobs between two looks at the clock (a power of two)
+  static const int CHECK_EVERY{4096};
+
+  /**
+   * @brief Construct a new Checkpointer object
+   *
+   * @param path Where checkpoints are written (empty: never)
+   * @param interval The wall time between two checkpoints, in seconds (0:
+   * only on SIGUSR1)
+   */
+  Checkpointer(const std::string& path, double interval);
+
+  /**
+   * @brief Read a checkpoint to resume from
+   *
+   * The run it belongs to picks it up in resume().
+   *
+   * @param path The checkpoint file
+   * @param error Set to what went wrong
+   * @return true The checkpoint was read
+   */
+  bool load(const std::string& path, std::string& error);
+
+  /**
+   * @brief Check whether a loaded checkpoint is waiting to be resumed
+   *
+   * @return true load() succeeded and no run has resumed from it yet
+   */
+  bool hasResume() const;
+
+  /**
+   * @brief Get the settings of the run the loaded checkpoint belongs to
+   *
+   * @return const CheckpointKey& The run's settings
+   */
+  const CheckpointKey& getResumeKey() const;
+
+  /**
+   * @brief Continue a run from the loaded checkpoint, if it is this run's
+   *
+   * Call once the run has set up its state; the state is then replaced by
+   * the checkpoint's, and so is the EngineState.
+   *
+   * @param key The run's settings
+   * @param state The run's variables
+   * @return true The run was resumed
+   */
+  bool resume(const CheckpointKey& key, const RunState& state);
+
+  /**
+   * @brief Check whether a checkpoint should be taken before a job
+   *
+   * @param job The index of the next job
+   * @return true save() should be called
+   */
+  bool isDue(long long job) const {
+    return saveRequested ||
+           ((job & (CHECK_EVERY - 1)) == 0 && interval > 0.0 && isTimeUp());
+  }
+
+  /**
+   * @brief Write a checkpoint of a run
+   *
+   * @param key The run's settings
+   * @param state The run's variables, between two jobs
+   * @return true The checkpoint was written
+   */
+  bool save(const CheckpointKey& key, const RunState& state);
+
+  /**
+   * @brief Ask for a checkpoint before the next job (what SIGUSR1 does)
+   */
+  static void requestSave();
+
+ private:
+  // check whether the interval has passed since the last checkpoint
+  bool isTimeUp() const;
+
+  // set by SIGUSR1
+  static volatile sig_atomic_t saveRequested;
+
+  std::string path;
+  double interval;
+  double lastTime;  // when the last checkpoint was taken
+
+  // the loaded checkpoint, until a run resumes from it
+  bool isResumePending;
+  CheckpointKey resumeKey;
+  EngineState resumeEngine;
+  long long resumeJob;
+  long long resumeRejects;
+  long long resumeResetJob;
+  long long resumeSteadyJob;
+  std::string resumePolicy;  // the policy's own snapshot
+  WarmupDetector resumeWarmup;
+  node_list resumeNodes;
+  std::queue<Job> resumeQueue;
+};
+
+#endif
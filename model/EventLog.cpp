@@ -0,0 +1,288 @@
+#include "EventLog.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <cstring>
+
+#include "Profile.h"
+
+constexpr double EventLog::TICK;
+const uint32_t EventLog::BLOCK_EVENTS;
+
+// the version of the layout described in EventLog.h
+const uint32_t EVENT_LOG_VERSION{2};
+
+// Append a little-endian integer to a buffer
+template <typename T>
+static void putLE(std::string& buf, T value) {
+  for (size_t ii = 0; ii < sizeof(T); ii++) {
+    buf += static_cast<char>((static_cast<uint64_t>(value) >> (8 * ii)) & 0xFF);
+  }
+}
+
+// Append an unsigned LEB128 varint to a buffer
+static void putVarint(std::string& buf, uint64_t value) {
+  while (value >= 0x80) {
+    buf += static_cast<char>((value & 0x7F) | 0x80);
+    value >>= 7;
+  }
+  buf += static_cast<char>(value);
+}
+
+// Read a little-endian integer (the caller checks the bounds)
+template <typename T>
+static T getLE(const uint8_t* p) {
+  uint64_t value{0};
+  for (size_t ii = 0; ii < sizeof(T); ii++) {
+    value |= static_cast<uint64_t>(p[ii]) << (8 * ii);
+  }
+  return static_cast<T>(value);
+}
+
+// Read an unsigned LEB128 varint, failing at the end of the data
+static bool getVarint(const uint8_t*& p, const uint8_t* end, uint64_t& value) {
+  value = 0;
+  for (int shift = 0; p < end && shift < 64; shift += 7) {
+    uint8_t byte{*p++};
+    value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if (byte < 0x80) return true;
+  }
+  return false;
+}
+
+// The hash threshold below which a job is sampled, for a fraction of jobs
+static uint64_t rateThreshold(double rate) {
+  if (rate >= 1.0) return UINT64_MAX;
+  return rate > 0.0 ? static_cast<uint64_t>(std::ldexp(rate, 64)) : 0;
+}
+
+// Convert a time to ticks
+static int64_t toTicks(double t) { return std::llround(t / EventLog::TICK); }
+
+EventLog::Buffer::Buffer(EventLog& log, uint8_t run, double rate)
+    : log{log},
+      run{run},
+      threshold{rateThreshold(rate)},
+      count{0},
+      firstIndex{0},
+      firstArrival{0},
+      lastIndex{0},
+      lastArrival{0} {
+  payload.reserve(BLOCK_EVENTS * 16);
+}
+
+EventLog::Buffer::~Buffer() { flush(); }
+
+void EventLog::Buffer::add(const JobEvent& event) {
+  PROF_SCOPE("EventLog::add");
+  int64_t arrival{toTicks(event.arrival)};
+  int64_t delay{toTicks(event.delay)};
+  int64_t service{toTicks(event.departure) - arrival - delay};
+
+  if (count == 0) {
+    firstIndex = lastIndex = event.index;
+    firstArrival = lastArrival = arrival;
+  }
+
+  // arrivals and indexes only grow within a run
+  putVarint(payload, event.index - lastIndex);
+  putVarint(payload, arrival - lastArrival);
+  putVarint(payload, (static_cast<uint64_t>(event.node) << 1) | event.rejected);
+  putVarint(payload, event.queued);
+  putVarint(payload, delay > 0 ? delay : 0);
+  putVarint(payload, service > 0 ? service : 0);
+  lastIndex = event.index;
+  lastArrival = arrival;
+
+  if (++count == BLOCK_EVENTS) flush();
+}
+
+void EventLog::Buffer::flush() {
+  if (count == 0) return;
+
+  log.append(EventBlockInfo{0, run, count, firstIndex, firstArrival}, payload);
+  payload.clear();
+  count = 0;
+}
+
+EventLog::EventLog(const std::string& path, const std::string& policy,
+                   const std::string& description)
+    : file{std::fopen(path.c_str(), "wb")}, ok{file != nullptr}, offset{0} {
+  if (!ok) return;
+
+  std::string header{"LBEV"};
+  putLE<uint32_t>(header, EVENT_LOG_VERSION);
+  double tick{TICK};
+  header.append(reinterpret_cast<const char*>(&tick), sizeof(tick));
+  putLE<uint32_t>(header, policy.size());
+  header += policy;
+  putLE<uint32_t>(header, description.size());
+  header += description;
+
+  ok = std::fwrite(header.data(), 1, header.size(), file) == header.size();
+  offset = header.size();
+}
+
+EventLog::~EventLog() { close(); }
+
+bool EventLog::isOk() const { return ok; }
+
+void EventLog::append(EventBlockInfo info, const std::string& payload) {
+  std::string header;
+  putLE<uint8_t>(header, info.run);
+  header.append(3, '\0');
+  putLE<uint32_t>(header, info.count);
+  putLE<uint32_t>(header, payload.size());
+  putLE<int64_t>(header, info.firstIndex);
+  putLE<int64_t>(header, info.firstArrival);
+
+  std::lock_guard<std::mutex> guard{lock};
+  if (!file) return;
+
+  info.offset = offset;
+  ok = ok && std::fwrite(header.data(), 1, header.size(), file) ==
+                 header.size();
+  ok = ok && std::fwrite(payload.data(), 1, payload.size(), file) ==
+                 payload.size();
+  offset += header.size() + payload.size();
+  blocks.push_back(info);
+}
+
+bool EventLog::close() {
+  std::lock_guard<std::mutex> guard{lock};
+  if (!file) return ok;
+
+  std::string index;
+  for (const EventBlockInfo& block : blocks) {
+    putLE<uint64_t>(index, block.offset);
+    putLE<uint8_t>(index, block.run);
+    putLE<uint32_t>(index, block.count);
+    putLE<int64_t>(index, block.firstIndex);
+    putLE<int64_t>(index, block.firstArrival);
+  }
+  putLE<uint64_t>(index, offset);
+  putLE<uint32_t>(index, blocks.size());
+  index += "LBEI";
+
+  ok = ok && std::fwrite(index.data(), 1, index.size(), file) == index.size();
+  ok = std::fclose(file) == 0 && ok;
+  file = nullptr;
+  return ok;
+}
+
+// the sizes of the parts of the layout
+const size_t HEADER_BYTES{20};       // before the policy's name
+const size_t BLOCK_HEADER_BYTES{28};
+const size_t INDEX_ENTRY_BYTES{29};
+const size_t FOOTER_BYTES{16};
+
+EventLogReader::EventLogReader(const std::string& path)
+    : data{nullptr}, size{0}, ok{false}, tick{EventLog::TICK} {
+  int fd{::open(path.c_str(), O_RDONLY)};
+  if (fd < 0) return;
+
+  struct stat info;
+  if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+    void* mapped{::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0)};
+    if (mapped != MAP_FAILED) {
+      data = static_cast<const uint8_t*>(mapped);
+      size = info.st_size;
+    }
+  }
+  ::close(fd);  // the mapping stays valid
+  if (!data || size < HEADER_BYTES + FOOTER_BYTES) return;
+
+  // the header
+  if (std::memcmp(data, "LBEV", 4) != 0 ||
+      getLE<uint32_t>(data + 4) != EVENT_LOG_VERSION) {
+    return;
+  }
+  std::memcpy(&tick, data + 8, sizeof(tick));
+  uint32_t policyLen{getLE<uint32_t>(data + 16)};
+  if (policyLen > size - HEADER_BYTES - FOOTER_BYTES - 4) return;
+  policy.assign(reinterpret_cast<const char*>(data + HEADER_BYTES),
+                policyLen);
+  size_t textAt{HEADER_BYTES + policyLen + 4};
+  uint32_t textLen{getLE<uint32_t>(data + textAt - 4)};
+  if (textLen > size - textAt - FOOTER_BYTES) return;
+  description.assign(reinterpret_cast<const char*>(data + textAt), textLen);
+
+  // the footer and the index it points to (a log that was not closed has
+  // neither, and can't be read)
+  const uint8_t* footer{data + size - FOOTER_BYTES};
+  if (std::memcmp(footer + 12, "LBEI", 4) != 0) return;
+  uint64_t indexOffset{getLE<uint64_t>(footer)};
+  uint32_t count{getLE<uint32_t>(footer + 8)};
+  if (indexOffset < textAt + textLen ||
+      indexOffset > size - FOOTER_BYTES ||
+      (size - FOOTER_BYTES - indexOffset) / INDEX_ENTRY_BYTES != count) {
+    return;
+  }
+
+  blocks.reserve(count);
+  for (uint32_t ii = 0; ii < count; ii++) {
+    const uint8_t* entry{data + indexOffset + ii * INDEX_ENTRY_BYTES};
+    EventBlockInfo block{getLE<uint64_t>(entry), entry[8],
+                         getLE<uint32_t>(entry + 9), getLE<int64_t>(entry + 13),
+                         getLE<int64_t>(entry + 21)};
+    if (block.offset + BLOCK_HEADER_BYTES > indexOffset) return;
+    blocks.push_back(block);
+  }
+  ok = true;
+}
+
+EventLogReader::~EventLogReader() {
+  if (data) ::munmap(const_cast<uint8_t*>(data), size);
+}
+
+bool EventLogReader::isOk() const { return ok; }
+
+const std::string& EventLogReader::getPolicy() const { return policy; }
+
+const std::string& EventLogReader::getDescription() const {
+  return description;
+}
+
+const std::vector<EventBlockInfo>& EventLogReader::getBlocks() const {
+  return blocks;
+}
+
+bool EventLogReader::readBlock(size_t idx,
+                               std::vector<JobEvent>& events) const {
+  events.clear();
+  if (!ok || idx >= blocks.size()) return false;
+
+  const EventBlockInfo& block{blocks[idx]};
+  const uint8_t* p{data + block.offset};
+  uint32_t payloadLen{getLE<uint32_t>(p + 8)};
+  if (p[0] != block.run || getLE<uint32_t>(p + 4) != block.count ||
+      payloadLen > size - block.offset - BLOCK_HEADER_BYTES) {
+    return false;
+  }
+  p += BLOCK_HEADER_BYTES;
+  const uint8_t* end{p + payloadLen};
+
+  events.reserve(block.count);
+  int64_t index{block.firstIndex};
+  int64_t arrival{block.firstArrival};
+  for (uint32_t ii = 0; ii < block.count; ii++) {
+    uint64_t dIndex, dArrival, nodeRej, queued, delay, service;
+    if (!getVarint(p, end, dIndex) || !getVarint(p, end, dArrival) ||
+        !getVarint(p, end, nodeRej) || !getVarint(p, end, queued) ||
+        !getVarint(p, end, delay) || !getVarint(p, end, service)) {
+      return false;
+    }
+    index += dIndex;
+    arrival += dArrival;
+    events.push_back(JobEvent{index, arrival * tick,
+                              static_cast<int>(nodeRej >> 1),
+                              static_cast<long long>(queued), delay * tick,
+                              (arrival + delay + service) * tick,
+                              (nodeRej & 1) != 0});
+  }
+  return p == end;
+}
@@ -0,0 +1,238 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// What happened to one job at the dispatcher
+struct JobEvent {
+  long long index;   // the job's index in the run
+  double arrival;    // when it arrived
+  int node;          // the node it was sent to
+  long long queued;  // the queue length it found (the node's, or the
+                     // dispatcher's in sqms)
+  double delay;      // how long it waited (0 if rejected)
+  double departure;  // when it left (its arrival if rejected)
+  bool rejected;     // the job was turned away
+};
+
+// Where a block of events is in the log
+struct EventBlockInfo {
+  uint64_t offset;        // the position of the block's header in the file
+  uint8_t run;            // the run the events belong to (the Model)
+  uint32_t count;         // the number of events
+  int64_t firstIndex;     // the first event's job index
+  int64_t firstArrival;   // the first event's arrival, in ticks
+};
+
+// A sampled per-job event log in a compact binary format.
+//
+// Layout (all integers little-endian):
+//   header:  "LBEV", u32 version, f64 seconds per tick, u32 length +
+//            policy name, u32 length + text
+//   blocks:  u8 run, u8[3] 0, u32 count, u32 payload bytes,
+//            i64 first index, i64 first arrival (ticks), payload
+//   index:   per block: u64 offset, u8 run, u32 count, i64 first index,
+//            i64 first arrival
+//   footer:  u64 index offset, u32 blocks, "LBEI"
+//
+// A payload holds one record per event, each field a LEB128 varint: the
+// index and arrival as deltas from the previous event of the block, then
+// node << 1 | rejected, the queue length, the delay and the service time
+// (departure - arrival - delay) in ticks. Every block starts from its own
+// header's values, so a reader can seek to any block through the index and
+// decode it alone.
+//
+// Events are encoded into per-thread Buffers; only full blocks are handed to
+// the log, under its lock.
+class EventLog {
+ public:
+  // the resolution of the times in the log
+  static constexpr double TICK{1e-6};
+  // the events per block
+  static const uint32_t BLOCK_EVENTS{4096};
+
+  // An encoder owned by one thread (one simulation loop)
+  class Buffer {
+   public:
+    /**
+     * @brief Construct a new Buffer object for a run
+     *
+     * @param log The log the blocks go to
+     * @param run The run's identifier (the Model)
+     * @param rate The fraction of jobs to log, in (0, 1]
+     */
+    Buffer(EventLog& log, uint8_t run, double rate);
+
+    /**
+     * @brief Hand the last, partial block to the log
+     */
+    ~Buffer();
+
+    /**
+     * @brief Check whether a job is in the sample
+     *
+     * The choice only depends on the job's index (it draws no random
+     * numbers), so it is the same for every run and policy.
+     *
+     * @param index The job's index in the run
+     * @return true The job should be logged
+     */
+    bool isSampled(long long index) const {
+      return threshold == UINT64_MAX || mix(index) < threshold;
+    }
+
+    /**
+     * @brief Encode an event
+     *
+     * @param event The event (of a sampled job)
+     */
+    void add(const JobEvent& event);
+
+    /**
+     * @brief Hand the current block to the log
+     */
+    void flush();
+
+   private:
+    // the splitmix64 finalizer, to sample by job index
+    static uint64_t mix(uint64_t x) {
+      x += 0x9E3779B97F4A7C15ull;
+      x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+      x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+      return x ^ (x >> 31);
+    }
+
+    EventLog& log;
+    uint8_t run;
+    uint64_t threshold;
+
+    std::string payload;
+    uint32_t count;
+    int64_t firstIndex;
+    int64_t firstArrival;
+    int64_t lastIndex;
+    int64_t lastArrival;
+  };
+
+  /**
+   * @brief Create the log file and write its header
+   *
+   * @param path Where to write the log
+   * @param policy The name of the load-balancing algorithm of the runs
+   * @param description A line describing the simulation
+   */
+  EventLog(const std::string& path, const std::string& policy,
+           const std::string& description);
+
+  /**
+   * @brief Write the index and close the file
+   */
+  ~EventLog();
+
+  /**
+   * @brief Check whether the file is open and all writes succeeded
+   *
+   * @return true The log is fine
+   */
+  bool isOk() const;
+
+  /**
+   * @brief Write the block index and the footer, and close the file
+   *
+   * @return true Everything was written
+   */
+  bool close();
+
+ private:
+  /**
+   * @brief Append an encoded block (thread-safe)
+   *
+   * @param info The block's index entry (the offset is filled in)
+   * @param payload The encoded events
+   */
+  void append(EventBlockInfo info, const std::string& payload);
+
+  std::FILE* file;
+  bool ok;
+  uint64_t offset;
+  std::vector<EventBlockInfo> blocks;
+  std::mutex lock;
+};
+
+// Reads an event log through a read-only memory mapping.
+//
+// The block index is loaded when the log is opened; blocks are decoded on
+// demand and independently, so several threads can share one reader.
+class EventLogReader {
+ public:
+  /**
+   * @brief Map a log and load its header and block index
+   *
+   * @param path The log's path
+   */
+  explicit EventLogReader(const std::string& path);
+
+  /**
+   * @brief Unmap the log
+   */
+  ~EventLogReader();
+
+  EventLogReader(const EventLogReader&) = delete;
+  EventLogReader& operator=(const EventLogReader&) = delete;
+
+  /**
+   * @brief Check whether the log was mapped and its layout is valid
+   *
+   * @return true The blocks can be read
+   */
+  bool isOk() const;
+
+  /**
+   * @brief Get the load-balancing algorithm stored in the header
+   *
+   * The model of each run is in its blocks (EventBlockInfo::run).
+   *
+   * @return const std::string& The algorithm's name
+   */
+  const std::string& getPolicy() const;
+
+  /**
+   * @brief Get the text stored in the header (the simulation's command line)
+   *
+   * @return const std::string& The description
+   */
+  const std::string& getDescription() const;
+
+  /**
+   * @brief Get the block index
+   *
+   * @return const std::vector<EventBlockInfo>& One entry per block, in the
+   * order they were written
+   */
+  const std::vector<EventBlockInfo>& getBlocks() const;
+
+  /**
+   * @brief Decode a block
+   *
+   * @param idx The block's position in the index
+   * @param events Filled with the block's events (cleared first)
+   * @return true The block was decoded
+   * @return false The block is corrupt or truncated
+   */
+  bool readBlock(size_t idx, std::vector<JobEvent>& events) const;
+
+ private:
+  const uint8_t* data;
+  size_t size;
+  bool ok;
+  double tick;
+  std::string policy;
+  std::string description;
+  std::vector<EventBlockInfo> blocks;
+};
+
+#endif
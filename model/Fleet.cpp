@@ -0,0 +1,334 @@
+#include "Fleet.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#include "Job.h"
+#include "Numa.h"
+#include "PerfCounters.h"
+#include "Profile.h"
+#include "TournamentTree.h"
+#include "WallClock.h"
+#include "rvgs.h"
+
+static_assert(sizeof(FleetNode) <= 48, "a fleet node outgrew 48 bytes");
+
+Fleet::Fleet(int nNodes, size_t qSize)
+    : nNodes{nNodes},
+      slots{std::min(qSize, FLEET_MAX_QUEUE) + 1},
+      ringSize{std::max<size_t>(slots - 1, 1)},
+      nodes{} {
+  // the jobs land all over the array, so it's backed by huge pages to keep
+  // the page walks off their path
+  nodes.reserve(nNodes);
+  adviseHugePages(nodes.data(), nodes.capacity() * sizeof(FleetNode));
+  nodes.assign(nNodes, FleetNode{});
+}
+
+size_t Fleet::countJobs(const FleetNode& node, double t) const {
+  // the jobs of the busy period left one after the other, so each one
+  // departed a service time before the next
+  double departure{node.lastDeparture};
+  size_t at{node.numJobs % ringSize};  // past the newest service
+  size_t count{0};
+  while (departure > t && ++count < slots) {
+    at = (at == 0 ? ringSize : at) - 1;
+    float service{node.services[at]};
+    if (std::signbit(service)) break;  // the first job of the busy period
+    departure -= service;
+  }
+  return count;
+}
+
+bool Fleet::enter(int node, double arrival, double service, double& delay) {
+  FleetNode& at{nodes[node]};
+  if (countJobs(at, arrival) >= slots) return false;
+
+  bool isWaiting{at.lastDeparture > arrival};
+  delay = isWaiting ? at.lastDeparture - arrival : 0.0;
+  at.lastDeparture = arrival + delay + service;
+  at.busyTime += service;
+  at.totDelay += delay;
+
+  // a job that didn't wait starts a new busy period
+  float kept{static_cast<float>(service)};
+  at.services[at.numJobs % ringSize] = isWaiting ? kept : -kept;
+  ++at.numJobs;
+  return true;
+}
+
+double Fleet::getBytesPerNode() const {
+  size_t bytes{nodes.capacity() * sizeof(FleetNode)};
+  return nNodes > 0 ? static_cast<double>(bytes) / nNodes : 0.0;
+}
+
+// the keys the policies compare the nodes by
+struct BusyKey {
+  const Fleet* fleet;
+  double operator()(uint32_t node) const { return fleet->getBusyTime(node); }
+};
+
+struct AvgQueueKey {
+  const Fleet* fleet;
+  double operator()(uint32_t node) const { return fleet->getAvgQueue(node); }
+};
+
+struct JobsKey {
+  const Fleet* fleet;
+  uint32_t operator()(uint32_t node) const { return fleet->getNumJobs(node); }
+};
+
+// the nodes take turns, as lba::RoundRobin
+class FleetRoundRobin {
+ public:
+  static const bool IS_BLIND{true};
+  explicit FleetRoundRobin(const Fleet& fleet) : next{0} {}
+  int pick(const Fleet& fleet) {
+    int node{next};
+    next = (next + 1) % fleet.size();
+    return node;
+  }
+  void prefetch(const Fleet& fleet, int node) const {}
+  void update(int node) {}
+  size_t getBytes() const { return 0; }
+
+ private:
+  int next;
+};
+
+// every node is equally likely, as lba::Random
+class FleetRandom {
+ public:
+  static const bool IS_BLIND{true};
+  explicit FleetRandom(const Fleet& fleet) {}
+  int pick(const Fleet& fleet) { return Equilikely(0, fleet.size() - 1); }
+  void prefetch(const Fleet& fleet, int node) const {}
+  void update(int node) {}
+  size_t getBytes() const { return 0; }
+};
+
+// the node with the smallest key, the lowest index among equals, as the
+// scans of lba::UtilizationBased (Key: BusyKey) and lba::LeastConnections
+// (AvgQueueKey with queues, JobsKey without)
+template <typename Key>
+class FleetLeast {
+ public:
+  static const bool IS_BLIND{false};
+  explicit FleetLeast(const Fleet& fleet) : tree{fleet.size(), Key{&fleet}} {}
+  int pick(const Fleet& fleet) { return tree.getWinner(); }
+  void prefetch(const Fleet& fleet, int node) const { tree.prefetch(node); }
+  void update(int node) { tree.update(node); }
+  size_t getBytes() const { return tree.getBytes(); }
+
+ private:
+  TournamentTree<Key> tree;
+};
+
+// the jobs drawn ahead of the one being placed
+const int FLEET_LOOKAHEAD{16};
+
+// the jobs of a run through one policy (compiled for each policy, so its
+// calls are inlined)
+//
+// On a large fleet every job goes to a node that is out of the cache, so the
+// memory it touches is fetched before it's needed: a blind policy (one that
+// picks without looking at the nodes) picks each job's node as the job is
+// drawn, FLEET_LOOKAHEAD jobs early, and the others fetch the next job's node
+// and their own state for it as soon as an update settled it, while the job
+// before it is recorded and the one after it drawn. The random numbers are
+// drawn in the same order either way.
+template <typename Policy>
+static void fleetLoop(Fleet& fleet, long long nJobs, FleetResult& result) {
+  Policy policy{fleet};
+  result.bytesPerNode +=
+      static_cast<double>(policy.getBytes()) / fleet.size();
+  perfEnter(PerfPhase::steady);
+  double start{wallTime()};
+
+  Job ahead[FLEET_LOOKAHEAD];
+  int aheadNodes[FLEET_LOOKAHEAD];
+  auto draw = [&](long long idx) {
+    int slot{static_cast<int>(idx % FLEET_LOOKAHEAD)};
+    ahead[slot] = Job{getArrival()};
+    if (Policy::IS_BLIND) {
+      aheadNodes[slot] = policy.pick(fleet);
+      fleet.prefetch(aheadNodes[slot]);
+    }
+  };
+  for (long long ii = 0; ii < std::min<long long>(nJobs, FLEET_LOOKAHEAD);
+       ii++) {
+    draw(ii);
+  }
+
+  for (long long ii = 0; ii < nJobs; ii++) {
+    int slot{static_cast<int>(ii % FLEET_LOOKAHEAD)};
+    Job job{ahead[slot]};
+    int node{Policy::IS_BLIND ? aheadNodes[slot] : policy.pick(fleet)};
+    if (ii + FLEET_LOOKAHEAD < nJobs) draw(ii + FLEET_LOOKAHEAD);
+
+    double delay{0.0};
+    if (fleet.enter(node, job.getArrival(), job.getServiceTime(), delay)) {
+      policy.update(node);
+      if (!Policy::IS_BLIND) {
+        int next{policy.pick(fleet)};
+        fleet.prefetch(next);
+        policy.prefetch(fleet, next);
+      }
+      result.delay.add(delay);
+      result.delayHist.record(delay);
+      result.waitHist.record(delay + job.getServiceTime());
+    } else {
+      ++result.rejects;
+    }
+  }
+  result.loopSeconds = wallTime() - start;
+  perfAddJobs(PerfPhase::steady, nJobs);
+}
+
+// summarize the values of a quantity over the nodes (they are reordered)
+static void fillSpread(FleetSpread& spread, std::vector<double>& values) {
+  for (double value : values) {
+    spread.stat.add(value);
+    spread.hist.record(value);
+  }
+
+  // the exact order statistics, in O(n) each
+  auto percentile = [&values](double p) {
+    size_t rank{static_cast<size_t>(p / 100.0 * (values.size() - 1))};
+    std::nth_element(values.begin(), values.begin() + rank, values.end());
+    return values[rank];
+  };
+  spread.min = percentile(0.0);
+  spread.p1 = percentile(1.0);
+  spread.p50 = percentile(50.0);
+  spread.p99 = percentile(99.0);
+  spread.max = percentile(100.0);
+}
+
+double loadToRate(int nNodes, double load) {
+  // the arrivals are on average half an hour apart (see getArrival())
+  return load * nNodes * (HOUR_SEC / 2.0) / SERVICE_MEAN;
+}
+
+int fleetTreeDepth(int nNodes, lba_alg lba) {
+  if (lba < 2) return 0;  // round-robin and random, as in runFleet()
+  int depth{0};
+  while ((1LL << depth) < nNodes) ++depth;
+  return depth;
+}
+
+FleetResult runFleet(int nNodes, lba_alg lba, size_t qSize, long long nJobs) {
+  PROF_SCOPE("runFleet");
+  PROF_COUNT("jobs", nJobs);
+  perfEnter(PerfPhase::setup);
+
+  Fleet fleet{nNodes, qSize};
+  FleetResult result;
+  result.nNodes = nNodes;
+  result.nJobs = nJobs;
+  result.rejects = 0;
+  result.bytesPerNode = fleet.getBytesPerNode();
+
+  switch (lba) {
+    case 0:
+      fleetLoop<FleetRoundRobin>(fleet, nJobs, result);
+      break;
+    case 1:
+      fleetLoop<FleetRandom>(fleet, nJobs, result);
+      break;
+    case 2:
+      fleetLoop<FleetLeast<BusyKey>>(fleet, nJobs, result);
+      break;
+    default:
+      if (fleet.getQueueSize() > 0) {
+        fleetLoop<FleetLeast<AvgQueueKey>>(fleet, nJobs, result);
+      } else {
+        fleetLoop<FleetLeast<JobsKey>>(fleet, nJobs, result);
+      }
+  }
+
+  perfEnter(PerfPhase::output);
+  std::vector<double> values(nNodes);
+  for (int node = 0; node < nNodes; node++) values[node] = fleet.getUtil(node);
+  fillSpread(result.util, values);
+  for (int node = 0; node < nNodes; node++) {
+    values[node] = fleet.getNumJobs(node);
+  }
+  fillSpread(result.jobs, values);
+  for (int node = 0; node < nNodes; node++) {
+    values[node] = fleet.getAvgDelay(node);
+  }
+  fillSpread(result.avgDelay, values);
+  return result;
+}
+
+void fleetSimulation(int nNodes, lba_alg lba, size_t qSize, long long nJobs,
+                     double load) {
+  PROF_SCOPE("fleetSimulation");
+  if (load > 0.0) setArrivalRate(loadToRate(nNodes, load));
+  FleetResult result{runFleet(nNodes, lba, qSize, nJobs)};
+
+  double rejectRatio{(static_cast<double>(result.rejects) / nJobs) * 100};
+  std::cout << std::setprecision(5) << "Rejection amount: " << rejectRatio
+            << "%" << std::endl;
+  std::cout << "Delay: mean " << result.delay.getMean() << ", p50 "
+            << result.delayHist.getPercentile(50.0) << ", p99 "
+            << result.delayHist.getPercentile(99.0) << ", p999 "
+            << result.delayHist.getPercentile(99.9) << std::endl;
+  std::cout << "Memory: " << result.bytesPerNode << " bytes per node"
+            << std::endl;
+
+  // the spread of the per-node statistics, instead of one line per node
+  const FleetSpread* spreads[]{&result.util, &result.jobs, &result.avgDelay};
+  const char* names[]{"util", "jobs", "avg_d"};
+  std::cout << "Across the " << nNodes << " nodes:" << std::endl;
+  std::cout << std::setw(8) << "" << std::setw(12) << "mean"
+            << std::setw(12) << "sd" << std::setw(12) << "min"
+            << std::setw(12) << "p1" << std::setw(12) << "p50"
+            << std::setw(12) << "p99" << std::setw(12) << "max" << std::endl;
+
+  std::string prefix{"fleet_" + LBA_NAMES[lba]};
+  std::ofstream data(prefix + ".csv");
+  data << "metric,nodes,mean,sd,min,p1,p50,p99,max" << std::endl;
+  std::ofstream hist(prefix + "_hist.csv");
+  hist << "metric,lower,count" << std::endl;
+
+  for (int ii = 0; ii < 3; ii++) {
+    const FleetSpread& spread{*spreads[ii]};
+    double values[]{spread.stat.getMean(), spread.stat.getStdDev(),
+                    spread.min, spread.p1, spread.p50, spread.p99, spread.max};
+
+    std::cout << std::setw(8) << names[ii];
+    data << names[ii] << "," << nNodes;
+    for (double value : values) {
+      std::cout << std::setw(12) << value;
+      data << "," << value;
+    }
+    std::cout << std::endl;
+    data << std::endl;
+
+    for (size_t idx = 0; idx < Histogram::NUM_BUCKETS; idx++) {
+      if (spread.hist.getBucket(idx) == 0) continue;
+      hist << names[ii] << ","
+           << Histogram::lowerBound(idx) * Histogram::RESOLUTION << ","
+           << spread.hist.getBucket(idx) << std::endl;
+    }
+  }
+
+  // the run-wide percentiles, as accumPercentiles()
+  std::ofstream pct(prefix + "_pct.csv");
+  pct << "metric,n_jobs,p50,p90,p99,p999" << std::endl;
+  const Histogram* hists[]{&result.delayHist, &result.waitHist};
+  const char* histNames[]{"delay", "wait"};
+  for (int ii = 0; ii < 2; ii++) {
+    pct << histNames[ii] << "," << hists[ii]->getCount() << ","
+        << hists[ii]->getPercentile(50.0) << ","
+        << hists[ii]->getPercentile(90.0) << ","
+        << hists[ii]->getPercentile(99.0) << ","
+        << hists[ii]->getPercentile(99.9) << std::endl;
+  }
+  perfLeave();
+}
@@ -0,0 +1,236 @@
+#ifndef FLEET_H
+#define FLEET_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Histogram.h"
+#include "Simulation.h"
+#include "Stats.h"
+
+// the largest queue of a fleet node, which keeps a node at 48 bytes
+const size_t FLEET_MAX_QUEUE{5};
+// the most jobs of a fleet run, so that a node's 32-bit count of its jobs
+// can't wrap (which would also break its ring of services)
+const long long FLEET_MAX_JOBS{UINT32_MAX};
+
+// A node of a fleet: what its admissions and the policies need, packed so
+// that a job placed on it touches one or two cache lines
+struct FleetNode {
+  double lastDeparture;  // of the last job admitted
+  double busyTime;       // the total service time admitted
+  double totDelay;       // the total delay of the jobs admitted
+  uint32_t numJobs;      // the jobs admitted (see FLEET_MAX_JOBS)
+  float services[FLEET_MAX_QUEUE];  // of the last jobs, a ring that numJobs
+                                    // moves through; the service of a job
+                                    // that started a busy period is negated
+};
+
+// The nodes of a very large cluster (10^5 to 10^6 servers), each a FIFO
+// server with room for qSize waiting jobs, kept in one compact array.
+//
+// The jobs still in a node are the tail of its current busy period, so they
+// are counted by walking the service times of its last jobs back from its
+// last departure, as far as the start of the busy period: admitting a job
+// takes O(qSize) time, whatever the number of nodes. Nothing is kept per job.
+class Fleet {
+ public:
+  /**
+   * @brief Construct a new Fleet object of idle nodes
+   *
+   * @param nNodes The number of nodes
+   * @param qSize The room for waiting jobs of each node (at most
+   * FLEET_MAX_QUEUE)
+   */
+  Fleet(int nNodes, size_t qSize);
+
+  /**
+   * @brief Get the number of nodes
+   *
+   * @return int The number of nodes
+   */
+  int size() const { return nNodes; }
+
+  /**
+   * @brief Get the room for waiting jobs of each node
+   *
+   * @return size_t The queue size
+   */
+  size_t getQueueSize() const { return slots - 1; }
+
+  /**
+   * @brief Send a job to a node, which admits it if it has room
+   *
+   * @param node The node's index
+   * @param arrival The job's arrival time (no earlier than the last one's)
+   * @param service The job's service time
+   * @param delay Set to the job's delay, if it was admitted
+   * @return true The job was admitted
+   */
+  bool enter(int node, double arrival, double service, double& delay);
+
+  /**
+   * @brief Start fetching a node into the cache, ahead of a job sent to it
+   *
+   * @param node The node's index
+   */
+  void prefetch(int node) const {
+    const char* at{reinterpret_cast<const char*>(&nodes[node])};
+    __builtin_prefetch(at);
+    __builtin_prefetch(at + sizeof(FleetNode) - 1);  // it may span two lines
+  }
+
+  /**
+   * @brief Get the service time a node has been given so far
+   *
+   * @param node The node's index
+   * @return double The busy time
+   */
+  double getBusyTime(int node) const { return nodes[node].busyTime; }
+
+  /**
+   * @brief Get a node's total delay per unit of time, which is its average
+   * queue length (as ServiceNode::calcAvgQueue())
+   *
+   * @param node The node's index
+   * @return double The average queue length (0 before the first job)
+   */
+  double getAvgQueue(int node) const {
+    const FleetNode& at{nodes[node]};
+    return at.numJobs > 0 ? at.totDelay / at.lastDeparture : 0.0;
+  }
+
+  /**
+   * @brief Get the number of jobs a node admitted
+   *
+   * @param node The node's index
+   * @return uint32_t The number of jobs
+   */
+  uint32_t getNumJobs(int node) const { return nodes[node].numJobs; }
+
+  /**
+   * @brief Get a node's utilization up to its last departure (as
+   * ServiceNode::getUtil())
+   *
+   * @param node The node's index
+   * @return double The utilization (0 before the first job)
+   */
+  double getUtil(int node) const {
+    const FleetNode& at{nodes[node]};
+    return at.numJobs > 0 ? at.busyTime / at.lastDeparture : 0.0;
+  }
+
+  /**
+   * @brief Get a node's mean delay
+   *
+   * @param node The node's index
+   * @return double The mean delay (0 before the first job)
+   */
+  double getAvgDelay(int node) const {
+    const FleetNode& at{nodes[node]};
+    return at.numJobs > 0 ? at.totDelay / at.numJobs : 0.0;
+  }
+
+  /**
+   * @brief Get the memory the node arrays take, per node
+   *
+   * @return double The bytes per node
+   */
+  double getBytesPerNode() const;
+
+ private:
+  // the number of jobs in a node at time t (counting up to slots at most)
+  size_t countJobs(const FleetNode& at, double t) const;
+
+  int nNodes;
+  size_t slots;     // the jobs a node holds: qSize waiting and one in service
+  size_t ringSize;  // the services kept, enough to count up to slots jobs
+
+  std::vector<FleetNode> nodes;
+};
+
+// The distribution of a per-node quantity across the nodes
+struct FleetSpread {
+  RunningStat stat;  // the mean and standard deviation
+  double min;        // the smallest value
+  double p1;         // the 1st percentile
+  double p50;        // the median
+  double p99;        // the 99th percentile
+  double max;        // the largest value
+  Histogram hist;    // the distribution of the values
+};
+
+// The outcome of a fleet run, aggregated instead of per node
+struct FleetResult {
+  int nNodes;            // the number of nodes
+  long long nJobs;       // the jobs sent to the fleet
+  long long rejects;     // the jobs no node had room for
+  double bytesPerNode;   // the memory of the nodes and the policy, per node
+  double loopSeconds;    // the wall time of the jobs, without the setup and
+                         // the statistics over the nodes
+  RunningStat delay;     // the delays of the admitted jobs
+  Histogram delayHist;   // the distribution of the delays
+  Histogram waitHist;    // the waits of the admitted jobs
+  FleetSpread util;      // across the nodes: the utilization
+  FleetSpread jobs;      // the jobs served
+  FleetSpread avgDelay;  // the mean delay
+};
+
+/**
+ * @brief Get the arrival rate that gives every node of a cluster a load
+ *
+ * @param nNodes The number of nodes
+ * @param load The offered load of a node (arrivals times the mean service,
+ * per node)
+ * @return double The rate, relative to the default (see setArrivalRate())
+ */
+double loadToRate(int nNodes, double load);
+
+/**
+ * @brief Run a multi-queue simulation of a fleet without any output
+ *
+ * Round-robin and random take O(1) per job, so their throughput stays flat
+ * as the fleet grows. Utilization based and least connections replay the
+ * matches of a tournament tree, O(log n) per job, so their time per job
+ * grows with the depth of the tree (see fleetTreeDepth()), and by one access
+ * to memory once the nodes outgrow the cache: a job's node is the winner of
+ * the previous job's update, too late to be fetched ahead of it. The jobs
+ * arrive at the current arrival rate.
+ *
+ * @param nNodes The number of nodes
+ * @param lba The node balancing
+ * @param qSize The room for waiting jobs of each node
+ * @param nJobs The number of jobs (at most FLEET_MAX_JOBS)
+ * @return FleetResult The aggregated statistics of the run
+ */
+FleetResult runFleet(int nNodes, lba_alg lba, size_t qSize, long long nJobs);
+
+/**
+ * @brief Get the depth of the tournament tree a policy places the jobs of a
+ * fleet through, which its time per job grows with
+ *
+ * @param nNodes The number of nodes
+ * @param lba The node balancing
+ * @return int The matches a job's update replays (0 for round-robin and
+ * random, which keep no tree)
+ */
+int fleetTreeDepth(int nNodes, lba_alg lba);
+
+/**
+ * @brief Run a fleet simulation and report the results
+ *
+ * Prints the run-wide delay and the spread of the per-node statistics, and
+ * writes their quantiles to fleet_<lba>.csv and their histograms to
+ * fleet_<lba>_hist.csv.
+ *
+ * @param nNodes The number of nodes
+ * @param lba The node balancing
+ * @param qSize The room for waiting jobs of each node
+ * @param nJobs The number of jobs (at most FLEET_MAX_JOBS)
+ * @param load The offered load of a node (0: the default arrival rate)
+ */
+void fleetSimulation(int nNodes, lba_alg lba, size_t qSize, long long nJobs,
+                     double load);
+
+#endif
@@ -0,0 +1,108 @@
+#include "Histogram.h"
+
+#include <cmath>
+
+const int Histogram::SUB_BITS;
+const int Histogram::MAX_EXP;
+const size_t Histogram::NUM_BUCKETS;
+constexpr double Histogram::RESOLUTION;
+
+// the number of buckets each power of two above the linear range is split in
+static const uint64_t HALF_SUB{1u << (Histogram::SUB_BITS - 1)};
+
+Histogram::Histogram() : total{0} { counts.fill(0); }
+
+size_t Histogram::bucketOf(uint64_t steps) {
+  if (steps < (1u << SUB_BITS)) return steps;
+  if (steps >> MAX_EXP) return NUM_BUCKETS - 1;
+
+  // the leading bit picks the power of two, the next SUB_BITS - 1 the bucket
+  int exp{63 - __builtin_clzll(steps)};
+  int shift{exp - (SUB_BITS - 1)};
+  return (1u << SUB_BITS) + (exp - SUB_BITS) * HALF_SUB +
+         ((steps >> shift) - HALF_SUB);
+}
+
+uint64_t Histogram::lowerBound(size_t idx) {
+  if (idx < (1u << SUB_BITS)) return idx;
+
+  size_t rest{idx - (1u << SUB_BITS)};
+  int exp{static_cast<int>(rest / HALF_SUB) + SUB_BITS};
+  uint64_t sub{rest % HALF_SUB + HALF_SUB};
+  return sub << (exp - (SUB_BITS - 1));
+}
+
+void Histogram::record(double t) {
+  double steps{t > 0.0 ? t / RESOLUTION : 0.0};
+  uint64_t n{steps < std::ldexp(1.0, MAX_EXP)
+                 ? static_cast<uint64_t>(steps + 0.5)
+                 : uint64_t{1} << MAX_EXP};
+  ++counts[bucketOf(n)];
+  ++total;
+}
+
+void Histogram::merge(const Histogram& other) {
+  for (size_t ii = 0; ii < NUM_BUCKETS; ii++) counts[ii] += other.counts[ii];
+  total += other.total;
+}
+
+void Histogram::clear() {
+  counts.fill(0);
+  total = 0;
+}
+
+void Histogram::saveState(SnapshotWriter& out) const {
+  // most buckets are empty, so only the others are written
+  uint32_t used{0};
+  for (uint64_t count : counts) used += count > 0;
+
+  out.put(used);
+  for (size_t ii = 0; ii < NUM_BUCKETS; ii++) {
+    if (counts[ii] == 0) continue;
+    out.put<uint32_t>(ii);
+    out.put(counts[ii]);
+  }
+}
+
+void Histogram::restoreState(SnapshotReader& in) {
+  clear();
+  uint32_t used{in.get<uint32_t>()};
+  for (uint32_t ii = 0; ii < used && in.isGood(); ii++) {
+    uint32_t idx{in.get<uint32_t>()};
+    uint64_t count{in.get<uint64_t>()};
+    if (idx >= NUM_BUCKETS) {
+      in.fail();
+      return;
+    }
+    addToBucket(idx, count);
+  }
+}
+
+uint64_t Histogram::getCount() const { return total; }
+
+double Histogram::getPercentile(double p) const {
+  if (total == 0) return 0.0;
+
+  // the rank of the percentile, counting from 1
+  double rank{std::ceil(p / 100.0 * total)};
+  if (rank < 1.0) rank = 1.0;
+
+  uint64_t seen{0};
+  for (size_t ii = 0; ii < NUM_BUCKETS; ii++) {
+    seen += counts[ii];
+    if (seen >= rank) {
+      uint64_t low{lowerBound(ii)};
+      uint64_t width{lowerBound(ii + 1) - low};
+      return (low + (width - 1) / 2.0) * RESOLUTION;
+    }
+  }
+
+  return lowerBound(NUM_BUCKETS - 1) * RESOLUTION;
+}
+
+uint64_t Histogram::getBucket(size_t idx) const { return counts[idx]; }
+
+void Histogram::addToBucket(size_t idx, uint64_t n) {
+  counts[idx] += n;
+  total += n;
+}
@@ -0,0 +1,122 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "Snapshot.h"
+
+// A fixed-size log-linear (HDR-style) histogram of non-negative times.
+//
+// Times are counted in RESOLUTION steps. The first 2^SUB_BITS steps each get
+// their own bucket; above that every power of two is split into
+// 2^(SUB_BITS - 1) buckets, so a bucket is never wider than 1/32 of the values
+// in it. Up to 2^MAX_EXP steps (about 35 years) fit in under 10 KB, whatever
+// the number of jobs. Recording is a plain increment into the owner's array
+// (no locks, no allocation); histograms kept by different nodes, threads or
+// replications are combined with merge().
+class Histogram {
+ public:
+  static const int SUB_BITS{6};
+  static const int MAX_EXP{40};
+  static const size_t NUM_BUCKETS{
+      (1u << SUB_BITS) + (MAX_EXP - SUB_BITS) * (1u << (SUB_BITS - 1))};
+  static constexpr double RESOLUTION{1e-3};  // one millisecond
+
+  /**
+   * @brief Construct an empty Histogram object
+   */
+  Histogram();
+
+  /**
+   * @brief Count a time
+   *
+   * Times beyond the range are counted in the last bucket.
+   *
+   * @param t The time in seconds (negative times count as 0)
+   */
+  void record(double t);
+
+  /**
+   * @brief Add the counts of another histogram to this one
+   *
+   * @param other The histogram to merge in
+   */
+  void merge(const Histogram& other);
+
+  /**
+   * @brief Forget all counts
+   */
+  void clear();
+
+  /**
+   * @brief Get the number of times counted
+   *
+   * @return uint64_t The number of times
+   */
+  uint64_t getCount() const;
+
+  /**
+   * @brief Get a percentile of the times
+   *
+   * The middle of the bucket holding the percentile is returned, which is
+   * within 1/64 of the true value.
+   *
+   * @param p The percentile, between 0 and 100
+   * @return double The time in seconds (0 if nothing was counted)
+   */
+  double getPercentile(double p) const;
+
+  /**
+   * @brief Get the count of a bucket
+   *
+   * @param idx The bucket's index (below NUM_BUCKETS)
+   * @return uint64_t The bucket's count
+   */
+  uint64_t getBucket(size_t idx) const;
+
+  /**
+   * @brief Add to the count of a bucket (to rebuild a stored histogram)
+   *
+   * @param idx The bucket's index (below NUM_BUCKETS)
+   * @param n The count to add
+   */
+  void addToBucket(size_t idx, uint64_t n);
+
+  /**
+   * @brief Get the bucket a number of steps falls in
+   *
+   * @param steps The time in RESOLUTION steps
+   * @return size_t The bucket's index
+   */
+  static size_t bucketOf(uint64_t steps);
+
+  /**
+   * @brief Get the smallest number of steps in a bucket
+   *
+   * @param idx The bucket's index
+   * @return uint64_t The bucket's lower bound in steps
+   */
+  static uint64_t lowerBound(size_t idx);
+
+  /**
+   * @brief Append the non-empty buckets to a checkpoint
+   *
+   * @param out The snapshot being written
+   */
+  void saveState(SnapshotWriter& out) const;
+
+  /**
+   * @brief Replace the counts with ones written by saveState()
+   *
+   * @param in The snapshot being read
+   */
+  void restoreState(SnapshotReader& in);
+
+ private:
+  std::array<uint64_t, NUM_BUCKETS> counts;
+  uint64_t total;
+};
+
+#endif
@@ -1,8 +1,9 @@
 #include "Job.h"
 
+#include "Profile.h"
 #include "rvgs.h"
 
-const long int SERVICE_MEAN{4049};
+Job::Job() : arrival{0}, delay{0}, service{0} {}
 
 Job::Job(double arrival) : arrival{arrival}, delay{0}, service{getService()} {
   // service needs to be generated via GetService
@@ -28,13 +29,33 @@ double Job::getServiceTime() const { return service; }
 double Job::getArrival() const { return arrival; }
 
 double Job::getService() {
+  PROF_SCOPE("Job::getService");
   // get an exponential random variate in seconds
   return Exponential(SERVICE_MEAN);  // 4049 sec. is mean random service time on
                                      // discovery -- switch to minutes?
 }
 
-double Job::calcWait() { return delay + service; }
+double Job::calcWait() const { return delay + service; }
 
-double Job::calcDeparture() { return arrival + calcWait(); }
+double Job::calcDeparture() const { return arrival + calcWait(); }
 
 double Job::getDelay() const { return delay; }
+
+Job Job::resentAt(double time) const {
+  Job job{*this};
+  job.arrival = time;
+  job.delay = 0.0;
+  return job;
+}
+
+void Job::saveState(SnapshotWriter& out) const {
+  out.put(arrival);
+  out.put(delay);
+  out.put(service);
+}
+
+void Job::restoreState(SnapshotReader& in) {
+  arrival = in.get<double>();
+  delay = in.get<double>();
+  service = in.get<double>();
+}
@@ -1,8 +1,21 @@
 #ifndef JOBS_H
 #define JOBS_H
 
+#include "Snapshot.h"
+
+// the mean service time in seconds (from the Discovery cluster data)
+const long int SERVICE_MEAN{4049};
+
 class Job {
  public:
+  /**
+   * @brief Construct an empty Job object
+   *
+   * The job arrives at 0 and needs no service. This is only meant as a
+   * placeholder in preallocated buffers (no random number is drawn).
+   */
+  Job();
+
   /**
    * @brief Construct a new Job object
    *
@@ -44,7 +57,7 @@ class Job {
    *
    * @return double
    */
-  double calcDeparture();
+  double calcDeparture() const;
 
   /**
    * @brief Get the Job's service time.
@@ -60,6 +73,14 @@ class Job {
    */
   double getArrival() const;
 
+  /**
+   * @brief Get the job as it is sent again later, to retry
+   *
+   * @param time The time it arrives again
+   * @return Job The job, with the same service time and no delay yet
+   */
+  Job resentAt(double time) const;
+
   /**
    * @brief Get a Job's delay.
    * 
@@ -67,6 +88,20 @@ class Job {
    */
   double getDelay() const;
 
+  /**
+   * @brief Append the job's times to a checkpoint
+   *
+   * @param out The snapshot being written
+   */
+  void saveState(SnapshotWriter& out) const;
+
+  /**
+   * @brief Replace the job's times with ones written by saveState()
+   *
+   * @param in The snapshot being read
+   */
+  void restoreState(SnapshotReader& in);
+
  private:
   /**
    * @brief Get the Service object
@@ -87,7 +122,7 @@ class Job {
    *
    * @return double The time waiting in a service node.
    */
-  double calcWait();
+  double calcWait() const;
 
   double arrival;  // a Jobs arrival time in seconds
   double delay;    // the time spent waiting for service to begin
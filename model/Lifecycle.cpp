@@ -0,0 +1,189 @@
+#include "Lifecycle.h"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#include "Job.h"
+#include "LoadBalancing.h"
+#include "Node.h"
+#include "PerfCounters.h"
+#include "Process.h"
+#include "Profile.h"
+#include "WallClock.h"
+#include "rvgs.h"
+
+// The cluster and the tallies the jobs share
+class Cluster {
+ public:
+  Cluster(int nNodes, lba_alg lba, size_t qSize, const LifecycleOptions& opts,
+          LifecycleResult& result)
+      : opts{opts},
+        result{result},
+        nodes(nNodes, Resource{1, qSize}),
+        policy{lba},
+        view{buildNodeList(nNodes, qSize)} {}
+
+  // the node for a job sent now, as the policy of LoadBalancing.h chooses it
+  int pick(const Job& job) { return policy.pick(view, job); }
+
+  // tell the policy's view that a job was sent to a node
+  void send(int node, const Job& job) {
+    Job sent{job};
+    view[node].enterNode(sent);
+  }
+
+  const LifecycleOptions& opts;
+  LifecycleResult& result;
+  std::vector<Resource> nodes;
+
+ private:
+  lba::AnyPolicy policy;
+  node_list view;  // the nodes as the jobs sent to them load them
+};
+
+// A job, from its arrival to its departure or rejection
+static Process jobProcess(FramePool& pool, Calendar& cal, Cluster& cluster,
+                          Job job) {
+  const LifecycleOptions& opts{cluster.opts};
+  LifecycleResult& result{cluster.result};
+  double arrival{job.getArrival()};
+  double service{job.getServiceTime()};
+
+  // find a node with room, backing off while they are full
+  Job sent{job};
+  int node{cluster.pick(sent)};
+  for (int tries = 0; cluster.nodes[node].isFull(); tries++) {
+    if (tries == opts.maxRetries) {
+      ++result.rejects;
+      co_return;
+    }
+    ++result.retries;
+    co_await cal.delay(Exponential(opts.backoff));
+    sent = job.resentAt(cal.now());
+    node = cluster.pick(sent);
+  }
+  cluster.send(node, sent);
+
+  // wait in line
+  co_await cluster.nodes[node].acquire();
+  double start{cal.now()};
+  result.delay.add(start - arrival);
+  result.delayHist.record(start - arrival);
+  result.nodeDelay[node] += start - arrival;
+
+  // run, saving the job's state every ckptInterval seconds of service
+  double left{service};
+  while (opts.ckptInterval > 0.0 && left > opts.ckptInterval) {
+    co_await cal.delay(opts.ckptInterval);
+    left -= opts.ckptInterval;
+    ++result.checkpoints;
+    co_await cal.delay(opts.ckptCost);
+  }
+  co_await cal.delay(left);
+
+  cluster.nodes[node].release(cal);
+  ++result.nodeJobs[node];
+  result.nodeHeld[node] += cal.now() - start;
+  result.waitHist.record(cal.now() - arrival);
+  if (cal.now() > result.endTime) result.endTime = cal.now();
+}
+
+// Starts the jobs at their arrivals, in frames of their own pool
+static Process arrivalProcess(FramePool& pool, FramePool& jobs, Calendar& cal,
+                              Cluster& cluster, long long nJobs) {
+  for (long long made = 0; made < nJobs; made++) {
+    Job job{getArrival()};
+    co_await cal.delay(job.getArrival() - cal.now());
+    cal.start(jobProcess(jobs, cal, cluster, job));
+  }
+}
+
+LifecycleResult runLifecycle(int nNodes, lba_alg lba, size_t qSize,
+                             long long nJobs, const LifecycleOptions& opts) {
+  PROF_SCOPE("runLifecycle");
+  PROF_COUNT("jobs", nJobs);
+  perfEnter(PerfPhase::setup);
+
+  LifecycleResult result;
+  result.nJobs = nJobs;
+  result.rejects = 0;
+  result.retries = 0;
+  result.checkpoints = 0;
+  result.nodeJobs.assign(nNodes, 0);
+  result.nodeHeld.assign(nNodes, 0.0);
+  result.nodeDelay.assign(nNodes, 0.0);
+  result.endTime = 0.0;
+
+  Cluster cluster{nNodes, lba, qSize, opts, result};
+  FramePool arrivals;
+  FramePool jobs;
+  Calendar cal;
+  cal.start(arrivalProcess(arrivals, jobs, cal, cluster, nJobs));
+
+  perfEnter(PerfPhase::steady);
+  double start{wallTime()};
+  cal.run();
+  result.loopSeconds = wallTime() - start;
+  perfAddJobs(PerfPhase::steady, nJobs);
+
+  result.events = cal.getHandled();
+  result.peakFrames = jobs.getPeak();
+  result.frameBytes = jobs.getBytes();
+  return result;
+}
+
+void lifecycleSimulation(int nNodes, lba_alg lba, size_t qSize,
+                         long long nJobs, const LifecycleOptions& opts) {
+  PROF_SCOPE("lifecycleSimulation");
+  LifecycleResult result{runLifecycle(nNodes, lba, qSize, nJobs, opts)};
+
+  double rejectRatio{(static_cast<double>(result.rejects) / nJobs) * 100};
+  std::cout << std::setprecision(5) << "Rejection amount: " << rejectRatio
+            << "%" << std::endl;
+  std::cout << "Retries: " << result.retries << ", checkpoints: "
+            << result.checkpoints << std::endl;
+  std::cout << "Delay: mean " << result.delay.getMean() << ", p50 "
+            << result.delayHist.getPercentile(50.0) << ", p99 "
+            << result.delayHist.getPercentile(99.0) << std::endl;
+  double nsPerEvent{result.events > 0
+                        ? result.loopSeconds * 1e9 / result.events
+                        : 0.0};
+  std::cout << "Events: " << result.events << " (" << nsPerEvent
+            << " ns each), at most " << result.peakFrames
+            << " jobs alive, " << result.frameBytes << " bytes of frames"
+            << std::endl;
+
+  std::string prefix{"lifecycle_" + LBA_NAMES[lba]};
+  std::ofstream data(prefix + ".csv");
+  data << "node,jobs,util,avg_d" << std::endl;
+  std::cout << std::setw(6) << "node" << std::setw(10) << "jobs"
+            << std::setw(12) << "util" << std::setw(12) << "avg_d"
+            << std::endl;
+  for (int node = 0; node < nNodes; node++) {
+    long long served{result.nodeJobs[node]};
+    double util{result.endTime > 0.0 ? result.nodeHeld[node] / result.endTime
+                                     : 0.0};
+    double avgDelay{served > 0 ? result.nodeDelay[node] / served : 0.0};
+    std::cout << std::setw(6) << node << std::setw(10) << served
+              << std::setw(12) << util << std::setw(12) << avgDelay
+              << std::endl;
+    data << node << "," << served << "," << util << "," << avgDelay
+         << std::endl;
+  }
+
+  // the run-wide percentiles, as accumPercentiles()
+  perfEnter(PerfPhase::output);
+  std::ofstream pct(prefix + "_pct.csv");
+  pct << "metric,n_jobs,p50,p90,p99,p999" << std::endl;
+  const Histogram* hists[]{&result.delayHist, &result.waitHist};
+  const char* histNames[]{"delay", "wait"};
+  for (int ii = 0; ii < 2; ii++) {
+    pct << histNames[ii] << "," << hists[ii]->getCount() << ","
+        << hists[ii]->getPercentile(50.0) << ","
+        << hists[ii]->getPercentile(90.0) << ","
+        << hists[ii]->getPercentile(99.0) << ","
+        << hists[ii]->getPercentile(99.9) << std::endl;
+  }
+  perfLeave();
+}
@@ -0,0 +1,79 @@
+#ifndef LIFECYCLE_H
+#define LIFECYCLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Histogram.h"
+#include "Simulation.h"
+#include "Stats.h"
+
+// What a job does besides waiting and running
+struct LifecycleOptions {
+  int maxRetries{0};        // the retries of a job that finds its node full
+                            // (0: it is rejected at once)
+  double backoff{60.0};     // the mean wait before a retry, in seconds
+  double ckptInterval{0.0};  // the service between two checkpoints (0: none)
+  double ckptCost{0.0};      // the time a checkpoint holds the server
+};
+
+// The outcome of a lifecycle run
+struct LifecycleResult {
+  long long nJobs;
+  long long rejects;               // the jobs that gave up
+  long long retries;               // over all the jobs
+  long long checkpoints;           // over all the jobs
+  RunningStat delay;               // from the arrival to the start of service
+  Histogram delayHist;             // of the delay
+  Histogram waitHist;              // from the arrival to the departure
+  std::vector<long long> nodeJobs;  // the jobs each node served
+  std::vector<double> nodeHeld;    // the time each node's server was held
+  std::vector<double> nodeDelay;   // the total delay of each node's jobs
+  double endTime;                  // of the last departure
+  uint64_t events;                 // the calendar events handled
+  size_t peakFrames;               // the most jobs alive at a time
+  size_t frameBytes;               // the memory of the frame pool
+  double loopSeconds;              // the wall time of the event loop
+};
+
+/**
+ * @brief Run the jobs of a multi-queue cluster as processes on a calendar
+ *
+ * Each job is a process: it picks a node with the algorithm, and if the node
+ * is full it backs off and retries, up to maxRetries times, before it gives
+ * up. Otherwise it waits in the node's line, runs its service (stopping to
+ * checkpoint every ckptInterval seconds of it), and leaves. The nodes are
+ * single FIFO servers with room for qSize waiting jobs.
+ *
+ * The policies are those of LoadBalancing.h. They choose from a view of the
+ * nodes that is sent every job placed, as a dispatcher's (MultiDispatch.h):
+ * utilbased by the service sent to each node, and leastcxns by the average
+ * queue of each node (or, without queues, the jobs it was sent).
+ *
+ * @param nNodes The number of nodes
+ * @param lba The algorithm
+ * @param qSize The room in each node's line
+ * @param nJobs The number of jobs
+ * @param opts What the jobs do besides waiting and running
+ * @return LifecycleResult The outcome
+ */
+LifecycleResult runLifecycle(int nNodes, lba_alg lba, size_t qSize,
+                             long long nJobs, const LifecycleOptions& opts);
+
+/**
+ * @brief Run the lifecycle model and print and write its outcome
+ *
+ * The per-node statistics are written to lifecycle_<alg>.csv, and the
+ * percentiles of the delay and the wait to lifecycle_<alg>_pct.csv.
+ *
+ * @param nNodes The number of nodes
+ * @param lba The algorithm
+ * @param qSize The room in each node's line
+ * @param nJobs The number of jobs
+ * @param opts What the jobs do besides waiting and running
+ */
+void lifecycleSimulation(int nNodes, lba_alg lba, size_t qSize,
+                         long long nJobs, const LifecycleOptions& opts);
+
+#endif
@@ -1,51 +1,246 @@
 #ifndef LOAD_BALANCING_ALGO_H
 #define LOAD_BALANCING_ALGO_H
 
+#include <cstdint>
 #include <vector>
-#include <functional>
 
 #include "Node.h"
+#include "Profile.h"
+#include "Snapshot.h"
+#include "rvgs.h"
 
+// The load-balancing policies.
+//
+// Every policy is a class with a pick() method and its own state, so two
+// simulations never share a round-robin cursor. The classes are templates on
+// the number of nodes: NODES > 0 fixes the count at compile time (for small
+// clusters, so the compiler can unroll the scans over the nodes), 0 takes it
+// from the node list. The run loops are compiled for each policy type (see
+// findRunLoops() in Simulation.h), so pick() is inlined into them.
+//
+// pick() takes the job by value, built from the arrival time, so it draws
+// the service time of a probe job like the dispatcher always did; the
+// random-number streams of the runs depend on that draw.
 namespace lba {
 /**
- * @brief Round-robin load-balancing algorithm
- * 
- * @param nodeList The list of available Service Nodes to choose from
- * @return int The Service Node chosen
- */
-int roundrobin(std::vector<ServiceNode> nodeList, Job job);
-
-/**
- * @brief Random load-balancing algorithm
+ * @brief Get the number of nodes a policy chooses from
  *
- * @param nodeList the list of available Service Nodes to choose from
- * @return int the chosen service node
+ * @tparam NODES The node count fixed at compile time (0: not fixed)
+ * @param nodeList The list of available Service Nodes
+ * @return size_t NODES, or the length of the list if it isn't fixed
  */
-int random(std::vector<ServiceNode> NodeList, Job job);
+template <int NODES>
+inline size_t nodeCount(const std::vector<ServiceNode>& nodeList) {
+  return NODES > 0 ? NODES : nodeList.size();
+}
 
-/**
- * @brief Utilization based load-balancing algorithm
- *
- * @param nodeList the list of available service nodes to choose from
- * @return int the chosen service node
- */
-int utilizationbased(std::vector<ServiceNode> nodeList, Job job);
+// The state a policy keeps from one choice to the next, as a checkpoint sees
+// it. The choices themselves are not virtual.
+class PolicyState {
+ public:
+  virtual ~PolicyState() = default;
+
+  /**
+   * @brief Append the policy's state to a snapshot
+   *
+   * @param out The snapshot being written
+   */
+  virtual void saveState(SnapshotWriter& out) const {}
+
+  /**
+   * @brief Restore the state written by saveState()
+   *
+   * @param in The snapshot being read
+   */
+  virtual void restoreState(SnapshotReader& in) {}
+};
+
+// Round-robin: the nodes take turns
+template <int NODES = 0>
+class RoundRobin final : public PolicyState {
+ public:
+  /**
+   * @brief Pick the node for a job
+   *
+   * @param nodeList The list of available Service Nodes to choose from
+   * @param job The job to place
+   * @return int The Service Node chosen
+   */
+  int pick(const std::vector<ServiceNode>& nodeList, Job job) {
+    PROF_SCOPE("lba::roundrobin");
+    int server = index;
+
+    // update index accounting for node_size
+    index++;
+    index %= nodeCount<NODES>(nodeList);
+
+    return server;
+  }
+
+  void saveState(SnapshotWriter& out) const override {
+    out.put<int32_t>(index);
+  }
+
+  void restoreState(SnapshotReader& in) override {
+    int saved{in.get<int32_t>()};
+    if (saved < 0 || (NODES > 0 && saved >= NODES)) in.fail();
+    if (in.isGood()) index = saved;
+  }
+
+ private:
+  int index{0};  // the node that gets the next job
+};
+
+// Random: every node is equally likely
+template <int NODES = 0>
+class Random final : public PolicyState {
+ public:
+  /**
+   * @brief Pick the node for a job
+   *
+   * @param nodeList the list of available Service Nodes to choose from
+   * @param job The job to place
+   * @return int the chosen service node
+   */
+  int pick(const std::vector<ServiceNode>& nodeList, Job job) {
+    PROF_SCOPE("lba::random");
+    // return a random server index
+    return Equilikely(0, nodeCount<NODES>(nodeList) - 1);
+  }
+};
 
 /**
- * @brief Least Connections load-balancing algorithms
- *
- * @param nodeList the list of available service nodes to choose from
- * @return int the chosen service node
+ * These two algorithms have an issue
+ * These algorithms assume that reading the queue length or
+ * Utilization retrieves the Nodes "current" status
+ * but since it is possible for jobs to have not entered these
+ * nodes for a long time, (maybe they are already full) they
+ * don'd update their utilization or queue length so they might
+ * never be picked again
  */
-int leastconnections(std::vector<ServiceNode> nodeList, Job job);
+
+// Utilization based: the node that would be the least utilized with the job
+template <int NODES = 0>
+class UtilizationBased final : public PolicyState {
+ public:
+  /**
+   * @brief Pick the node for a job
+   *
+   * @param nodeList the list of available service nodes to choose from
+   * @param job The job to place
+   * @return int the chosen service node
+   */
+  int pick(const std::vector<ServiceNode>& nodeList, Job job) {
+    PROF_SCOPE("lba::utilizationbased");
+    // NOTE: this should still work for both sqms and mqms
+    int least_utilized{0};
+
+    // find the index with the least utilization
+    // (the nodes' queues don't need processing first, the utilization only
+    // depends on the work sent to each node)
+    for (size_t ii = 0; ii < nodeCount<NODES>(nodeList); ii++) {
+      // check if this is less utilized
+      // NOTE: using calc util seems to make things better i.e. more balanced
+      if (nodeList[least_utilized].calcUtil(job) >
+          nodeList[ii].calcUtil(job)) {
+        least_utilized = ii;
+      }
+    }
+    return least_utilized;
+  }
+};
+
+// Least connections: the node with the shortest average queue (or, without
+// queues, the fewest jobs)
+template <int NODES = 0>
+class LeastConnections final : public PolicyState {
+ public:
+  /**
+   * @brief Pick the node for a job
+   *
+   * @param nodeList the list of available service nodes to choose from
+   * @param job The job to place
+   * @return int the chosen service node
+   */
+  int pick(const std::vector<ServiceNode>& nodeList, Job job) {
+    PROF_SCOPE("lba::leastconnections");
+    // NOTE: Not sure how to rework for sqms. Perhaps a condition on the model
+    // type could work. Perhaps number of jobs processed by this node?
+    int least_connections{0};
+
+    // get the maximum queue lengh for the nodes in the list
+    int max_queue_size{nodeList[0].getMaxQueueLen()};
+
+    // pick a node from nodes with a queue
+    if (max_queue_size > 0) {
+      // find the index with the least number of jobs
+      for (size_t ii = 0; ii < nodeCount<NODES>(nodeList); ii++) {
+        // use the average queue lengths of nodes to determine best node
+        // for a job
+        if (nodeList[least_connections].calcAvgQueue() >
+            nodeList[ii].calcAvgQueue()) {
+          least_connections = ii;
+        }
+      }
+    } else {  // pick a node from those without queues
+      for (size_t ii = 0; ii < nodeCount<NODES>(nodeList); ii++) {
+        if (nodeList[least_connections].getNumProcJobs() >
+            nodeList[ii].getNumProcJobs()) {
+          least_connections = ii;
+        }
+      }
+    }
+
+    return least_connections;
+  }
+};
+
+// Any of the policies, chosen at run time and switchable between two jobs.
+// Used where the algorithm isn't known when the code is compiled: behind a
+// std::function, and in runs whose what-if branches change the algorithm.
+class AnyPolicy final : public PolicyState {
+ public:
+  /**
+   * @brief Construct a new Any Policy object
+   *
+   * @param lba The algorithm, an index into LBA_NAMES
+   */
+  explicit AnyPolicy(int lba);
+
+  /**
+   * @brief Switch to another algorithm (each keeps its own state)
+   *
+   * @param lba The algorithm, an index into LBA_NAMES
+   */
+  void select(int lba);
+
+  /**
+   * @brief Pick the node for a job with the current algorithm
+   *
+   * @param nodeList The list of available Service Nodes to choose from
+   * @param job The job to place
+   * @return int The Service Node chosen
+   */
+  int pick(const std::vector<ServiceNode>& nodeList, Job job);
+
+  void saveState(SnapshotWriter& out) const override;
+  void restoreState(SnapshotReader& in) override;
+
+ private:
+  int lba;  // the current algorithm
+  RoundRobin<> roundRobin;
+  Random<> random;
+  UtilizationBased<> utilizationBased;
+  LeastConnections<> leastConnections;
+};
 
 /**
  * @brief Function to test the currenct implementation of the system
- * 
- * @param nodeList 
- * @return int 
+ *
+ * @param nodeList
+ * @return int
  */
-int testLBA(std::vector<ServiceNode> nodeList, Job hob);
+int testLBA(const std::vector<ServiceNode>& nodeList, Job job);
 }  // namespace lba
 
 
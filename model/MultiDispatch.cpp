@@ -0,0 +1,196 @@
+#include "MultiDispatch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "Job.h"
+#include "LoadBalancing.h"
+#include "Node.h"
+#include "PerfCounters.h"
+#include "Profile.h"
+#include "WallClock.h"
+#include "WindowBarrier.h"
+#include "rvgs.h"
+
+// A job and the choice made for it
+struct DispatchedJob {
+  Job job;     // its arrival and service
+  Job probe;   // the policy's probe job, drawn in runMqms()'s order
+  int node;    // the node chosen (-1: not yet)
+  int sender;  // the dispatcher it was dealt to
+};
+
+// A balancer instance: its policy and its view of the nodes
+class Dispatcher {
+ public:
+  Dispatcher(lba_alg lba, int nNodes, size_t qSize)
+      : policy{lba}, view{buildNodeList(nNodes, qSize)} {}
+
+  // copy the nodes' load into the view (an exchange)
+  void sync(const node_list& nodes) {
+    for (size_t ii = 0; ii < nodes.size(); ii++) view[ii].copyLoad(nodes[ii]);
+  }
+
+  // choose the nodes of this dispatcher's jobs, in the order they arrived
+  void route(std::vector<DispatchedJob>& jobs) {
+    for (size_t idx : mine) {
+      DispatchedJob& dispatched{jobs[idx]};
+      if (dispatched.node < 0) {
+        dispatched.node = policy.pick(view, dispatched.probe);
+      }
+      // the dispatcher knows what it sent, but not what the others did
+      Job sent{dispatched.job};
+      view[dispatched.node].enterNode(sent);
+    }
+    mine.clear();
+  }
+
+  std::vector<size_t> mine;  // its jobs of the interval
+
+ private:
+  lba::AnyPolicy policy;
+  node_list view;
+};
+
+SimResult runDispatchers(int nNodes, lba_alg lba, size_t qSize,
+                         long long nJobs, const DispatchConfig& config,
+                         DispatchReport* report) {
+  PROF_SCOPE("runDispatchers");
+  PROF_COUNT("jobs", nJobs);
+  perfEnter(PerfPhase::setup);
+
+  node_list nodes{buildNodeList(nNodes, qSize)};
+  int nDispatchers{std::max(1, config.dispatchers)};
+  std::vector<Dispatcher> dispatchers(nDispatchers,
+                                      Dispatcher{lba, nNodes, qSize});
+
+  // the interval each node last got a job in, and from which dispatcher
+  std::vector<long long> lastSync(nNodes, -1);
+  std::vector<int> lastSender(nNodes, -1);
+
+  // the main thread runs the first share of the dispatchers, and a helper
+  // thread each of the others
+  int nThreads{std::max(1, std::min(config.threads, nDispatchers))};
+  WindowBarrier barrier{nThreads};
+  bool isDone{false};
+  std::vector<DispatchedJob> jobs;
+  auto runShare = [&](int worker) {
+    for (int at = worker; at < nDispatchers; at += nThreads) {
+      dispatchers[at].sync(nodes);
+      dispatchers[at].route(jobs);
+    }
+  };
+  std::vector<std::thread> helpers;
+  for (int worker = 1; worker < nThreads; worker++) {
+    helpers.emplace_back([&, worker]() {
+      for (;;) {
+        barrier.wait();  // the interval's jobs have been drawn
+        if (isDone) return;
+        runShare(worker);
+        barrier.wait();  // every dispatcher has chosen
+      }
+    });
+  }
+
+  // draw a job with the random numbers of runMqms()'s loop: the arrival,
+  // the service, the policy's probe, and random's node
+  auto draw = [&]() {
+    DispatchedJob dispatched{Job{getArrival()}, Job{}, -1, 0};
+    dispatched.probe = Job{dispatched.job.getArrival()};
+    if (lba == 1) dispatched.node = Equilikely(0, nNodes - 1);
+    return dispatched;
+  };
+
+  perfEnter(PerfPhase::steady);
+  double start{wallTime()};
+  long long syncs{0};
+  long long herded{0};
+  long long totalRejects{0};
+  long long made{0};
+  DispatchedJob pending{};
+  if (nJobs > 0) {
+    pending = draw();
+    made = 1;
+  }
+  bool hasPending{made > 0};
+  while (hasPending) {
+    // the interval of the next job (the intervals without jobs are skipped)
+    double index{
+        std::floor((pending.job.getArrival() - START) / config.syncDt)};
+    double syncEnd{START + (index + 1.0) * config.syncDt};
+
+    // deal the interval's jobs to the dispatchers in turn
+    do {
+      pending.sender = (made - 1) % nDispatchers;
+      dispatchers[pending.sender].mine.push_back(jobs.size());
+      jobs.push_back(pending);
+      hasPending = made < nJobs;
+      if (hasPending) {
+        pending = draw();
+        ++made;
+      }
+    } while (hasPending && pending.job.getArrival() < syncEnd);
+
+    barrier.wait();
+    runShare(0);
+    barrier.wait();
+
+    // the jobs enter the nodes in the order they arrived
+    for (DispatchedJob& dispatched : jobs) {
+      int node{dispatched.node};
+      if (lastSync[node] == syncs && lastSender[node] != dispatched.sender) {
+        ++herded;
+      }
+      lastSync[node] = syncs;
+      lastSender[node] = dispatched.sender;
+
+      if (!nodes[node].enterNode(dispatched.job)) ++totalRejects;
+    }
+    jobs.clear();
+    ++syncs;
+  }
+  isDone = true;
+  barrier.wait();
+  for (std::thread& helper : helpers) helper.join();
+  double loopSeconds{wallTime() - start};
+
+  perfAddJobs(PerfPhase::steady, nJobs);
+  perfEnter(PerfPhase::output);
+
+  SimResult result{Model::mqms, collectStats(nodes), totalRejects, nJobs, 0,
+                   WarmupReport{}};
+  collectHistograms(nodes, result);
+
+  if (report) {
+    report->syncs = syncs;
+    report->herded = herded;
+    report->threads = nThreads;
+    report->loopSeconds = loopSeconds;
+  }
+  return result;
+}
+
+void dispatchersSimulation(int nNodes, lba_alg lba, size_t qSize,
+                           long long nJobs, const DispatchConfig& config) {
+  PROF_SCOPE("dispatchersSimulation");
+  std::string funcName{LBA_NAMES[lba]};
+  DispatchReport report;
+  SimResult result{runDispatchers(nNodes, lba, qSize, nJobs, config, &report)};
+  perfEnter(PerfPhase::output);
+
+  printStats(result.stats, result.totalRejects, result.nJobs);
+  double herdPct{nJobs > 0 ? 100.0 * report.herded / nJobs : 0.0};
+  std::cout << "Dispatchers: " << std::max(1, config.dispatchers) << " on "
+            << report.threads << " threads, " << report.syncs
+            << " exchanges every " << config.syncDt << " s, " << herdPct
+            << "% of the jobs herded, " << report.loopSeconds << " s"
+            << std::endl;
+
+  accumStats(result.stats, nJobs, Model::mqms, funcName);
+  accumPercentiles(result, funcName);
+  log_sim(funcName, nNodes, qSize, nJobs, result.stats);
+  perfLeave();
+}
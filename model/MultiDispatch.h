@@ -0,0 +1,65 @@
+#ifndef MULTI_DISPATCH_H
+#define MULTI_DISPATCH_H
+
+#include "Simulation.h"
+
+// How the arrivals are shared by several dispatchers
+struct DispatchConfig {
+  int dispatchers{1};   // the balancer instances
+  double syncDt{60.0};  // the time between two exchanges of their views
+  int threads{1};       // the threads the dispatchers are spread over
+};
+
+// How a multi-dispatcher run went
+struct DispatchReport {
+  long long syncs;     // the exchanges with jobs after them
+  long long herded;    // the jobs sent to a node another dispatcher had
+                       // also sent a job to since the last exchange
+  int threads;         // the threads that ran the dispatchers
+  double loopSeconds;  // the wall time of the run's loop
+};
+
+/**
+ * @brief Run the multi-queue model with several dispatchers, each with its
+ * own view of the nodes
+ *
+ * The jobs are dealt to the dispatchers in turn. A dispatcher chooses with
+ * the algorithm on its view: a node table of its own, with the nodes' load
+ * copied in at the last exchange, which its own jobs then enter. What the
+ * other dispatchers sent since is missing from it, so with leastcxns and
+ * utilbased they can all send their jobs to the node that looked the least
+ * loaded (a herd).
+ *
+ * The views are exchanged every syncDt seconds. Between two exchanges a
+ * dispatcher only reads its own view, so the dispatchers run in parallel
+ * on their threads; then the jobs enter the nodes in the order they
+ * arrived. The random numbers are drawn in the order of runMqms(), so with
+ * one dispatcher the run is identical to runMqms(), and any run is
+ * identical whatever the number of threads.
+ *
+ * @param nNodes The number of nodes
+ * @param lba The algorithm of every dispatcher
+ * @param qSize The queue size of each node
+ * @param nJobs The number of jobs
+ * @param config The dispatchers, exchange interval and threads
+ * @param report If not null, filled with how the run went
+ * @return SimResult The result, as runMqms() returns it
+ */
+SimResult runDispatchers(int nNodes, lba_alg lba, size_t qSize,
+                         long long nJobs, const DispatchConfig& config,
+                         DispatchReport* report = nullptr);
+
+/**
+ * @brief Run the multi-dispatcher model, and print and write its results as
+ * mqmsSimulation() does
+ *
+ * @param nNodes The number of nodes
+ * @param lba The algorithm of every dispatcher
+ * @param qSize The queue size of each node
+ * @param nJobs The number of jobs
+ * @param config The dispatchers, exchange interval and threads
+ */
+void dispatchersSimulation(int nNodes, lba_alg lba, size_t qSize,
+                           long long nJobs, const DispatchConfig& config);
+
+#endif
@@ -3,27 +3,60 @@
 #include <iomanip>
 
 #include "Job.h"
+#include "Profile.h"
 
 ServiceNode::ServiceNode(int id)
     : id{id},
       util{0},
       maxQueueSz{0},
-      totST{0},
       numJobsProcessed{0},
       lastDeparture{0.0},
-      totDelay{0.0} {}
+      serviceDeparture{0.0} {}
 
 ServiceNode::ServiceNode(int id, size_t maxQueueSz)
     : id{id},
       util{0},
       maxQueueSz{maxQueueSz},
-      totST{0},
       numJobsProcessed{0},
       lastDeparture{0.0},
-      totDelay{0.0} {}
+      serviceDeparture{0.0} {}
+
+void ServiceNode::reset(int id, size_t maxQueueSz) {
+  this->id = id;
+  this->maxQueueSz = maxQueueSz;
+  util = 0;
+  totST.clear();
+  numJobsProcessed = 0;
+  lastDeparture = 0.0;
+  serviceDeparture = 0.0;
+  totDelay.clear();
+  acc.delay.clear();
+  acc.wait.clear();
+  acc.service.clear();
+  acc.queue.clear();
+  acc.busy.clear();
+  acc.delayHist.clear();
+  acc.waitHist.clear();
+
+  // pop instead of swapping, which keeps the queue's block around
+  while (!jobQueue.empty()) jobQueue.pop();
+  while (!pending.empty()) pending.pop();
+}
+
+void ServiceNode::copyLoad(const ServiceNode& other) {
+  id = other.id;
+  util = other.util;
+  jobQueue = other.jobQueue;
+  maxQueueSz = other.maxQueueSz;
+  totST = other.totST;
+  numJobsProcessed = other.numJobsProcessed;
+  lastDeparture = other.lastDeparture;
+  serviceDeparture = other.serviceDeparture;
+  totDelay = other.totDelay;
+}
 
 void ServiceNode::updateUtil(double mostRecentDep) {
-  util = (totST / mostRecentDep);
+  util = (totST.getSum() / mostRecentDep);
 }
 
 bool ServiceNode::enterQueue(Job& job) {
@@ -42,7 +75,8 @@ bool ServiceNode::enterQueue(Job& job) {
   return false;
 }
 
-bool ServiceNode::enterNode(Job job) {
+bool ServiceNode::enterNode(Job& job) {
+  PROF_SCOPE("ServiceNode::enterNode");
   double currArrival{job.getArrival()};
   if (maxQueueSz > 0) {
     processQueue(currArrival);
@@ -69,7 +103,8 @@ bool ServiceNode::enterNode(Job job) {
     ++numJobsProcessed;                 // this Job can be processed
     updateTotST(job.getServiceTime());  // increase the total ST
     updateUtil(job.calcDeparture());    // update utilization
-    totDelay += job.getDelay();         // update the delay.
+    totDelay.add(job.getDelay());       // update the delay.
+    recordJob(job);
     // update the last Job's departure time
     lastDeparture = job.calcDeparture();
 
@@ -85,6 +120,7 @@ bool ServiceNode::enterNode(Job job) {
 }
 
 void ServiceNode::processQueue(double currArrival) {
+  PROF_SCOPE("ServiceNode::processQueue");
   if (jobQueue.size() > 0) {
     // get the most recent arrival time (back of queue)
     // double currentTime{jobQueue.back().getArrival()};
@@ -117,29 +153,31 @@ double ServiceNode::getUtil() const { return util; }
 
 int ServiceNode::getQueueLength() const { return jobQueue.size(); }
 
-double ServiceNode::calcAvgSt() const { return totST / numJobsProcessed; }
+double ServiceNode::calcAvgSt() const {
+  return totST.getSum() / numJobsProcessed;
+}
 
 double ServiceNode::updateTotST(double lastST) {
-  totST = totST + lastST;
-  return totST;
+  totST.add(lastST);
+  return totST.getSum();
 }
 
-int ServiceNode::getNumProcJobs() const { return numJobsProcessed; }
+long long ServiceNode::getNumProcJobs() const { return numJobsProcessed; }
 
 double ServiceNode::calcAvgQueue() const {
   double avgQ{0};
   if (numJobsProcessed > 0) {
-    avgQ = totDelay / lastDeparture;
+    avgQ = totDelay.getSum() / lastDeparture;
   }
   return avgQ;
 }
 
-double ServiceNode::calcUtil(Job job) {
+double ServiceNode::calcUtil(const Job& job) const {
   double departure{job.calcDeparture()};  // the jobs departure time
   double st{job.getServiceTime()};        // the jobs service time
 
   // calculate a temporary average service time
-  double tempSt{(totST + st)};
+  double tempSt{(totST.getSum() + st)};
 
   // calculate a temporary utilization
   double tempUtil{tempSt / departure};
@@ -147,25 +185,186 @@ double ServiceNode::calcUtil(Job job) {
   return tempUtil;
 }
 
-double ServiceNode::calcAvgDelay() const { return totDelay / numJobsProcessed; }
+double ServiceNode::calcAvgDelay() const {
+  return totDelay.getSum() / numJobsProcessed;
+}
 
 int ServiceNode::getMaxQueueLen() const { return maxQueueSz; }
 
-std::ostream& operator<<(std::ostream& out, const ServiceNode& node) {
+void ServiceNode::setMaxQueueLen(size_t maxQueueSz) {
+  this->maxQueueSz = maxQueueSz;
+}
+
+void ServiceNode::applyEvents(event_queue& events, TimeAverage& queue,
+                              TimeAverage& busy, double t) {
+  while (!events.empty() && events.top().time <= t) {
+    const NodeEvent& event{events.top()};
+    queue.update(event.time, event.dQueue);
+    busy.update(event.time, event.dBusy);
+    events.pop();
+  }
+}
+
+void ServiceNode::recordJob(const Job& job) {
+  PROF_SCOPE("ServiceNode::recordJob");
+  double arrival{job.getArrival()};
+  double start{arrival + job.getDelay()};
+  double departure{job.calcDeparture()};
+
+  acc.delay.add(job.getDelay());
+  acc.wait.add(departure - arrival);
+  acc.service.add(job.getServiceTime());
+  acc.delayHist.record(job.getDelay());
+  acc.waitHist.record(departure - arrival);
+
+  // bring the time averages up to this arrival, then schedule the job's own
+  // changes: it waits until start and is in service until departure
+  applyEvents(pending, acc.queue, acc.busy, arrival);
+  if (start > arrival) {
+    acc.queue.update(arrival, 1);
+    pending.push(NodeEvent{start, -1, 1});
+  } else {
+    acc.busy.update(arrival, 1);
+  }
+  pending.push(NodeEvent{departure, 0, -1});
+}
+
+void ServiceNode::resetStats(double now) {
+  applyEvents(pending, acc.queue, acc.busy, now);
+  acc.queue.restart(now);
+  acc.busy.restart(now);
+  acc.delay.clear();
+  acc.wait.clear();
+  acc.service.clear();
+  acc.delayHist.clear();
+  acc.waitHist.clear();
+}
+
+NodeStats ServiceNode::getStats() const {
+  NodeStats stats;
+  stats.id = id;
+  stats.maxQueueLen = maxQueueSz;
+
+  // play the rest of the changes out on copies, up to the last departure
+  event_queue events{pending};
+  TimeAverage queue{acc.queue};
+  TimeAverage busy{acc.busy};
+  applyEvents(events, queue, busy, lastDeparture);
+  queue.advance(lastDeparture);
+  busy.advance(lastDeparture);
+
+  stats.nJobs = acc.service.getCount();
+  stats.util = busy.getMean();
+  stats.avgSt = acc.service.getMean();
+  stats.avgQ = queue.getMean();
+  stats.avgD = acc.delay.getMean();
+  stats.sdSt = acc.service.getStdDev();
+  stats.avgW = acc.wait.getMean();
+  stats.sdW = acc.wait.getStdDev();
+  stats.sdD = acc.delay.getStdDev();
+  stats.pD50 = acc.delayHist.getPercentile(50.0);
+  stats.pD99 = acc.delayHist.getPercentile(99.0);
+  stats.pD999 = acc.delayHist.getPercentile(99.9);
+  stats.pW50 = acc.waitHist.getPercentile(50.0);
+  stats.pW99 = acc.waitHist.getPercentile(99.0);
+  stats.pW999 = acc.waitHist.getPercentile(99.9);
+
+  return stats;
+}
+
+const Histogram& ServiceNode::getDelayHist() const { return acc.delayHist; }
+
+const Histogram& ServiceNode::getWaitHist() const { return acc.waitHist; }
+
+void ServiceNode::advanceTo(double t) {
+  // the averages themselves run to the last change, as in getStats()
+  applyEvents(pending, acc.queue, acc.busy, t);
+}
+
+double ServiceNode::getQueueLevel() const { return acc.queue.getLevel(); }
+
+double ServiceNode::getBusyLevel() const { return acc.busy.getLevel(); }
+
+double ServiceNode::getUtilSoFar() const { return acc.busy.getMean(); }
+
+void ServiceNode::saveState(SnapshotWriter& out) const {
+  out.put(id);
+  out.put(util);
+  out.put<uint64_t>(maxQueueSz);
+  totST.saveState(out);
+  out.put(numJobsProcessed);
+  out.put(lastDeparture);
+  out.put(serviceDeparture);
+  totDelay.saveState(out);
+
+  // the queues only give access to their front, so go through copies
+  std::queue<Job> jobs{jobQueue};
+  out.put<uint64_t>(jobs.size());
+  for (; !jobs.empty(); jobs.pop()) jobs.front().saveState(out);
+
+  // the changes come out in time order; the order of simultaneous ones
+  // doesn't matter to the time averages
+  event_queue events{pending};
+  out.put<uint64_t>(events.size());
+  for (; !events.empty(); events.pop()) out.put(events.top());
+
+  acc.delay.saveState(out);
+  acc.wait.saveState(out);
+  acc.service.saveState(out);
+  acc.queue.saveState(out);
+  acc.busy.saveState(out);
+  acc.delayHist.saveState(out);
+  acc.waitHist.saveState(out);
+}
+
+void ServiceNode::restoreState(SnapshotReader& in) {
+  id = in.get<int>();
+  util = in.get<double>();
+  maxQueueSz = in.get<uint64_t>();
+  totST.restoreState(in);
+  numJobsProcessed = in.get<long long>();
+  lastDeparture = in.get<double>();
+  serviceDeparture = in.get<double>();
+  totDelay.restoreState(in);
+
+  while (!jobQueue.empty()) jobQueue.pop();
+  size_t nJobs{in.getCount(3 * sizeof(double))};
+  for (size_t ii = 0; ii < nJobs; ii++) {
+    Job job;
+    job.restoreState(in);
+    jobQueue.push(job);
+  }
+
+  while (!pending.empty()) pending.pop();
+  size_t nEvents{in.getCount(sizeof(NodeEvent))};
+  for (size_t ii = 0; ii < nEvents; ii++) pending.push(in.get<NodeEvent>());
+
+  acc.delay.restoreState(in);
+  acc.wait.restoreState(in);
+  acc.service.restoreState(in);
+  acc.queue.restoreState(in);
+  acc.busy.restoreState(in);
+  acc.delayHist.restoreState(in);
+  acc.waitHist.restoreState(in);
+}
+
+std::ostream& operator<<(std::ostream& out, const NodeStats& stats) {
   // choose to print the delay and queue length.
-  if (node.getMaxQueueLen() > 0) {
-    out << "ID: " << std::setw(2) << node.getId() << ", util: " << std::setw(7)
-        << node.getUtil() << ", njobs: " << std::setw(6)
-        << node.getNumProcJobs() << ", avg_s: " << std::setw(6)
-        << node.calcAvgSt() << ", avg_q: " << std::setw(4)
-        << node.calcAvgQueue() << ", avg_d: " << std::setw(6)
-        << node.calcAvgDelay();
+  if (stats.maxQueueLen > 0) {
+    out << "ID: " << std::setw(2) << stats.id << ", util: " << std::setw(7)
+        << stats.util << ", njobs: " << std::setw(6) << stats.nJobs
+        << ", avg_s: " << std::setw(6) << stats.avgSt
+        << ", avg_q: " << std::setw(4) << stats.avgQ
+        << ", avg_d: " << std::setw(6) << stats.avgD;
   } else { // don't print delay and queue len if there's no queue
-    out << "ID: " << std::setw(2) << node.getId() << ", util: " << std::setw(7)
-        << node.getUtil() << ", njobs: " << std::setw(6)
-        << node.getNumProcJobs() << ", avg_s: " << std::setw(6)
-        << node.calcAvgSt();
+    out << "ID: " << std::setw(2) << stats.id << ", util: " << std::setw(7)
+        << stats.util << ", njobs: " << std::setw(6) << stats.nJobs
+        << ", avg_s: " << std::setw(6) << stats.avgSt;
   }
 
   return out;
+}
+
+std::ostream& operator<<(std::ostream& out, const ServiceNode& node) {
+  return out << node.getStats();
 }
\ No newline at end of file
@@ -1,10 +1,35 @@
 #ifndef MY_NODE_H
 #define MY_NODE_H
 
+#include <functional>
 #include <iostream>
 #include <queue>
+#include <vector>
 
+#include "Histogram.h"
 #include "Job.h"
+#include "Stats.h"
+
+// A snapshot of a Service Node's statistics, as reported at the end of a run.
+struct NodeStats {
+  int id;           // the Service Node's ID
+  int maxQueueLen;  // the maximum queue size of the node
+  double util;      // the utilization (time-averaged jobs in service)
+  double avgSt;     // the average service time
+  double avgQ;      // the average queue length (time-averaged)
+  double avgD;      // the average delay
+  long long nJobs;  // the number of jobs processed
+  double sdSt;      // the standard deviation of the service time
+  double avgW;      // the average wait (delay plus service)
+  double sdW;       // the standard deviation of the wait
+  double sdD;       // the standard deviation of the delay
+  double pD50;      // the median delay
+  double pD99;      // the 99th percentile of the delay
+  double pD999;     // the 99.9th percentile of the delay
+  double pW50;      // the median wait
+  double pW99;      // the 99th percentile of the wait
+  double pW999;     // the 99.9th percentile of the wait
+};
 
 // A service node is both a server and a queue.
 // If the service node doesn't have a queue (a la single-queue, multi-server),
@@ -34,6 +59,28 @@ class ServiceNode {
 
   // ~ServiceNode();
 
+  /**
+   * @brief Return the Service Node to the state it was constructed in
+   *
+   * The memory already held by the queue is kept, so a node table can be
+   * reused from one simulation to the next without allocating again.
+   *
+   * @param id The Service Node's ID
+   * @param maxQueueSz The maximum size of the Service Node's queue
+   */
+  void reset(int id, size_t maxQueueSz);
+
+  /**
+   * @brief Take over another node's load: its queue, totals and departures
+   *
+   * The statistics (getStats(), the histograms) are left as they are. Used
+   * for a dispatcher's view of a node, which the policies read and which
+   * the dispatcher's own jobs enter, without copying the histograms.
+   *
+   * @param other The node to copy the load from
+   */
+  void copyLoad(const ServiceNode& other);
+
   /**
    * @brief Update the Service Node server's utilization
    *
@@ -63,11 +110,11 @@ class ServiceNode {
    * Given a job, determine if this job can actually enter the ServiceNode. If
    * the node is busy, then check if there's space to wait in the queue.
    * 
-   * @param job The Job attempting to enter the ServiceNode
+   * @param job The Job attempting to enter the ServiceNode (its delay is set)
    * @return true If a job is able to be worked on here.
    * @return false If this node is full/busy
    */
-  bool enterNode(Job job);
+  bool enterNode(Job& job);
 
   /**
    * @brief Get the Service Node's ID
@@ -105,9 +152,9 @@ class ServiceNode {
   /**
    * @brief Get the number of jobs processed by this node.
    * 
-   * @return int The number of jobs processed
+   * @return long long The number of jobs processed
    */
-  int getNumProcJobs() const;
+  long long getNumProcJobs() const;
   
   /**
    * @brief Calculate the average service time.
@@ -137,7 +184,7 @@ class ServiceNode {
    * @param job The job to use for the calculation
    * @return double The utilization
    */
-  double calcUtil(Job job);
+  double calcUtil(const Job& job) const;
 
   /**
    * @brief Calculate the average delay for jobs in the node
@@ -153,7 +200,131 @@ class ServiceNode {
    */
   int getMaxQueueLen() const;
 
+  /**
+   * @brief Change the maximum queue size, keeping the jobs already queued
+   *
+   * A smaller size only turns arrivals away until the queue has drained.
+   *
+   * @param maxQueueSz The new maximum queue size
+   */
+  void setMaxQueueLen(size_t maxQueueSz);
+
+  /**
+   * @brief Restart the reported statistics from the given time.
+   *
+   * Only the statistics returned by getStats() are affected, the state that
+   * the load-balancing algorithms look at is left as is. This is used to drop
+   * the initial transient of a simulation. Jobs that are still waiting or in
+   * service at that time count towards the time averages from then on.
+   *
+   * @param now The current simulation time
+   */
+  void resetStats(double now);
+
+  /**
+   * @brief Get the statistics collected since the last resetStats().
+   *
+   * The time averages run up to the departure of the last job.
+   *
+   * @return NodeStats The statistics of this node
+   */
+  NodeStats getStats() const;
+
+  /**
+   * @brief Get the histogram of the delays since the last resetStats().
+   *
+   * @return const Histogram& The delay histogram
+   */
+  const Histogram& getDelayHist() const;
+
+  /**
+   * @brief Get the histogram of the waits since the last resetStats().
+   *
+   * @return const Histogram& The wait (delay plus service) histogram
+   */
+  const Histogram& getWaitHist() const;
+
+  /**
+   * @brief Apply the queue and server changes due up to a time
+   *
+   * Nodes are only updated when a job arrives at them; this brings an idle
+   * node's levels up to date, e.g. before they are sampled.
+   *
+   * @param t The current simulation time
+   */
+  void advanceTo(double t);
+
+  /**
+   * @brief Get the number of jobs waiting in the queue
+   *
+   * @return double The queue length, as of the last update
+   */
+  double getQueueLevel() const;
+
+  /**
+   * @brief Get the number of jobs in service
+   *
+   * @return double The jobs in service, as of the last update
+   */
+  double getBusyLevel() const;
+
+  /**
+   * @brief Get the utilization since the last resetStats()
+   *
+   * @return double The time-averaged number of jobs in service, up to the
+   * last change applied
+   */
+  double getUtilSoFar() const;
+
+  /**
+   * @brief Append the node's whole state to a checkpoint
+   *
+   * That is its queue, the changes still pending and every accumulator, so a
+   * restored node carries on exactly as this one would have.
+   *
+   * @param out The snapshot being written
+   */
+  void saveState(SnapshotWriter& out) const;
+
+  /**
+   * @brief Replace the node's state with one written by saveState()
+   *
+   * @param in The snapshot being read
+   */
+  void restoreState(SnapshotReader& in);
+
  private:
+  // A future change of the queue length or of the number of jobs in service
+  struct NodeEvent {
+    double time;  // when the change happens
+    int dQueue;   // the change of the queue length
+    int dBusy;    // the change of the number of jobs in service
+
+    bool operator>(const NodeEvent& other) const { return time > other.time; }
+  };
+
+  typedef std::priority_queue<NodeEvent, std::vector<NodeEvent>,
+                              std::greater<NodeEvent>>
+      event_queue;
+
+  /**
+   * @brief Apply the changes due up to a time to the time averages
+   *
+   * @param events The changes still ahead
+   * @param queue The queue length's time average
+   * @param busy The number in service's time average
+   * @param t The time to apply the changes up to
+   */
+  static void applyEvents(event_queue& events, TimeAverage& queue,
+                          TimeAverage& busy, double t);
+
+  /**
+   * @brief Record an admitted job in the statistics
+   *
+   * @param job The job, with its delay set
+   */
+  void recordJob(const Job& job);
+
   /**
    * @brief Calculate the average service time
    * 
@@ -182,10 +353,10 @@ class ServiceNode {
   size_t maxQueueSz;
 
   // The running average of the service time
-  mutable double totST; 
+  CompensatedSum totST;
 
   // The total number of jobs processed over the life time of this ServiceNode
-  int numJobsProcessed;
+  long long numJobsProcessed;
 
   // The departure time of the last job to enter the server part of this
   // ServiceNode;
@@ -195,10 +366,25 @@ class ServiceNode {
   double serviceDeparture;
 
   // the total delay for all the jobs processed
-  mutable double totDelay;
+  CompensatedSum totDelay;
+
+  // the statistics reported by getStats(), since the last resetStats()
+  struct {
+    RunningStat delay;    // the time jobs wait in the queue
+    RunningStat wait;     // the time jobs spend in the node
+    RunningStat service;  // the jobs' service times
+    TimeAverage queue;    // the number of jobs in the queue
+    TimeAverage busy;     // the number of jobs in service
+    Histogram delayHist;  // the distribution of the delay
+    Histogram waitHist;   // the distribution of the wait
+  } acc;
+
+  // the queue and server changes after the latest arrival
+  event_queue pending;
 };
 
 // overload the << operator
+std::ostream& operator<<(std::ostream& out, const NodeStats& stats);
 std::ostream& operator<<(std::ostream& out, const ServiceNode& node);
 
 #endif
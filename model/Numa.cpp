@@ -0,0 +1,127 @@
+#include "Numa.h"
+
+#include <dirent.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+// parse a sysfs CPU list, such as "0-3,8-11"
+static std::vector<int> parseCpuList(const std::string& text) {
+  std::vector<int> cpus;
+  std::istringstream ranges{text};
+  std::string range;
+  while (std::getline(ranges, range, ',')) {
+    if (range.empty() || range[0] == '\n') continue;
+    size_t dash{range.find('-')};
+    int first{atoi(range.c_str())};
+    int last{dash == std::string::npos ? first
+                                       : atoi(range.c_str() + dash + 1)};
+    for (int cpu = first; cpu <= last; cpu++) cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+std::vector<NumaNode> readNumaTopology() {
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  bool hasMask{sched_getaffinity(0, sizeof(allowed), &allowed) == 0};
+  auto isAllowed = [&](int cpu) {
+    return !hasMask || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed));
+  };
+
+  std::vector<NumaNode> topology;
+  const std::string root{"/sys/devices/system/node"};
+  if (DIR* dir = opendir(root.c_str())) {
+    while (dirent* entry = readdir(dir)) {
+      std::string name{entry->d_name};
+      if (name.compare(0, 4, "node") != 0 || name.size() == 4 ||
+          name.find_first_not_of("0123456789", 4) != std::string::npos) {
+        continue;
+      }
+
+      std::ifstream list{root + "/" + name + "/cpulist"};
+      std::string text;
+      std::getline(list, text);
+      NumaNode node{atoi(name.c_str() + 4), {}};
+      for (int cpu : parseCpuList(text)) {
+        if (isAllowed(cpu)) node.cpus.push_back(cpu);
+      }
+      if (!node.cpus.empty()) topology.push_back(node);
+    }
+    closedir(dir);
+  }
+
+  // no NUMA information: one node with every CPU we may use
+  if (topology.empty()) {
+    NumaNode node{0, {}};
+    long nCpus{sysconf(_SC_NPROCESSORS_CONF)};
+    for (int cpu = 0; cpu < std::max(nCpus, 1L); cpu++) {
+      if (isAllowed(cpu)) node.cpus.push_back(cpu);
+    }
+    if (node.cpus.empty()) node.cpus.push_back(0);
+    topology.push_back(node);
+  }
+
+  std::sort(topology.begin(), topology.end(),
+            [](const NumaNode& a, const NumaNode& b) { return a.id < b.id; });
+  return topology;
+}
+
+std::vector<WorkerPlacement> placeWorkers(const std::vector<NumaNode>& topology,
+                                          int nWorkers) {
+  std::vector<WorkerPlacement> placements;
+  size_t nCpus{0};
+  for (const NumaNode& node : topology) nCpus += node.cpus.size();
+  if (nCpus == 0) return placements;
+
+  // the CPUs of each node taken so far, in this round over all the CPUs
+  std::vector<size_t> taken(topology.size(), 0);
+  size_t turn{0};
+  for (int worker = 0; worker < nWorkers; worker++) {
+    if (worker % nCpus == 0) std::fill(taken.begin(), taken.end(), 0);
+    // the next node in turn with a free CPU (there is one, as the round
+    // isn't over)
+    while (taken[turn] == topology[turn].cpus.size()) {
+      turn = (turn + 1) % topology.size();
+    }
+    const NumaNode& node{topology[turn]};
+    placements.push_back(WorkerPlacement{node.cpus[taken[turn]++], node.id});
+    turn = (turn + 1) % topology.size();
+  }
+  return placements;
+}
+
+bool pinToCpu(int cpu) {
+  if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+size_t adviseHugePages(void* data, size_t bytes) {
+#ifdef MADV_HUGEPAGE
+  // madvise() takes whole pages, so only advise the ones inside the range
+  uintptr_t pageSize{static_cast<uintptr_t>(sysconf(_SC_PAGESIZE))};
+  uintptr_t begin{reinterpret_cast<uintptr_t>(data)};
+  uintptr_t end{begin + bytes};
+  begin = (begin + pageSize - 1) & ~(pageSize - 1);
+  end &= ~(pageSize - 1);
+  if (end <= begin) return 0;
+
+  if (madvise(reinterpret_cast<void*>(begin), end - begin, MADV_HUGEPAGE) !=
+      0) {
+    return 0;
+  }
+  return end - begin;
+#else
+  return 0;
+#endif
+}
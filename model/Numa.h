@@ -0,0 +1,72 @@
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <cstddef>
+#include <vector>
+
+// A NUMA node (a socket, on most machines) and the CPUs of it this process
+// may run on
+struct NumaNode {
+  int id;                 // the node's number in sysfs
+  std::vector<int> cpus;  // its CPUs, in increasing order
+};
+
+// Where a worker process runs
+struct WorkerPlacement {
+  int cpu;   // the CPU it is pinned to
+  int node;  // the NUMA node of that CPU
+};
+
+/**
+ * @brief Read the NUMA nodes of the machine from sysfs
+ *
+ * Only the CPUs in this process's affinity mask are listed, and nodes
+ * without any of them (memory-only nodes) are left out. Where sysfs has no
+ * NUMA information, all the CPUs are put on a single node 0.
+ *
+ * @return std::vector<NumaNode> The nodes, by increasing id
+ */
+std::vector<NumaNode> readNumaTopology();
+
+/**
+ * @brief Pick a CPU for each of a number of workers
+ *
+ * The workers are dealt out in turn to the nodes that have a free CPU, so
+ * each node gets an even share of them (and of the memory bandwidth) until
+ * its CPUs run out, and to the CPUs of a node in order. Only with more
+ * workers than CPUs are the CPUs shared, each by as many workers as the
+ * others, give or take one.
+ *
+ * @param topology The nodes, from readNumaTopology()
+ * @param nWorkers The number of workers
+ * @return std::vector<WorkerPlacement> The placement of each worker
+ */
+std::vector<WorkerPlacement> placeWorkers(const std::vector<NumaNode>& topology,
+                                          int nWorkers);
+
+/**
+ * @brief Restrict the calling thread to one CPU
+ *
+ * Memory the thread touches first afterwards is allocated on that CPU's
+ * node (the kernel's default local policy), so a worker that is pinned
+ * before it builds its tables gets them on its own node.
+ *
+ * @param cpu The CPU
+ * @return true The thread was pinned
+ */
+bool pinToCpu(int cpu);
+
+/**
+ * @brief Ask for a range of memory to be backed by transparent huge pages
+ *
+ * Only has an effect where THP is enabled ("always" or "madvise"), and
+ * best before the range is first touched.
+ *
+ * @param data The start of the range
+ * @param bytes The size of the range
+ * @return size_t The bytes advised (the whole pages inside the range; 0 if
+ * the advice wasn't taken)
+ */
+size_t adviseHugePages(void* data, size_t bytes);
+
+#endif
@@ -0,0 +1,203 @@
+#include "Partition.h"
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "Job.h"
+#include "LoadBalancing.h"
+#include "Node.h"
+#include "PerfCounters.h"
+#include "Profile.h"
+#include "WallClock.h"
+#include "WindowBarrier.h"
+#include "rvgs.h"
+
+// A job on its way to a partition
+struct RoutedJob {
+  Job job;    // its arrival and service
+  Job probe;  // the policy's probe job, drawn by the dispatcher
+  int node;   // the node in the partition (-1: the partition picks it)
+};
+
+// A partition: its nodes, and the jobs the dispatcher sent it (its event
+// list) in an inbox for each of the last two batches, so that it can run one
+// while the other is being filled
+class Partition {
+ public:
+  Partition(int firstId, int nNodes, lba_alg lba, size_t qSize)
+      : firstId{firstId}, rejects{0}, lba{lba} {
+    nodes.reserve(nNodes);
+    for (int id = firstId; id < firstId + nNodes; id++) {
+      nodes.push_back(ServiceNode(id, qSize));
+    }
+  }
+
+  // queue a job of a batch
+  void push(long long batch, const RoutedJob& routed) {
+    inboxes[batch & 1].push_back(routed);
+  }
+
+  // place the jobs of a batch on the nodes, in the order they arrived
+  void runBatch(long long batch) {
+    std::vector<RoutedJob>& inbox{inboxes[batch & 1]};
+    for (RoutedJob& routed : inbox) {
+      int node{routed.node};
+      if (node < 0) {
+        node = lba == 2 ? utilizationBased.pick(nodes, routed.probe)
+                        : leastConnections.pick(nodes, routed.probe);
+      }
+      if (!nodes[node].enterNode(routed.job)) ++rejects;
+    }
+    inbox.clear();
+  }
+
+  node_list nodes;
+  int firstId;        // the id of its first node
+  long long rejects;  // the jobs its nodes turned away
+
+ private:
+  lba_alg lba;
+  lba::UtilizationBased<> utilizationBased;
+  lba::LeastConnections<> leastConnections;
+  std::vector<RoutedJob> inboxes[2];
+};
+
+bool isPartitionable(lba_alg lba) { return lba == 0 || lba == 1; }
+
+SimResult runPartitioned(int nNodes, lba_alg lba, size_t qSize,
+                         long long nJobs, const PartitionConfig& config,
+                         PartitionReport* report) {
+  PROF_SCOPE("runPartitioned");
+  PROF_COUNT("jobs", nJobs);
+  perfEnter(PerfPhase::setup);
+
+  // contiguous partitions, the first nNodes % nParts one node larger (a
+  // policy that looks at the nodes keeps them all in one)
+  int nParts{isPartitionable(lba)
+                 ? std::max(1, std::min(config.partitions, nNodes))
+                 : 1};
+  std::vector<std::unique_ptr<Partition>> parts;
+  std::vector<int> partOf(nNodes);
+  for (int part = 0, first = 0; part < nParts; part++) {
+    int size{nNodes / nParts + (part < nNodes % nParts ? 1 : 0)};
+    parts.emplace_back(new Partition(first, size, lba, qSize));
+    std::fill(partOf.begin() + first, partOf.begin() + first + size, part);
+    first += size;
+  }
+
+  // with one thread it routes and runs each batch in turn; with more, the
+  // main thread routes and the helper threads share the partitions
+  int nThreads{std::max(1, std::min(config.threads, nParts + 1))};
+  int nRunners{std::max(1, nThreads - 1)};
+  long long batches{(nJobs + PARTITION_BATCH - 1) / PARTITION_BATCH};
+  WindowBarrier barrier{nThreads};
+  auto runShare = [&](int runner, long long batch) {
+    for (int part = runner; part < nParts; part += nRunners) {
+      parts[part]->runBatch(batch);
+    }
+  };
+  std::vector<std::thread> helpers;
+  for (int runner = 0; runner < nThreads - 1; runner++) {
+    helpers.emplace_back([&, runner]() {
+      for (long long batch = 0; batch < batches; batch++) {
+        barrier.wait();  // the batch has been routed
+        runShare(runner, batch);
+      }
+      barrier.wait();  // every partition has run the last batch
+    });
+  }
+
+  // draw a job with the random numbers of the sequential engine's loop: the
+  // arrival, the service, the policy's probe, and random's node
+  int cursor{0};
+  auto draw = [&]() {
+    RoutedJob routed{Job{getArrival()}, Job{}, -1};
+    routed.probe = Job{routed.job.getArrival()};
+    if (lba == 0) {
+      routed.node = cursor;
+      cursor = (cursor + 1) % nNodes;
+    } else if (lba == 1) {
+      routed.node = Equilikely(0, nNodes - 1);
+    }
+    return routed;
+  };
+
+  // draw the jobs of a batch and send each to its node's partition
+  long long made{0};
+  double drawSeconds{0.0};
+  auto routeBatch = [&](long long batch) {
+    double start{wallTime()};
+    for (long long end{std::min(nJobs, made + PARTITION_BATCH)}; made < end;
+         made++) {
+      RoutedJob routed{draw()};
+      int part{0};
+      if (routed.node >= 0) {
+        part = partOf[routed.node];
+        routed.node -= parts[part]->firstId;
+      }
+      parts[part]->push(batch, routed);
+    }
+    drawSeconds += wallTime() - start;
+  };
+
+  perfEnter(PerfPhase::steady);
+  double start{wallTime()};
+  if (batches > 0) routeBatch(0);
+  for (long long batch = 0; batch < batches; batch++) {
+    barrier.wait();  // the batch has been routed, and the one before it run
+    if (batch + 1 < batches) routeBatch(batch + 1);
+    if (nThreads == 1) runShare(0, batch);
+  }
+  barrier.wait();  // the last batch has been run
+  for (std::thread& helper : helpers) helper.join();
+  double loopSeconds{wallTime() - start};
+
+  perfAddJobs(PerfPhase::steady, nJobs);
+  perfEnter(PerfPhase::output);
+
+  // the results of the nodes in the order of their ids, as runMqms()
+  SimResult result{Model::mqms, stats_list{}, 0, nJobs, 0, WarmupReport{}};
+  for (const std::unique_ptr<Partition>& part : parts) {
+    stats_list stats{collectStats(part->nodes)};
+    result.stats.insert(result.stats.end(), stats.begin(), stats.end());
+    result.totalRejects += part->rejects;
+    for (const ServiceNode& node : part->nodes) {
+      result.delayHist.merge(node.getDelayHist());
+      result.waitHist.merge(node.getWaitHist());
+    }
+  }
+
+  if (report) {
+    report->partitions = nParts;
+    report->batches = batches;
+    report->threads = nThreads;
+    report->loopSeconds = loopSeconds;
+    report->drawSeconds = drawSeconds;
+  }
+  return result;
+}
+
+void partitionedSimulation(int nNodes, lba_alg lba, size_t qSize,
+                           long long nJobs, const PartitionConfig& config) {
+  PROF_SCOPE("partitionedSimulation");
+  std::string funcName{LBA_NAMES[lba]};
+  PartitionReport report;
+  SimResult result{
+      runPartitioned(nNodes, lba, qSize, nJobs, config, &report)};
+  perfEnter(PerfPhase::output);
+
+  printStats(result.stats, result.totalRejects, result.nJobs);
+  std::cout << "Partitions: " << report.partitions << " on "
+            << report.threads << " threads, " << report.batches
+            << " batches of up to " << PARTITION_BATCH << " jobs, "
+            << report.loopSeconds << " s (" << report.drawSeconds
+            << " s routing)" << std::endl;
+
+  accumStats(result.stats, nJobs, Model::mqms, funcName);
+  accumPercentiles(result, funcName);
+  log_sim(funcName, nNodes, qSize, nJobs, result.stats);
+  perfLeave();
+}
@@ -0,0 +1,243 @@
+#include "PerfCounters.h"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+
+#include "WallClock.h"
+
+// the hardware events of a group, the first one leads it
+const int NUM_EVENTS{4};
+const uint64_t EVENT_CONFIGS[NUM_EVENTS]{
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+const char* EVENT_NAMES[NUM_EVENTS]{"cycles", "instr", "cache-miss",
+                                    "branch-miss"};
+
+const char* PHASE_NAMES[NUM_PERF_PHASES]{"setup", "warmup", "steady",
+                                         "output"};
+
+// What a thread has counted up to a point
+struct PerfReading {
+  double wallNs{0.0};
+  double cpuNs{0.0};
+  double events[NUM_EVENTS]{};
+};
+
+// The totals of a phase over all threads
+struct PerfTotals {
+  PerfReading counts;
+  long long jobs{0};
+};
+
+// The process-wide settings and totals, reported at exit
+class PerfState {
+ public:
+  ~PerfState() { report(); }
+
+  bool enabled{false};
+  bool available[NUM_EVENTS]{};
+  PerfTotals phases[NUM_PERF_PHASES];
+  std::mutex lock;
+
+ private:
+  void report() const;
+};
+
+static PerfState& perfState() {
+  static PerfState state;
+  return state;
+}
+
+// open one event of the calling thread (user space only, which is what a
+// perf_event_paranoid of 2 allows)
+static int openEvent(uint64_t config, int groupFd) {
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                     PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return static_cast<int>(
+      syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0));
+}
+
+// The counter group and the current phase of one thread
+class PerfThread {
+ public:
+  PerfThread() : leader{-1}, phase{-1} {
+    // make sure the totals outlive this thread's counters
+    PerfState& state{perfState()};
+    for (int ii = 0; ii < NUM_EVENTS; ii++) {
+      fds[ii] = -1;
+      if (!state.available[ii]) continue;
+      fds[ii] = openEvent(EVENT_CONFIGS[ii], leader);
+      if (leader < 0) leader = fds[ii];
+    }
+    start = read();
+  }
+
+  ~PerfThread() {
+    enter(-1);
+    for (int fd : fds) {
+      if (fd >= 0) ::close(fd);
+    }
+  }
+
+  // end the current phase (adding its counts to the totals), start another
+  void enter(int next) {
+    PerfReading now{read()};
+    if (phase >= 0) {
+      PerfState& state{perfState()};
+      std::lock_guard<std::mutex> guard{state.lock};
+      PerfReading& total{state.phases[phase].counts};
+      total.wallNs += now.wallNs - start.wallNs;
+      total.cpuNs += now.cpuNs - start.cpuNs;
+      for (int ii = 0; ii < NUM_EVENTS; ii++) {
+        total.events[ii] += now.events[ii] - start.events[ii];
+      }
+    }
+    phase = next;
+    start = now;
+  }
+
+ private:
+  PerfReading read() const {
+    PerfReading reading;
+    reading.wallNs = wallTime() * 1e9;
+    timespec cpu;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu) == 0) {
+      reading.cpuNs = cpu.tv_sec * 1e9 + cpu.tv_nsec;
+    }
+    if (leader < 0) return reading;
+
+    // nr, time enabled, time running, then the values in the order the
+    // events were opened
+    uint64_t data[3 + NUM_EVENTS];
+    if (::read(leader, data, sizeof(data)) < 0 || data[2] == 0) {
+      return reading;
+    }
+
+    // scale up if the group had to share the PMU with others
+    double scale{static_cast<double>(data[1]) / data[2]};
+    uint64_t value{0};
+    for (int ii = 0; ii < NUM_EVENTS; ii++) {
+      if (fds[ii] >= 0 && value < data[0]) {
+        reading.events[ii] = data[3 + value++] * scale;
+      }
+    }
+    return reading;
+  }
+
+  int fds[NUM_EVENTS];
+  int leader;
+  int phase;  // -1 outside the phases
+  PerfReading start;
+};
+
+static PerfThread* perfThread() {
+  if (!perfState().enabled) return nullptr;
+  thread_local PerfThread thread;
+  return &thread;
+}
+
+bool enablePerf(std::string& error) {
+  PerfState& state{perfState()};
+  state.enabled = true;
+
+  // find the events this machine can count, as a group
+  int leader{-1};
+  int fds[NUM_EVENTS];
+  bool isComplete{true};
+  for (int ii = 0; ii < NUM_EVENTS; ii++) {
+    fds[ii] = openEvent(EVENT_CONFIGS[ii], leader);
+    state.available[ii] = fds[ii] >= 0;
+    if (fds[ii] < 0) {
+      if (isComplete) error = std::strerror(errno);
+      isComplete = false;
+    } else if (leader < 0) {
+      leader = fds[ii];
+    }
+  }
+  for (int fd : fds) {
+    if (fd >= 0) ::close(fd);
+  }
+
+  if (!isComplete) {
+    error = std::string(leader < 0 ? "the" : "some") +
+            " hardware counters can't be read (" + error +
+            "), check /proc/sys/kernel/perf_event_paranoid";
+  }
+  return isComplete;
+}
+
+void perfEnter(PerfPhase phase) {
+  PerfThread* thread{perfThread()};
+  if (thread) thread->enter(static_cast<int>(phase));
+}
+
+void perfLeave() {
+  PerfThread* thread{perfThread()};
+  if (thread) thread->enter(-1);
+}
+
+void perfAddJobs(PerfPhase phase, long long nJobs) {
+  PerfState& state{perfState()};
+  if (!state.enabled) return;
+  std::lock_guard<std::mutex> guard{state.lock};
+  state.phases[static_cast<int>(phase)].jobs += nJobs;
+}
+
+void PerfState::report() const {
+  if (!enabled) return;
+
+  // the setup and output are shared by the jobs of the other phases
+  long long simulated{phases[static_cast<int>(PerfPhase::warmup)].jobs +
+                      phases[static_cast<int>(PerfPhase::steady)].jobs};
+
+  std::fprintf(stderr, "\nperf counters (user space, all threads):\n");
+  std::fprintf(stderr, "%-8s %12s %10s %10s", "phase", "jobs", "wall ms",
+               "cpu ms");
+  for (const char* name : EVENT_NAMES) {
+    std::fprintf(stderr, " %14s %10s", name, "/job");
+  }
+  std::fprintf(stderr, " %6s\n", "ipc");
+
+  for (int phase = 0; phase < NUM_PERF_PHASES; phase++) {
+    const PerfTotals& totals{phases[phase]};
+    bool isSimulating{phase == static_cast<int>(PerfPhase::warmup) ||
+                      phase == static_cast<int>(PerfPhase::steady)};
+    long long jobs{isSimulating ? totals.jobs : simulated};
+
+    std::fprintf(stderr, "%-8s %12lld %10.3f %10.3f", PHASE_NAMES[phase],
+                 totals.jobs, totals.counts.wallNs / 1e6,
+                 totals.counts.cpuNs / 1e6);
+    for (int ii = 0; ii < NUM_EVENTS; ii++) {
+      if (!available[ii]) {
+        std::fprintf(stderr, " %14s %10s", "n/a", "n/a");
+        continue;
+      }
+      double count{totals.counts.events[ii]};
+      std::fprintf(stderr, " %14.0f %10.1f", count,
+                   jobs > 0 ? count / jobs : 0.0);
+    }
+
+    double cycles{totals.counts.events[0]};
+    if (available[0] && available[1] && cycles > 0) {
+      std::fprintf(stderr, " %6.2f\n", totals.counts.events[1] / cycles);
+    } else {
+      std::fprintf(stderr, " %6s\n", "n/a");
+    }
+  }
+}
@@ -0,0 +1,57 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <string>
+
+// The phases of a run that the counters are split into
+enum class PerfPhase {
+  setup,   // building the nodes and buffers
+  warmup,  // the jobs dropped from the statistics (with --warmup)
+  steady,  // the jobs the statistics are about
+  output   // collecting and writing the results
+};
+const int NUM_PERF_PHASES{4};
+
+// Hardware counters around the phases of the simulation, read with
+// perf_event_open(2) (opt in with --perf).
+//
+// Every thread that enters a phase opens its own counter group (cycles,
+// instructions, cache misses and branch mispredicts, in user space), so the
+// counts are read without any locks; only a phase change takes the lock, to
+// add the thread's counts to the process-wide totals. The wall time and the
+// thread's CPU time are always kept, so the report still has the time per
+// phase where counters aren't permitted (a perf_event_paranoid above 2, a
+// container without a PMU). It is printed to stderr when the program exits.
+
+/**
+ * @brief Turn the counters on for the rest of the program
+ *
+ * @param error Set to why some (or all) counters can't be read
+ * @return true Every counter can be read
+ * @return false Some counters are missing, they are reported as n/a
+ */
+bool enablePerf(std::string& error);
+
+/**
+ * @brief End the calling thread's current phase and start another
+ *
+ * Does nothing unless enablePerf() was called.
+ *
+ * @param phase The phase the thread is in from now on
+ */
+void perfEnter(PerfPhase phase);
+
+/**
+ * @brief End the calling thread's current phase without starting another
+ */
+void perfLeave();
+
+/**
+ * @brief Count jobs in a phase, for the per-job figures
+ *
+ * @param phase The phase that simulated the jobs
+ * @param nJobs The number of jobs
+ */
+void perfAddJobs(PerfPhase phase, long long nJobs);
+
+#endif
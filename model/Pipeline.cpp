@@ -0,0 +1,243 @@
+#include "Pipeline.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "LoadBalancing.h"
+#include "PerfCounters.h"
+#include "Profile.h"
+#include "SpscRing.h"
+#include "Warmup.h"
+#include "rngs.h"
+
+// the capacity of the rings and the number of items moved at a time
+const size_t RING_SIZE{1 << 14};
+const size_t BATCH_SIZE{512};
+
+// What the dispatcher reports to the statistics stage for every job
+struct JobOutcome {
+  long long index;  // the job's index in the run
+  double delay;     // the job's delay in the node (admitted mqms jobs)
+  size_t queued;    // the dispatcher's queue length (sqms)
+  bool rejected;    // the job was turned away
+  bool counted;     // the job arrived after the statistics were reset
+};
+
+// Push a whole batch, waiting for room when the ring is full
+template <typename T>
+static void pushAll(SpscRing<T>& ring, const T* items, size_t n) {
+  while (n > 0) {
+    size_t pushed{ring.push(items, n)};
+    items += pushed;
+    n -= pushed;
+    if (n > 0) std::this_thread::yield();
+  }
+}
+
+// Pop a batch, waiting for items; returns 0 only once the ring is drained
+template <typename T>
+static size_t popSome(SpscRing<T>& ring, T* items, size_t n) {
+  while (true) {
+    size_t popped{ring.pop(items, n)};
+    if (popped > 0) return popped;
+    if (ring.isDrained()) return ring.pop(items, n);
+    std::this_thread::yield();
+  }
+}
+
+SimResult runPipelined(Model model, int nNodes, lba_alg lba, size_t qSize,
+                       long long nJobs, const SimOptions& opts,
+                       SimWorkspace* ws) {
+  PROF_SCOPE("runPipelined");
+  PROF_COUNT("jobs", nJobs);
+  perfEnter(PerfPhase::setup);
+
+  lba::AnyPolicy policy{lba};
+
+  // build node list (reusing the workspace's table if there is one)
+  SimWorkspace local;
+  node_list& nodes{ws ? ws->nodes : local.nodes};
+  resetNodeList(nodes, nNodes, model == Model::mqms ? qSize : 0);
+  std::queue<Job>& jobQueue{ws ? ws->jobQueue : local.jobQueue};
+  while (!jobQueue.empty()) jobQueue.pop();
+
+  SpscRing<Job> jobs{RING_SIZE};
+  SpscRing<JobOutcome> outcomes{RING_SIZE};
+
+  // the stats stage asks the dispatcher to reset the node statistics
+  std::atomic<bool> resetRequest{false};
+
+  long startSeed;
+  GetSeed(&startSeed);
+  long endSeed{startSeed};
+
+  // the sampler starts at the current arrival clock, which the generator
+  // advances as soon as it runs
+  std::shared_ptr<Sampler> sampler{startSampler(opts, nNodes, nJobs)};
+
+  // stage 1: generate the jobs
+  std::thread generator([&]() {
+    PROF_SCOPE("pipeline::generate");
+    PROF_COUNT("jobs", nJobs);  // the stage's own thread, outside the run
+    perfEnter(PerfPhase::steady);
+    PutSeed(startSeed);  // this thread's own copy of stream 0
+
+    std::vector<Job> batch(BATCH_SIZE);
+    for (long long ii = 0; ii < nJobs;) {
+      size_t n{0};
+      for (; n < BATCH_SIZE && ii < nJobs; n++, ii++) {
+        batch[n] = Job{getArrival()};
+      }
+      pushAll(jobs, batch.data(), n);
+    }
+    jobs.close();
+
+    GetSeed(&endSeed);
+    perfLeave();
+  });
+
+  // stage 3: run-wide statistics
+  long long totalRejects{0};
+  long long resetJob{0};
+  WarmupReport warmupReport;
+  std::thread statistics([&]() {
+    PROF_SCOPE("pipeline::statistics");
+    PROF_COUNT("jobs", nJobs);
+    perfEnter(PerfPhase::steady);
+    WarmupDetector warmup;
+    bool isCounting{false};
+
+    std::vector<JobOutcome> batch(BATCH_SIZE);
+    size_t n;
+    while ((n = popSome(outcomes, batch.data(), BATCH_SIZE)) > 0) {
+      for (size_t ii = 0; ii < n; ii++) {
+        const JobOutcome& out{batch[ii]};
+
+        // the first job after the reset restarts the count
+        if (out.counted && !isCounting) {
+          isCounting = true;
+          totalRejects = 0;
+          resetJob = out.index;
+        }
+
+        if (out.rejected) ++totalRejects;
+
+        if (!opts.detectWarmup) continue;
+        double obs{model == Model::mqms ? out.delay
+                                         : static_cast<double>(out.queued)};
+        bool isObserved{model == Model::sqms || !out.rejected};
+        if (isObserved && warmup.observe(obs, out.index) &&
+            warmup.getTruncationObs() > 0) {
+          resetRequest.store(true, std::memory_order_relaxed);
+        }
+      }
+    }
+
+    warmupReport = warmup.getReport();
+    perfLeave();
+  });
+
+  // stage 2: dispatch, on this thread, drawing from its own stream
+  PlantSeeds(startSeed);
+  SelectStream(1);
+
+  std::unique_ptr<EventLog::Buffer> events{startEvents(opts, model)};
+  Telemetry* telemetry{startTelemetry(opts, model, lba, nNodes, nJobs)};
+  long long rejects{0};  // for the telemetry (the stats stage has the total)
+  double lastArrival{0.0};
+
+  // the jobs before this one are counted in the warm-up phase
+  long long steadyJob{opts.detectWarmup ? nJobs : 0};
+  perfEnter(opts.detectWarmup ? PerfPhase::warmup : PerfPhase::steady);
+
+  bool isReset{false};
+  std::vector<Job> batch(BATCH_SIZE);
+  std::vector<JobOutcome> results(BATCH_SIZE);
+  long long index{0};
+  size_t n;
+  while ((n = popSome(jobs, batch.data(), BATCH_SIZE)) > 0) {
+    for (size_t ii = 0; ii < n; ii++, index++) {
+      Job& job{batch[ii]};
+
+      if (sampler && job.getArrival() >= sampler->getNextTick()) {
+        sampler->sample(job.getArrival(), nodes, jobQueue.size());
+      }
+      if (telemetry && telemetry->isDue(index)) {
+        telemetry->publish(job.getArrival(), index, rejects, nodes,
+                           jobQueue.size());
+      }
+
+      // the reset lands a few batches after the detection, which the stats
+      // stage reports as the first job counted (see printWarmup())
+      if (!isReset && resetRequest.load(std::memory_order_relaxed)) {
+        for (ServiceNode& node : nodes) node.resetStats(job.getArrival());
+        isReset = true;
+        steadyJob = index;
+        perfEnter(PerfPhase::steady);
+      }
+
+      JobOutcome& out{results[ii]};
+      out.index = index;
+      out.counted = isReset;
+
+      bool isLogged{events && events->isSampled(index)};
+      int receiver{policy.pick(nodes, job.getArrival())};
+      bool isEntered;
+      long long queued{0};
+      if (model == Model::mqms) {
+        if (isLogged) {
+          nodes[receiver].advanceTo(job.getArrival());
+          queued = nodes[receiver].getQueueLevel();
+        }
+        isEntered = nodes[receiver].enterNode(job);
+        out.rejected = !isEntered;
+        out.delay = job.getDelay();
+        out.queued = 0;
+      } else {
+        // same as the serial sqms loop
+        out.rejected = jobQueue.size() >= qSize;
+        if (!out.rejected) jobQueue.push(job);
+
+        isEntered = nodes[receiver].enterNode(job);
+        if (isEntered && !jobQueue.empty()) jobQueue.pop();
+
+        out.delay = 0.0;
+        out.queued = jobQueue.size();
+        queued = jobQueue.size();
+      }
+
+      if (out.rejected) ++rejects;
+      if (isLogged) {
+        events->add(JobEvent{index, job.getArrival(), receiver, queued,
+                             job.getDelay(),
+                             isEntered ? job.calcDeparture() : job.getArrival(),
+                             out.rejected});
+      }
+    }
+    pushAll(outcomes, results.data(), n);
+    lastArrival = batch[n - 1].getArrival();
+  }
+  outcomes.close();
+  if (telemetry) {
+    telemetry->publish(lastArrival, index, rejects, nodes, jobQueue.size(),
+                       true);
+  }
+
+  generator.join();
+  statistics.join();
+
+  perfAddJobs(PerfPhase::warmup, steadyJob);
+  perfAddJobs(PerfPhase::steady, nJobs - steadyJob);
+  perfEnter(PerfPhase::output);
+
+  // continue where the generator left off
+  SelectStream(0);
+  PutSeed(endSeed);
+
+  SimResult result{model,        collectStats(nodes), totalRejects,
+                   nJobs - resetJob, resetJob,        warmupReport};
+  collectHistograms(nodes, result);
+  result.samples = sampler;
+  return result;
+}
@@ -0,0 +1,33 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "Simulation.h"
+
+/**
+ * @brief Run a simulation split into three pipelined stages
+ *
+ * A generator thread draws the arrival and service times in batches, the
+ * calling thread only dispatches jobs and updates the nodes, and a third
+ * thread keeps the run-wide statistics (rejections, warm-up detection). The
+ * stages are connected by lock-free single-producer/single-consumer rings.
+ *
+ * The generator draws from rngs stream 0 and the dispatcher (for the
+ * algorithms that need random numbers) from stream 1, planted from the same
+ * state. The run is reproducible, but the numbers differ from the serial
+ * loops, where both draw from a single stream in turn. Afterwards the calling
+ * thread continues from the generator's stream, like after a serial run.
+ *
+ * @param model The model to simulate
+ * @param nNodes The number of nodes to use in the simulation
+ * @param lba The node balancing
+ * @param qSize The queue size
+ * @param nJobs The number of jobs to "process" in the simulation
+ * @param opts The simulation options
+ * @param ws The buffers to reuse (nullptr to use fresh ones)
+ * @return SimResult The statistics of the run
+ */
+SimResult runPipelined(Model model, int nNodes, lba_alg lba, size_t qSize,
+                       long long nJobs, const SimOptions& opts,
+                       SimWorkspace* ws = nullptr);
+
+#endif
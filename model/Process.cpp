@@ -0,0 +1,121 @@
+#include "Process.h"
+
+#include <algorithm>
+
+// the heap order: the earliest event on top, the first scheduled among ties
+static bool isLater(const ProcessEvent& a, const ProcessEvent& b) {
+  return a.time > b.time || (a.time == b.time && a.seq > b.seq);
+}
+
+Calendar::Calendar()
+    : clock{0.0}, nextSeq{0}, handled{0}, isTopHandled{false} {}
+
+void Calendar::schedule(std::coroutine_handle<> proc, double delay) {
+  scheduleAt(proc, clock + delay);
+}
+
+void Calendar::scheduleAt(std::coroutine_handle<> proc, double time) {
+  ProcessEvent event{std::max(time, clock), nextSeq++, proc};
+  if (isTopHandled) {
+    isTopHandled = false;
+    replaceTop(event);
+    return;
+  }
+  events.push_back(event);
+  std::push_heap(events.begin(), events.end(), isLater);
+}
+
+void Calendar::replaceTop(const ProcessEvent& event) {
+  // sift the hole the top left down to where the event belongs
+  size_t size{events.size()};
+  size_t hole{0};
+  for (size_t child = 1; child < size; child = 2 * hole + 1) {
+    if (child + 1 < size && isLater(events[child], events[child + 1])) {
+      ++child;
+    }
+    if (!isLater(event, events[child])) break;
+    events[hole] = events[child];
+    hole = child;
+  }
+  events[hole] = event;
+}
+
+bool Calendar::step() {
+  if (events.empty()) return false;
+
+  // the event stays on top while its process runs, so that the first event
+  // the process schedules (its next wait, most often) takes its place: one
+  // sift instead of a pop and a push. The events are ordered by their time
+  // and sequence alone, so they come out in the same order either way.
+  ProcessEvent event{events.front()};
+  clock = event.time;
+  ++handled;
+  isTopHandled = true;
+  event.proc.resume();  // a process that ends frees its frame
+
+  if (isTopHandled) {
+    isTopHandled = false;
+    std::pop_heap(events.begin(), events.end(), isLater);
+    events.pop_back();
+  }
+  return true;
+}
+
+void Calendar::run() {
+  while (step()) {
+  }
+}
+
+Resource::Resource(int servers, size_t lineSize)
+    : servers{servers}, lineSize{lineSize}, busy{0} {}
+
+void Resource::release(Calendar& cal) {
+  if (waiting.empty()) {
+    --busy;
+    return;
+  }
+
+  // the server goes straight to the first in line
+  std::coroutine_handle<> next{waiting.front()};
+  waiting.pop_front();
+  cal.schedule(next, 0.0);
+}
+
+FramePool::FramePool(size_t chunkBytes)
+    : chunkBytes{(std::max(chunkBytes, ALIGN) + ALIGN - 1) / ALIGN * ALIGN},
+      chunkUsed{0},
+      totalBytes{0},
+      live{0},
+      peak{0} {}
+
+void* FramePool::allocate(size_t bytes) {
+  size_t units{(bytes + ALIGN - 1) / ALIGN};
+  if (++live > peak) peak = live;
+  if (units < freeLists.size() && freeLists[units] != nullptr) {
+    Slot* slot{freeLists[units]};
+    freeLists[units] = slot->next;
+    return slot;
+  }
+
+  // carve a new frame out of the last chunk, or a new one (a frame larger
+  // than a chunk gets a chunk of its own size)
+  size_t frameBytes{units * ALIGN};
+  if (chunks.empty() || chunkUsed + frameBytes > chunkBytes) {
+    size_t newBytes{std::max(chunkBytes, frameBytes)};
+    chunks.emplace_back(new std::max_align_t[newBytes / ALIGN]);
+    chunkUsed = newBytes - chunkBytes;  // 0, or full if the frame is larger
+    totalBytes += newBytes;
+  }
+  char* frame{reinterpret_cast<char*>(chunks.back().get()) + chunkUsed};
+  chunkUsed += frameBytes;
+  return frame;
+}
+
+void FramePool::release(void* frame, size_t bytes) {
+  size_t units{(bytes + ALIGN - 1) / ALIGN};
+  if (units >= freeLists.size()) freeLists.resize(units + 1, nullptr);
+  Slot* slot{static_cast<Slot*>(frame)};
+  slot->next = freeLists[units];
+  freeLists[units] = slot;
+  --live;
+}
@@ -0,0 +1,328 @@
+#ifndef PROCESS_H
+#define PROCESS_H
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <vector>
+
+// A process-interaction layer on an event calendar.
+//
+// A process is a C++20 coroutine that returns Process. It co_awaits the
+// calendar's delay() for time to pass, and a Resource's acquire() for one
+// of its servers, so a job's whole lifecycle reads top to bottom, with its
+// locals kept across the waits:
+//
+//   Process job(FramePool& pool, Calendar& cal, Resource& server) {
+//     co_await server.acquire();
+//     co_await cal.delay(Exponential(SERVICE_MEAN));
+//     server.release(cal);
+//   }
+//
+// Calendar::start() runs it from its first line when its event comes up,
+// and each wait schedules the next resumption, so a wait costs one event: a
+// 24-byte entry that takes the place of the one being handled (one sift of
+// the heap), plus the jump into the coroutine. The frames come from the
+// FramePool that every process takes as its first argument, and go back to
+// it when the process ends.
+
+class Calendar;
+class FramePool;
+
+// A process, as its coroutine returns it: the handle of a frame that hasn't
+// run yet, to give to Calendar::start()
+class Process {
+ public:
+  struct promise_type {
+    Process get_return_object() {
+      return Process{std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+    // started by the calendar, and freed as it ends
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+
+    // the frame comes from the pool the process takes first, which is kept
+    // behind it for the delete
+    template <typename... Args>
+    static void* operator new(size_t bytes, FramePool& pool, Args&...);
+    static void operator delete(void* frame, size_t bytes);
+  };
+
+  /**
+   * @brief Get the coroutine of the process
+   *
+   * @return std::coroutine_handle<> The handle, which the calendar resumes
+   */
+  std::coroutine_handle<> getHandle() const { return handle; }
+
+ private:
+  explicit Process(std::coroutine_handle<> handle) : handle{handle} {}
+
+  std::coroutine_handle<> handle;
+};
+
+// An event: the process to resume, and when
+struct ProcessEvent {
+  double time;                  // the simulated time of the event
+  uint64_t seq;                 // the order it was scheduled in, which
+                                // breaks ties
+  std::coroutine_handle<> proc;  // the process to resume
+};
+
+// The event list: resumes the processes in the order of their events'
+// times, and of their scheduling among events at the same time
+class Calendar {
+ public:
+  // What a process co_awaits to wait for time to pass
+  struct Delay {
+    Calendar& cal;
+    double dt;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> proc) { cal.schedule(proc, dt); }
+    void await_resume() const noexcept {}
+  };
+
+  /**
+   * @brief Construct an empty Calendar at time 0
+   */
+  Calendar();
+
+  /**
+   * @brief Get the simulated time
+   *
+   * @return double The time of the event being handled
+   */
+  double now() const { return clock; }
+
+  /**
+   * @brief Start a process after a delay
+   *
+   * Every process has to be started, or its frame is never freed.
+   *
+   * @param proc The process, as its coroutine returned it
+   * @param delay The delay, in seconds (0: after the events already due now)
+   */
+  void start(Process proc, double delay = 0.0) {
+    schedule(proc.getHandle(), delay);
+  }
+
+  /**
+   * @brief Wait for time to pass, in a process
+   *
+   * @param dt The time, in seconds (0: after the events already due now)
+   * @return Delay What the process co_awaits
+   */
+  Delay delay(double dt) { return Delay{*this, dt}; }
+
+  /**
+   * @brief Resume a process after a delay
+   *
+   * @param proc The process
+   * @param delay The delay, in seconds (0: after the events already due now)
+   */
+  void schedule(std::coroutine_handle<> proc, double delay);
+
+  /**
+   * @brief Resume a process at a time
+   *
+   * @param proc The process
+   * @param time The time, no earlier than now()
+   */
+  void scheduleAt(std::coroutine_handle<> proc, double time);
+
+  /**
+   * @brief Handle the next event
+   *
+   * @return true An event was handled; false: the calendar is empty
+   */
+  bool step();
+
+  /**
+   * @brief Handle the events until the calendar is empty
+   */
+  void run();
+
+  /**
+   * @brief Get the number of events waiting
+   *
+   * @return size_t The events
+   */
+  size_t size() const { return events.size(); }
+
+  /**
+   * @brief Get the number of events handled
+   *
+   * @return uint64_t The events
+   */
+  uint64_t getHandled() const { return handled; }
+
+ private:
+  // put an event in place of the top one, keeping the heap order
+  void replaceTop(const ProcessEvent& event);
+
+  std::vector<ProcessEvent> events;  // a binary heap, earliest on top
+  double clock;
+  uint64_t nextSeq;
+  uint64_t handled;
+  bool isTopHandled;  // the top event was handled, and nothing took its place
+};
+
+// A group of identical servers and their FIFO waiting line. A process that
+// asks for a busy resource waits in line and is resumed holding the server
+// it was handed.
+class Resource {
+ public:
+  // What a process co_awaits to take a server
+  struct Acquire {
+    Resource& res;
+    bool await_ready() noexcept {
+      if (res.busy >= res.servers) return false;
+      ++res.busy;
+      return true;
+    }
+    void await_suspend(std::coroutine_handle<> proc) {
+      res.waiting.push_back(proc);
+    }
+    void await_resume() const noexcept {}
+  };
+
+  /**
+   * @brief Construct a new Resource object with every server free
+   *
+   * @param servers The number of servers
+   * @param lineSize The room in the waiting line (see isFull())
+   */
+  Resource(int servers, size_t lineSize);
+
+  /**
+   * @brief Take a server, or wait in line for one, in a process
+   *
+   * The line takes the process even when it is full: isFull() is for the
+   * process to check before it asks.
+   *
+   * @return Acquire What the process co_awaits
+   */
+  Acquire acquire() { return Acquire{*this}; }
+
+  /**
+   * @brief Give a server back, to the first process in line if there is one
+   *
+   * That process is resumed by the calendar, after the events due now.
+   *
+   * @param cal The calendar
+   */
+  void release(Calendar& cal);
+
+  /**
+   * @brief Check whether a process asking now would find no room
+   *
+   * @return true Every server is busy and the line is full
+   */
+  bool isFull() const {
+    return busy >= servers && waiting.size() >= lineSize;
+  }
+
+  /**
+   * @brief Get the number of processes holding or waiting for a server
+   *
+   * @return size_t The processes
+   */
+  size_t getJobs() const { return busy + waiting.size(); }
+
+ private:
+  int servers;
+  size_t lineSize;
+  int busy;                                   // the servers held
+  std::deque<std::coroutine_handle<>> waiting;  // the line, first in front
+};
+
+// Allocates the frames of processes from chunks, and keeps the frames of
+// ended processes on a free list for each size, so starting a process costs
+// no call to the allocator once the pool has grown to the number of
+// processes alive at a time.
+//
+// The frames of processes that haven't ended when the pool goes away are
+// freed without their locals being destroyed: run the calendar dry first.
+class FramePool {
+ public:
+  /**
+   * @brief Construct an empty Frame Pool object
+   *
+   * @param chunkBytes The memory allocated at a time
+   */
+  explicit FramePool(size_t chunkBytes = 1 << 16);
+
+  /**
+   * @brief Take a frame from the pool
+   *
+   * @param bytes The size of the frame
+   * @return void* The frame, aligned for any type
+   */
+  void* allocate(size_t bytes);
+
+  /**
+   * @brief Give a frame back to the pool
+   *
+   * @param frame The frame
+   * @param bytes The size it was taken with
+   */
+  void release(void* frame, size_t bytes);
+
+  /**
+   * @brief Get the most frames that were in use at a time
+   *
+   * @return size_t The frames
+   */
+  size_t getPeak() const { return peak; }
+
+  /**
+   * @brief Get the memory of the pool
+   *
+   * @return size_t The bytes of its chunks
+   */
+  size_t getBytes() const { return totalBytes; }
+
+ private:
+  // the alignment of every frame, and the unit of the sizes
+  static const size_t ALIGN{alignof(std::max_align_t)};
+
+  // a free frame
+  struct Slot {
+    Slot* next;
+  };
+
+  size_t chunkBytes;
+  std::vector<std::unique_ptr<std::max_align_t[]>> chunks;
+  size_t chunkUsed;             // of the last chunk
+  size_t totalBytes;            // of all the chunks
+  std::vector<Slot*> freeLists;  // by size, in units of ALIGN
+  size_t live;
+  size_t peak;
+};
+
+template <typename... Args>
+void* Process::promise_type::operator new(size_t bytes, FramePool& pool,
+                                          Args&...) {
+  size_t frameBytes{(bytes + alignof(FramePool*) - 1) /
+                    alignof(FramePool*) * alignof(FramePool*)};
+  char* frame{static_cast<char*>(
+      pool.allocate(frameBytes + sizeof(FramePool*)))};
+  *reinterpret_cast<FramePool**>(frame + frameBytes) = &pool;
+  return frame;
+}
+
+inline void Process::promise_type::operator delete(void* frame,
+                                                   size_t bytes) {
+  size_t frameBytes{(bytes + alignof(FramePool*) - 1) /
+                    alignof(FramePool*) * alignof(FramePool*)};
+  FramePool* pool{*reinterpret_cast<FramePool**>(static_cast<char*>(frame) +
+                                                 frameBytes)};
+  pool->release(frame, frameBytes + sizeof(FramePool*));
+}
+
+#endif
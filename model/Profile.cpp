@@ -0,0 +1,150 @@
+#include "Profile.h"
+
+#ifdef LBSIM_PROFILE
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+// The merged call tree of all threads, printed when the program exits
+class ProfRegistry {
+ public:
+  ProfRegistry()
+      : threads{0},
+        startTicks{profTicks()},
+        startTime{wallTime()} {
+    nodes.push_back(ProfNode{nullptr, 0, 0, 0, 0, {}});
+  }
+
+  ~ProfRegistry() { report(); }
+
+  // add a thread's tree to the merged one
+  void merge(const std::vector<ProfNode>& tree) {
+    std::lock_guard<std::mutex> guard{lock};
+    ++threads;
+    mergeNode(tree, 0, 0);
+  }
+
+ private:
+  // merge a thread's node (and everything under it) into a merged node
+  void mergeNode(const std::vector<ProfNode>& tree, size_t from, size_t to) {
+    nodes[to].calls += tree[from].calls;
+    nodes[to].ticks += tree[from].ticks;
+    nodes[to].childTicks += tree[from].childTicks;
+
+    for (size_t child : tree[from].children) {
+      // sites are told apart by name, in case an inline function's site was
+      // instantiated more than once
+      size_t match{0};
+      for (size_t idx : nodes[to].children) {
+        if (std::strcmp(nodes[idx].site->name, tree[child].site->name) == 0 &&
+            nodes[idx].site->isCounter == tree[child].site->isCounter) {
+          match = idx;
+          break;
+        }
+      }
+      if (match == 0) {
+        match = nodes.size();
+        nodes.push_back(ProfNode{tree[child].site, to, 0, 0, 0, {}});
+        nodes[to].children.push_back(match);
+      }
+      mergeNode(tree, child, match);
+    }
+  }
+
+  // whether a node is a counter named "jobs"
+  bool isJobs(const ProfNode& node) const {
+    return node.site && node.site->isCounter &&
+           std::strcmp(node.site->name, "jobs") == 0;
+  }
+
+  // the "jobs" counted right under a node (by the run it times)
+  uint64_t runJobs(size_t idx) const {
+    uint64_t jobs{0};
+    for (size_t child : nodes[idx].children) {
+      if (isJobs(nodes[child])) jobs += nodes[child].calls;
+    }
+    return jobs;
+  }
+
+  // the "jobs" counted anywhere under a node (by the runs it encloses)
+  uint64_t subtreeJobs(size_t idx) const {
+    uint64_t jobs{0};
+    for (size_t child : nodes[idx].children) {
+      jobs += isJobs(nodes[child]) ? nodes[child].calls : subtreeJobs(child);
+    }
+    return jobs;
+  }
+
+  // a scope's time per job is per the jobs of the run it is in (enclosing
+  // it, or enclosed by it), so the runs of a process are not mixed up
+  void printNode(size_t idx, int depth, double nsPerTick,
+                 uint64_t outerJobs) const {
+    const ProfNode& node{nodes[idx]};
+    uint64_t jobs{runJobs(idx)};
+    if (jobs == 0) jobs = outerJobs;
+    if (jobs == 0) jobs = subtreeJobs(idx);
+    std::string name(2 * depth, ' ');
+    name += node.site->name;
+
+    if (node.site->isCounter) {
+      std::fprintf(stderr, "%-40s %12llu\n", name.c_str(),
+                   static_cast<unsigned long long>(node.calls));
+    } else {
+      double total{node.ticks * nsPerTick};
+      double self{(node.ticks - node.childTicks) * nsPerTick};
+      std::fprintf(stderr, "%-40s %12llu %12.3f %12.3f ", name.c_str(),
+                   static_cast<unsigned long long>(node.calls), total / 1e6,
+                   self / 1e6);
+      if (jobs > 0) {
+        std::fprintf(stderr, "%10.1f\n", total / jobs);
+      } else {
+        std::fprintf(stderr, "%10s\n", "-");  // outside of any run
+      }
+    }
+    for (size_t child : node.children) {
+      printNode(child, depth + 1, nsPerTick, jobs);
+    }
+  }
+
+  void report() const {
+    if (nodes[0].children.empty()) return;
+
+    // the counter's rate, from the wall time since the start
+    double elapsedNs{(wallTime() - startTime) * 1e9};
+    uint64_t elapsedTicks{profTicks() - startTicks};
+    double nsPerTick{elapsedTicks > 0 ? elapsedNs / elapsedTicks : 1.0};
+    std::fprintf(stderr, "\nprofile: %d threads, %.3f GHz ticks\n", threads,
+                 1.0 / nsPerTick);
+    std::fprintf(stderr, "%-40s %12s %12s %12s %10s\n", "scope", "calls",
+                 "total ms", "self ms", "ns/job");
+    for (size_t child : nodes[0].children) printNode(child, 0, nsPerTick, 0);
+  }
+
+  std::vector<ProfNode> nodes;
+  int threads;
+  uint64_t startTicks;
+  double startTime;  // the wall time, in seconds
+  std::mutex lock;
+};
+
+// the merged tree, constructed before any thread's tree so it outlives them
+static ProfRegistry& profRegistry() {
+  static ProfRegistry registry;
+  return registry;
+}
+
+ProfThread::ProfThread() : current{0} {
+  profRegistry();
+  nodes.push_back(ProfNode{nullptr, 0, 0, 0, 0, {}});
+}
+
+ProfThread::~ProfThread() { profRegistry().merge(nodes); }
+
+size_t ProfThread::addChild(size_t parent, const ProfSite& site) {
+  nodes.push_back(ProfNode{&site, parent, 0, 0, 0, {}});
+  nodes[parent].children.push_back(nodes.size() - 1);
+  return nodes.size() - 1;
+}
+
+#endif
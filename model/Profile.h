@@ -0,0 +1,178 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+// Hot-path instrumentation, compiled in with -DLBSIM_PROFILE (make PROFILE=1,
+// after a make clean).
+//
+//   PROF_SCOPE("name");     times the rest of the enclosing block
+//   PROF_COUNT("name", n);  adds n to a counter under the current scope
+//
+// Without LBSIM_PROFILE both expand to nothing and their arguments are not
+// evaluated. With it, a scope costs two time-stamp counter reads and a short
+// lookup in its thread's call tree. Each thread builds its own tree (no locks
+// on the hot path) and merges it into the process-wide one when it exits;
+// the merged tree is printed to stderr at exit, with the calls, total and
+// self time of every scope, and the time per job of the run it belongs to
+// (the counter named "jobs" under the run's scope).
+
+#ifdef LBSIM_PROFILE
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "WallClock.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// A place in the code that is timed or counted
+struct ProfSite {
+  const char* name;
+  bool isCounter;
+};
+
+// A node of a call tree: a site reached through a given chain of scopes
+struct ProfNode {
+  const ProfSite* site;  // nullptr for the root
+  size_t parent;
+  uint64_t calls;        // the calls, or the counter's total
+  uint64_t ticks;        // the time inside the scope
+  uint64_t childTicks;   // the part of it spent in nested scopes
+  std::vector<size_t> children;
+};
+
+/**
+ * @brief Read the time-stamp counter (a monotonic clock in ns elsewhere)
+ *
+ * @return uint64_t The counter
+ */
+inline uint64_t profTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return static_cast<uint64_t>(wallTime() * 1e9);
+#endif
+}
+
+// The call tree of one thread
+class ProfThread {
+ public:
+  /**
+   * @brief Construct an empty tree (making sure the merged one exists)
+   */
+  ProfThread();
+
+  /**
+   * @brief Merge the tree into the process-wide one
+   */
+  ~ProfThread();
+
+  /**
+   * @brief Enter a scope under the current one
+   *
+   * @param site The scope's site
+   * @return size_t The scope's node, to leave it
+   */
+  size_t enter(const ProfSite& site) {
+    size_t node{child(current, site)};
+    ++nodes[node].calls;
+    current = node;
+    return node;
+  }
+
+  /**
+   * @brief Leave a scope, going back to its parent
+   *
+   * @param node The node enter() returned
+   * @param ticks The time spent in the scope
+   */
+  void leave(size_t node, uint64_t ticks) {
+    nodes[node].ticks += ticks;
+    current = nodes[node].parent;
+    nodes[current].childTicks += ticks;
+  }
+
+  /**
+   * @brief Add to a counter under the current scope
+   *
+   * @param site The counter's site
+   * @param n The amount to add
+   */
+  void count(const ProfSite& site, uint64_t n) {
+    nodes[child(current, site)].calls += n;
+  }
+
+  /**
+   * @brief Get the tree
+   *
+   * @return const std::vector<ProfNode>& The nodes, the root first
+   */
+  const std::vector<ProfNode>& getNodes() const { return nodes; }
+
+ private:
+  // find (or add) the node of a site under a parent
+  size_t child(size_t parent, const ProfSite& site) {
+    for (size_t idx : nodes[parent].children) {
+      if (nodes[idx].site == &site) return idx;
+    }
+    return addChild(parent, site);
+  }
+
+  size_t addChild(size_t parent, const ProfSite& site);
+
+  std::vector<ProfNode> nodes;
+  size_t current;
+};
+
+/**
+ * @brief Get the calling thread's call tree
+ *
+ * @return ProfThread& The tree, created on first use
+ */
+inline ProfThread& profThread() {
+  thread_local ProfThread thread;
+  return thread;
+}
+
+// Times a scope, from its construction to its destruction
+class ProfScope {
+ public:
+  explicit ProfScope(const ProfSite& site)
+      : thread{profThread()}, node{thread.enter(site)}, start{profTicks()} {}
+  ~ProfScope() { thread.leave(node, profTicks() - start); }
+
+  ProfScope(const ProfScope&) = delete;
+  ProfScope& operator=(const ProfScope&) = delete;
+
+ private:
+  ProfThread& thread;
+  size_t node;
+  uint64_t start;
+};
+
+#define PROF_CONCAT_(a, b) a##b
+#define PROF_CONCAT(a, b) PROF_CONCAT_(a, b)
+
+#define PROF_SCOPE(name)                                              \
+  static const ProfSite PROF_CONCAT(profSite_, __LINE__){name, false}; \
+  ProfScope PROF_CONCAT(profScope_, __LINE__) {                       \
+    PROF_CONCAT(profSite_, __LINE__)                                  \
+  }
+
+#define PROF_COUNT(name, n)                          \
+  do {                                               \
+    static const ProfSite profCounter_{name, true};  \
+    profThread().count(profCounter_, (n));           \
+  } while (0)
+
+#else
+
+#define PROF_SCOPE(name) ((void)0)
+#define PROF_COUNT(name, n) ((void)0)
+
+#endif
+
+#endif
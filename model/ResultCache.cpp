@@ -0,0 +1,306 @@
+#include "ResultCache.h"
+
+#include <fcntl.h>
+#include <link.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+// the first bytes of every entry, and the layout version that follows them
+const char CACHE_MAGIC[4] = {'L', 'B', 'R', 'C'};
+const uint32_t CACHE_FORMAT{5};
+
+// Append the raw bytes of a value to a buffer
+template <typename T>
+static void put(std::string& buf, T value) {
+  buf.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// Read values back from a buffer, failing once it runs out
+class EntryReader {
+ public:
+  EntryReader(const std::string& buf) : buf{buf}, pos{0}, ok{true} {}
+
+  template <typename T>
+  T get() {
+    T value{};
+    if (pos + sizeof(T) > buf.size()) {
+      ok = false;
+      return value;
+    }
+    std::memcpy(&value, buf.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return value;
+  }
+
+  std::string getString(size_t len) {
+    if (pos + len > buf.size()) {
+      ok = false;
+      return "";
+    }
+    std::string value{buf.substr(pos, len)};
+    pos += len;
+    return value;
+  }
+
+  bool isOk() const { return ok && pos == buf.size(); }
+
+  bool isGood() const { return ok; }
+
+ private:
+  const std::string& buf;
+  size_t pos;
+  bool ok;
+};
+
+// Append a histogram's non-empty buckets to a buffer
+static void putHistogram(std::string& buf, const Histogram& hist) {
+  uint32_t used{0};
+  for (size_t ii = 0; ii < Histogram::NUM_BUCKETS; ii++) {
+    if (hist.getBucket(ii) > 0) ++used;
+  }
+
+  put<uint32_t>(buf, used);
+  for (size_t ii = 0; ii < Histogram::NUM_BUCKETS; ii++) {
+    if (hist.getBucket(ii) == 0) continue;
+    put<uint32_t>(buf, ii);
+    put<uint64_t>(buf, hist.getBucket(ii));
+  }
+}
+
+// Read a histogram written by putHistogram()
+static bool getHistogram(EntryReader& in, Histogram& hist) {
+  hist.clear();
+  uint32_t used{in.get<uint32_t>()};
+  for (uint32_t ii = 0; ii < used && in.isGood(); ii++) {
+    uint32_t idx{in.get<uint32_t>()};
+    uint64_t count{in.get<uint64_t>()};
+    if (idx >= Histogram::NUM_BUCKETS) return false;
+    hist.addToBucket(idx, count);
+  }
+  return in.isGood();
+}
+
+// the bytes of an ELF note's name or description, padded to the alignment
+static size_t notePadded(size_t bytes, size_t align) {
+  return (bytes + align - 1) & ~(align - 1);
+}
+
+// Find the running program's GNU build id among the notes the linker put in
+// its headers, and hash it (0 if it has none). This reads mapped memory, so
+// a lookup stays in microseconds however large the binary is.
+static int hashBuildIdNote(dl_phdr_info* info, size_t, void* data) {
+  for (int ii = 0; ii < info->dlpi_phnum; ii++) {
+    const ElfW(Phdr)& segment{info->dlpi_phdr[ii]};
+    if (segment.p_type != PT_NOTE) continue;
+
+    size_t align{segment.p_align == 8 ? 8u : 4u};
+    const char* at{
+        reinterpret_cast<const char*>(info->dlpi_addr + segment.p_vaddr)};
+    const char* end{at + segment.p_memsz};
+    while (at + sizeof(ElfW(Nhdr)) <= end) {
+      const ElfW(Nhdr)* note{reinterpret_cast<const ElfW(Nhdr)*>(at)};
+      const char* name{at + sizeof(ElfW(Nhdr))};
+      const char* desc{name + notePadded(note->n_namesz, align)};
+      if (note->n_type == NT_GNU_BUILD_ID && note->n_namesz == 4 &&
+          std::memcmp(name, "GNU", 4) == 0) {
+        *static_cast<uint64_t*>(data) =
+            ResultCache::hash(std::string{desc, note->n_descsz});
+        return 1;
+      }
+      at = desc + notePadded(note->n_descsz, align);
+    }
+  }
+  return 1;  // the first object is the program; the libraries don't matter
+}
+
+// the running binary's build id, looked up once
+static uint64_t buildId() {
+  static const uint64_t id{[]() {
+    uint64_t h{0};
+    dl_iterate_phdr(hashBuildIdNote, &h);
+    return h;
+  }()};
+  return id;
+}
+
+ResultCache::ResultCache(const std::string& dir) : dir{dir} {
+  mkdir(dir.c_str(), 0755);  // it's fine if it already exists
+}
+
+std::string ResultCache::describe(const CacheKey& key) {
+  std::ostringstream text;
+  text.precision(17);  // round-trip the arrival clock exactly
+
+  text << "version=" << SIM_VERSION << ";build=" << std::hex << buildId()
+       << std::dec
+       << ";model=" << (key.model == Model::mqms ? "mqms" : "sqms")
+       << ";policy=" << key.policy << ";nNodes=" << key.nNodes
+       << ";qSize=" << key.qSize << ";nJobs=" << key.nJobs
+       << ";warmup=" << key.warmup << ";pipeline=" << key.pipelined
+       << ";seed=" << key.start.rngSeed
+       << ";clock=" << key.start.arrival
+       << ";service=exponential(" << SERVICE_MEAN << ")"
+       << ";interarrival=uniform(0," << HOUR_SEC << ")";
+
+  return text.str();
+}
+
+uint64_t ResultCache::hash(const std::string& text) {
+  uint64_t h{14695981039346656037ULL};
+  for (unsigned char c : text) {
+    h ^= c;
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+std::string ResultCache::pathFor(const std::string& text) const {
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.bin",
+           static_cast<unsigned long long>(hash(text)));
+  return dir + "/" + name;
+}
+
+bool ResultCache::load(const CacheKey& key, SimResult& result,
+                       EngineState& end) const {
+  std::string text{describe(key)};
+
+  int fd{open(pathFor(text).c_str(), O_RDONLY)};
+  if (fd < 0) return false;
+
+  // entries are small, so read the whole file in one go
+  std::string buf;
+  struct stat info;
+  if (fstat(fd, &info) == 0 && info.st_size > 0) {
+    buf.resize(info.st_size);
+    ssize_t got{read(fd, &buf[0], buf.size())};
+    if (got != static_cast<ssize_t>(buf.size())) buf.clear();
+  }
+  close(fd);
+  if (buf.size() < sizeof(CACHE_MAGIC) ||
+      std::memcmp(buf.data(), CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0) {
+    return false;
+  }
+
+  EntryReader in{buf};
+  in.getString(sizeof(CACHE_MAGIC));
+  if (in.get<uint32_t>() != CACHE_FORMAT) return false;
+
+  // guard against hash collisions
+  uint32_t textLen{in.get<uint32_t>()};
+  if (in.getString(textLen) != text) return false;
+
+  SimResult loaded;
+  loaded.model = key.model;
+  loaded.totalRejects = in.get<int64_t>();
+  loaded.nJobs = in.get<int64_t>();
+  loaded.resetJob = in.get<int64_t>();
+  loaded.warmup.detected = in.get<uint8_t>() != 0;
+  loaded.warmup.truncObs = in.get<int64_t>();
+  loaded.warmup.truncJob = in.get<int64_t>();
+  loaded.warmup.numObs = in.get<int64_t>();
+
+  EngineState state;
+  state.rngSeed = in.get<int64_t>();
+  state.arrival = in.get<double>();
+
+  uint32_t nNodes{in.get<uint32_t>()};
+  if (nNodes != static_cast<uint32_t>(key.nNodes)) return false;
+  loaded.stats.resize(nNodes);
+  for (NodeStats& node : loaded.stats) {
+    node.id = in.get<int32_t>();
+    node.maxQueueLen = in.get<int32_t>();
+    node.util = in.get<double>();
+    node.avgSt = in.get<double>();
+    node.avgQ = in.get<double>();
+    node.avgD = in.get<double>();
+    node.nJobs = in.get<int64_t>();
+    node.sdSt = in.get<double>();
+    node.avgW = in.get<double>();
+    node.sdW = in.get<double>();
+    node.sdD = in.get<double>();
+    node.pD50 = in.get<double>();
+    node.pD99 = in.get<double>();
+    node.pD999 = in.get<double>();
+    node.pW50 = in.get<double>();
+    node.pW99 = in.get<double>();
+    node.pW999 = in.get<double>();
+  }
+  if (!getHistogram(in, loaded.delayHist) ||
+      !getHistogram(in, loaded.waitHist)) {
+    return false;
+  }
+
+  if (!in.isOk()) return false;
+
+  result = loaded;
+  end = state;
+  return true;
+}
+
+bool ResultCache::store(const CacheKey& key, const SimResult& result,
+                        const EngineState& end) const {
+  std::string text{describe(key)};
+
+  std::string buf;
+  buf.append(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+  put<uint32_t>(buf, CACHE_FORMAT);
+  put<uint32_t>(buf, text.size());
+  buf += text;
+
+  put<int64_t>(buf, result.totalRejects);
+  put<int64_t>(buf, result.nJobs);
+  put<int64_t>(buf, result.resetJob);
+  put<uint8_t>(buf, result.warmup.detected);
+  put<int64_t>(buf, result.warmup.truncObs);
+  put<int64_t>(buf, result.warmup.truncJob);
+  put<int64_t>(buf, result.warmup.numObs);
+
+  put<int64_t>(buf, end.rngSeed);
+  put<double>(buf, end.arrival);
+
+  put<uint32_t>(buf, result.stats.size());
+  for (const NodeStats& node : result.stats) {
+    put<int32_t>(buf, node.id);
+    put<int32_t>(buf, node.maxQueueLen);
+    put<double>(buf, node.util);
+    put<double>(buf, node.avgSt);
+    put<double>(buf, node.avgQ);
+    put<double>(buf, node.avgD);
+    put<int64_t>(buf, node.nJobs);
+    put<double>(buf, node.sdSt);
+    put<double>(buf, node.avgW);
+    put<double>(buf, node.sdW);
+    put<double>(buf, node.sdD);
+    put<double>(buf, node.pD50);
+    put<double>(buf, node.pD99);
+    put<double>(buf, node.pD999);
+    put<double>(buf, node.pW50);
+    put<double>(buf, node.pW99);
+    put<double>(buf, node.pW999);
+  }
+  putHistogram(buf, result.delayHist);
+  putHistogram(buf, result.waitHist);
+
+  // write to a name no other worker uses, then rename it into place
+  static std::atomic<unsigned> counter{0};
+  std::string path{pathFor(text)};
+  std::string tmp{path + ".tmp." + std::to_string(getpid()) + "." +
+                  std::to_string(counter++)};
+
+  int fd{open(tmp.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644)};
+  if (fd < 0) return false;
+
+  bool ok{write(fd, buf.data(), buf.size()) ==
+          static_cast<ssize_t>(buf.size())};
+  ok = (close(fd) == 0) && ok;
+  ok = ok && rename(tmp.c_str(), path.c_str()) == 0;
+  if (!ok) unlink(tmp.c_str());
+
+  return ok;
+}
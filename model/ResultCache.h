@@ -0,0 +1,93 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <cstdint>
+#include <string>
+
+#include "Simulation.h"
+
+// Everything that determines the outcome of a simulation run
+struct CacheKey {
+  Model model;         // the model simulated
+  std::string policy;  // the load-balancing algorithm's name
+  int nNodes;          // the number of nodes
+  size_t qSize;        // the queue size
+  long long nJobs;     // the number of jobs
+  bool warmup;         // whether the warm-up is truncated
+  bool pipelined;      // whether the stages ran on separate threads
+  EngineState start;   // the RNG seed and arrival clock
+};
+
+// An on-disk cache of simulation results.
+//
+// Each entry is a small binary file named after a stable 64-bit hash of the
+// key. Entries are written to a temporary file and renamed into place, so
+// concurrent sweep workers sharing a directory only ever see whole entries.
+class ResultCache {
+ public:
+  /**
+   * @brief Construct a new Result Cache object
+   *
+   * The directory is created if it does not exist yet.
+   *
+   * @param dir The directory the entries are kept in
+   */
+  ResultCache(const std::string& dir);
+
+  /**
+   * @brief Look up the result of a run
+   *
+   * @param key The run to look up
+   * @param result Set to the stored statistics on a hit
+   * @param end Set to the engine state the run left behind on a hit
+   * @return true The run was found
+   * @return false The run is not cached (or the entry was unusable)
+   */
+  bool load(const CacheKey& key, SimResult& result, EngineState& end) const;
+
+  /**
+   * @brief Store the result of a run
+   *
+   * @param key The run that was simulated
+   * @param result The statistics of the run
+   * @param end The engine state the run left behind
+   * @return true The entry was written
+   * @return false The entry could not be written
+   */
+  bool store(const CacheKey& key, const SimResult& result,
+             const EngineState& end) const;
+
+  /**
+   * @brief Describe a key as text, the form that is hashed
+   *
+   * Besides the run, it names the binary (a hash of the build id the linker
+   * gives it, see LDFLAGS), so a rebuild never serves the results of the
+   * previous build.
+   *
+   * @param key The run to describe
+   * @return std::string The canonical description of the run
+   */
+  static std::string describe(const CacheKey& key);
+
+  /**
+   * @brief Hash a key's description (64-bit FNV-1a)
+   *
+   * @param text The description to hash
+   * @return uint64_t The hash
+   */
+  static uint64_t hash(const std::string& text);
+
+ private:
+  /**
+   * @brief Get the file name of the entry for a description
+   *
+   * @param text The description of the run
+   * @return std::string The path of the entry
+   */
+  std::string pathFor(const std::string& text) const;
+
+  // the directory the entries are kept in
+  std::string dir;
+};
+
+#endif
@@ -0,0 +1,207 @@
+#include "ResultWriter.h"
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "Profile.h"
+
+std::vector<double>& ColumnTable::addColumn(const std::string& name) {
+  names.push_back(name);
+  if (columns.size() < names.size()) columns.emplace_back();
+  std::vector<double>& column{columns[names.size() - 1]};
+  column.clear();
+  return column;
+}
+
+void ColumnTable::clear() {
+  path.clear();
+  names.clear();
+  // the columns are kept (with their capacity) and reused by addColumn()
+}
+
+// the lookup table of the CRC-32 zip uses
+static std::array<uint32_t, 256> buildCrcTable() {
+  std::array<uint32_t, 256> table;
+  for (uint32_t ii = 0; ii < 256; ii++) {
+    uint32_t c{ii};
+    for (int bit = 0; bit < 8; bit++) {
+      c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+    }
+    table[ii] = c;
+  }
+  return table;
+}
+
+// continue a CRC-32 over more data
+static uint32_t crc32(const char* data, size_t len, uint32_t crc = 0) {
+  static const std::array<uint32_t, 256> table{buildCrcTable()};
+
+  crc = ~crc;
+  for (size_t ii = 0; ii < len; ii++) {
+    crc = table[(crc ^ static_cast<uint8_t>(data[ii])) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+// Append a little-endian integer to a buffer
+template <typename T>
+static void putLE(std::string& buf, T value) {
+  for (size_t ii = 0; ii < sizeof(T); ii++) {
+    buf += static_cast<char>((value >> (8 * ii)) & 0xFF);
+  }
+}
+
+// The .npy header of a 1-d float64 array, padded to a multiple of 64 bytes
+static std::string npyHeader(size_t length) {
+  std::string dict{"{'descr': '<f8', 'fortran_order': False, 'shape': (" +
+                   std::to_string(length) + ",), }"};
+  size_t total{10 + dict.size() + 1};
+  dict.append((64 - total % 64) % 64, ' ');
+  dict += '\n';
+
+  std::string header{"\x93NUMPY\x01\x00", 8};
+  putLE<uint16_t>(header, dict.size());
+  return header + dict;
+}
+
+bool writeNpz(const ColumnTable& table) {
+  PROF_SCOPE("writeNpz");
+  FILE* out{std::fopen(table.path.c_str(), "wb")};
+  if (!out) return false;
+
+  std::string central;  // the central directory, written after the members
+  uint32_t offset{0};
+  bool ok{true};
+
+  for (size_t col = 0; col < table.names.size() && ok; col++) {
+    const std::vector<double>& values{table.columns[col]};
+    std::string name{table.names[col] + ".npy"};
+    std::string header{npyHeader(values.size())};
+
+    // the values are written as they are in memory, which is little-endian
+    // on every platform this runs on
+    const char* data{reinterpret_cast<const char*>(values.data())};
+    size_t dataLen{values.size() * sizeof(double)};
+    uint32_t crc{crc32(header.data(), header.size())};
+    crc = crc32(data, dataLen, crc);
+    uint32_t size{static_cast<uint32_t>(header.size() + dataLen)};
+
+    // the local file header: stored (no compression), no timestamp
+    std::string local;
+    putLE<uint32_t>(local, 0x04034b50);
+    putLE<uint16_t>(local, 20);  // version needed
+    putLE<uint16_t>(local, 0);   // flags
+    putLE<uint16_t>(local, 0);   // stored
+    putLE<uint32_t>(local, 0);   // time and date
+    putLE<uint32_t>(local, crc);
+    putLE<uint32_t>(local, size);
+    putLE<uint32_t>(local, size);
+    putLE<uint16_t>(local, name.size());
+    putLE<uint16_t>(local, 0);  // no extra field
+    local += name;
+
+    putLE<uint32_t>(central, 0x02014b50);
+    putLE<uint16_t>(central, 20);  // version made by
+    putLE<uint16_t>(central, 20);  // version needed
+    putLE<uint16_t>(central, 0);
+    putLE<uint16_t>(central, 0);
+    putLE<uint32_t>(central, 0);
+    putLE<uint32_t>(central, crc);
+    putLE<uint32_t>(central, size);
+    putLE<uint32_t>(central, size);
+    putLE<uint16_t>(central, name.size());
+    putLE<uint16_t>(central, 0);  // extra field
+    putLE<uint16_t>(central, 0);  // comment
+    putLE<uint16_t>(central, 0);  // disk
+    putLE<uint16_t>(central, 0);  // internal attributes
+    putLE<uint32_t>(central, 0);  // external attributes
+    putLE<uint32_t>(central, offset);
+    central += name;
+
+    ok = std::fwrite(local.data(), 1, local.size(), out) == local.size() &&
+         std::fwrite(header.data(), 1, header.size(), out) == header.size() &&
+         std::fwrite(data, 1, dataLen, out) == dataLen;
+    offset += local.size() + size;
+  }
+
+  // the end of the central directory
+  std::string end;
+  putLE<uint32_t>(end, 0x06054b50);
+  putLE<uint16_t>(end, 0);
+  putLE<uint16_t>(end, 0);
+  putLE<uint16_t>(end, table.names.size());
+  putLE<uint16_t>(end, table.names.size());
+  putLE<uint32_t>(end, central.size());
+  putLE<uint32_t>(end, offset);
+  putLE<uint16_t>(end, 0);
+
+  ok = ok &&
+       std::fwrite(central.data(), 1, central.size(), out) == central.size() &&
+       std::fwrite(end.data(), 1, end.size(), out) == end.size();
+  ok = std::fclose(out) == 0 && ok;
+  return ok;
+}
+
+ResultWriter::ResultWriter()
+    : back{0}, pending{false}, stop{false}, failures{0} {
+  worker = std::thread(&ResultWriter::run, this);
+}
+
+ResultWriter::~ResultWriter() {
+  {
+    std::unique_lock<std::mutex> guard{lock};
+    changed.wait(guard, [this]() { return !pending; });
+    stop = true;
+  }
+  changed.notify_all();
+  worker.join();
+}
+
+ColumnTable& ResultWriter::buffer() { return tables[back]; }
+
+void ResultWriter::submit() {
+  {
+    // only wait if the writer hasn't finished the previous table yet
+    std::unique_lock<std::mutex> guard{lock};
+    changed.wait(guard, [this]() { return !pending; });
+    back = 1 - back;
+    pending = true;
+  }
+  changed.notify_all();
+  tables[back].clear();
+}
+
+int ResultWriter::flush() {
+  std::unique_lock<std::mutex> guard{lock};
+  changed.wait(guard, [this]() { return !pending; });
+  return failures;
+}
+
+void ResultWriter::run() {
+  while (true) {
+    std::unique_lock<std::mutex> guard{lock};
+    changed.wait(guard, [this]() { return pending || stop; });
+    if (!pending) return;
+
+    // write the front table without holding the lock
+    ColumnTable& front{tables[1 - back]};
+    guard.unlock();
+    bool ok{writeNpz(front)};
+    if (!ok) {
+      std::fprintf(stderr, "Could not write %s\n", front.path.c_str());
+    }
+    guard.lock();
+
+    if (!ok) ++failures;
+    pending = false;
+    guard.unlock();
+    changed.notify_all();
+  }
+}
+
+ResultWriter& resultWriter() {
+  static ResultWriter writer;
+  return writer;
+}
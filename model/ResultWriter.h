@@ -0,0 +1,104 @@
+#ifndef RESULT_WRITER_H
+#define RESULT_WRITER_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Named columns of doubles, written out as one NumPy .npz archive.
+struct ColumnTable {
+  std::string path;                         // where the archive goes
+  std::vector<std::string> names;           // the name of each column
+  std::deque<std::vector<double>> columns;  // the values of each column
+
+  /**
+   * @brief Add a column and get it for filling
+   *
+   * The columns returned stay valid while more are added.
+   *
+   * @param name The column's name (the array's name in the archive)
+   * @return std::vector<double>& The new, empty column
+   */
+  std::vector<double>& addColumn(const std::string& name);
+
+  /**
+   * @brief Drop all columns, keeping their memory for the next table
+   */
+  void clear();
+};
+
+/**
+ * @brief Write a table as an uncompressed .npz archive
+ *
+ * Every column is stored as a 1-d little-endian float64 .npy member, so
+ * np.load() reads the file without parsing any text, and the members can be
+ * memory-mapped (see util/npz_mmap.py).
+ *
+ * @param table The table to write
+ * @return true The archive was written
+ * @return false The file could not be written
+ */
+bool writeNpz(const ColumnTable& table);
+
+// Writes result tables on a background thread.
+//
+// There are two tables: the simulation fills the back one while the writer
+// thread writes the front one to disk. submit() swaps them, and only waits
+// if the previous table is still being written.
+class ResultWriter {
+ public:
+  /**
+   * @brief Construct a new Result Writer object and start its thread
+   */
+  ResultWriter();
+
+  /**
+   * @brief Write what is left, then stop the thread
+   */
+  ~ResultWriter();
+
+  /**
+   * @brief Get the table to fill next (the back buffer)
+   *
+   * @return ColumnTable& An empty table
+   */
+  ColumnTable& buffer();
+
+  /**
+   * @brief Hand the filled table to the writer thread
+   */
+  void submit();
+
+  /**
+   * @brief Wait until every submitted table is on disk
+   *
+   * @return int The number of tables that could not be written so far
+   */
+  int flush();
+
+ private:
+  // the writer thread's loop
+  void run();
+
+  ColumnTable tables[2];
+  int back;      // the table being filled
+  bool pending;  // the front table still has to be written
+  bool stop;
+  int failures;
+
+  std::mutex lock;
+  std::condition_variable changed;
+  std::thread worker;
+};
+
+/**
+ * @brief Get the process-wide result writer
+ *
+ * @return ResultWriter& The writer, started on first use
+ */
+ResultWriter& resultWriter();
+
+#endif
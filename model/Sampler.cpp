@@ -0,0 +1,178 @@
+#include "Sampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+#include "Profile.h"
+
+// the most rows the columns are allocated for, however long the run
+const size_t MAX_SAMPLES{1 << 22};
+// the most memory the columns may take, however many nodes there are
+const size_t MAX_BYTES{size_t{256} << 20};
+// the rows allocated at first
+const size_t FIRST_ROWS{1024};
+
+Sampler::Sampler(double dt, double start, double span, int nNodes,
+                 const std::vector<SampleMetric>& metrics)
+    : dt{dt},
+      nextTick{start + dt},
+      metrics{metrics},
+      head{0},
+      count{0},
+      dropped{0} {
+  names.push_back("dispatch_q");
+  for (SampleMetric metric : metrics) {
+    const char* prefix{metric == SampleMetric::queue  ? "q"
+                       : metric == SampleMetric::busy ? "busy"
+                                                      : "util"};
+    for (int ii = 0; ii < nNodes; ii++) {
+      names.push_back(prefix + std::to_string(ii));
+    }
+  }
+
+  // the rows the run is expected to need, within both limits
+  size_t maxRows{MAX_BYTES / (sizeof(double) * (names.size() + 1))};
+  double rows{std::ceil(span / dt) + 1};
+  capacity = std::max<size_t>(1, std::min(maxRows, MAX_SAMPLES));
+  if (rows < capacity) capacity = static_cast<size_t>(rows);
+  columns.resize(names.size());
+}
+
+void Sampler::grow() {
+  size_t rows{std::min(capacity, std::max(FIRST_ROWS, 2 * times.size()))};
+  times.reserve(rows);  // exactly, no slack on top of the budget
+  times.resize(rows);
+  for (std::vector<double>& column : columns) {
+    column.reserve(rows);
+    column.resize(rows);
+  }
+}
+
+void Sampler::sample(double now, std::vector<ServiceNode>& nodes,
+                     size_t dispatchQueue) {
+  PROF_SCOPE("Sampler::sample");
+  while (nextTick <= now) {
+    size_t at{(head + count) % capacity};
+    if (at == times.size()) grow();
+    if (count == capacity) {
+      head = (head + 1) % capacity;  // overwrite the oldest row
+      ++dropped;
+    } else {
+      ++count;
+    }
+
+    times[at] = nextTick;
+    columns[0][at] = dispatchQueue;
+
+    size_t col{1};
+    for (ServiceNode& node : nodes) node.advanceTo(nextTick);
+    for (SampleMetric metric : metrics) {
+      for (const ServiceNode& node : nodes) {
+        columns[col++][at] = metric == SampleMetric::queue
+                                 ? node.getQueueLevel()
+                                 : metric == SampleMetric::busy
+                                       ? node.getBusyLevel()
+                                       : node.getUtilSoFar();
+      }
+    }
+
+    nextTick += dt;
+  }
+}
+
+size_t Sampler::getNumSamples() const { return count; }
+
+long long Sampler::getNumDropped() const { return dropped; }
+
+size_t Sampler::getNumColumns() const { return names.size(); }
+
+const std::string& Sampler::getName(size_t col) const { return names[col]; }
+
+size_t Sampler::slot(size_t row) const { return (head + row) % capacity; }
+
+double Sampler::getTime(size_t row) const { return times[slot(row)]; }
+
+double Sampler::getValue(size_t col, size_t row) const {
+  return columns[col][slot(row)];
+}
+
+void Sampler::toTable(ColumnTable& table, size_t rollup) const {
+  if (rollup <= 1) {
+    std::vector<double>& time{table.addColumn("time")};
+    for (size_t row = 0; row < count; row++) time.push_back(getTime(row));
+    for (size_t col = 0; col < names.size(); col++) {
+      std::vector<double>& column{table.addColumn(names[col])};
+      for (size_t row = 0; row < count; row++) {
+        column.push_back(getValue(col, row));
+      }
+    }
+    return;
+  }
+
+  // one row per group of samples, stamped with the group's first time
+  std::vector<double>& time{table.addColumn("time")};
+  for (size_t first = 0; first < count; first += rollup) {
+    time.push_back(getTime(first));
+  }
+  for (size_t col = 0; col < names.size(); col++) {
+    std::vector<double>& lows{table.addColumn(names[col] + "_min")};
+    std::vector<double>& highs{table.addColumn(names[col] + "_max")};
+    std::vector<double>& means{table.addColumn(names[col] + "_mean")};
+    for (size_t first = 0; first < count; first += rollup) {
+      size_t last{std::min(first + rollup, count)};
+      double lo{std::numeric_limits<double>::infinity()};
+      double hi{-lo};
+      double sum{0.0};
+      for (size_t row = first; row < last; row++) {
+        double value{getValue(col, row)};
+        lo = std::min(lo, value);
+        hi = std::max(hi, value);
+        sum += value;
+      }
+      lows.push_back(lo);
+      highs.push_back(hi);
+      means.push_back(sum / (last - first));
+    }
+  }
+}
+
+void Sampler::write(std::ostream& out, size_t rollup) const {
+  ColumnTable table;
+  toTable(table, rollup);
+
+  out << table.names[0];
+  for (size_t col = 1; col < table.names.size(); col++) {
+    out << "," << table.names[col];
+  }
+  out << "\n";
+
+  for (size_t row = 0; row < table.columns[0].size(); row++) {
+    out << table.columns[0][row];
+    for (size_t col = 1; col < table.names.size(); col++) {
+      out << "," << table.columns[col][row];
+    }
+    out << "\n";
+  }
+}
+
+bool parseMetrics(const std::string& list, std::vector<SampleMetric>& metrics) {
+  metrics.clear();
+
+  std::istringstream fields{list};
+  std::string name;
+  while (std::getline(fields, name, ',')) {
+    if (name == "queue") {
+      metrics.push_back(SampleMetric::queue);
+    } else if (name == "busy") {
+      metrics.push_back(SampleMetric::busy);
+    } else if (name == "util") {
+      metrics.push_back(SampleMetric::util);
+    } else {
+      return false;
+    }
+  }
+
+  return !metrics.empty();
+}
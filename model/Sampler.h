@@ -0,0 +1,154 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Node.h"
+#include "ResultWriter.h"
+
+// The per-node quantities a Sampler can record
+enum class SampleMetric {
+  queue,  // the number of jobs waiting in the node's queue
+  busy,   // the number of jobs in service
+  util    // the utilization since the statistics were last reset
+};
+
+// Records the state of the cluster every dt of simulated time.
+//
+// Every sample is one row of columns: the time, the length of the
+// dispatcher's queue and the chosen metrics of every node. The columns grow
+// as the samples come in, up to a byte budget; then they are rings, and a
+// run that outgrows them keeps its most recent samples. The simulation loop
+// only compares the arrival time with getNextTick() for each job, all other
+// work happens once per tick.
+class Sampler {
+ public:
+  /**
+   * @brief Construct a new Sampler object
+   *
+   * @param dt The simulated time between samples
+   * @param start The time the run starts at
+   * @param span How long the run is expected to last (sizes the columns)
+   * @param nNodes The number of nodes
+   * @param metrics The metrics to record for every node
+   */
+  Sampler(double dt, double start, double span, int nNodes,
+          const std::vector<SampleMetric>& metrics);
+
+  /**
+   * @brief Get the time of the next sample
+   *
+   * @return double The time the next sample is due
+   */
+  double getNextTick() const { return nextTick; }
+
+  /**
+   * @brief Record every sample that is due up to the given time
+   *
+   * The nodes are brought up to each tick before it is recorded.
+   *
+   * @param now The current time (an arrival at or after getNextTick())
+   * @param nodes The nodes of the simulation
+   * @param dispatchQueue The length of the dispatcher's queue
+   */
+  void sample(double now, std::vector<ServiceNode>& nodes,
+              size_t dispatchQueue);
+
+  /**
+   * @brief Get the number of samples kept
+   *
+   * @return size_t The number of rows
+   */
+  size_t getNumSamples() const;
+
+  /**
+   * @brief Get the number of samples overwritten because the rings were full
+   *
+   * @return long long The number of rows lost
+   */
+  long long getNumDropped() const;
+
+  /**
+   * @brief Get the number of value columns (the time is not counted)
+   *
+   * @return size_t The number of columns
+   */
+  size_t getNumColumns() const;
+
+  /**
+   * @brief Get the name of a column
+   *
+   * @param col The column's index
+   * @return const std::string& The name, e.g. "q3" for node 3's queue
+   */
+  const std::string& getName(size_t col) const;
+
+  /**
+   * @brief Get the time of a sample
+   *
+   * @param row The sample's index, oldest first
+   * @return double The sample's time
+   */
+  double getTime(size_t row) const;
+
+  /**
+   * @brief Get a value of a sample
+   *
+   * @param col The column's index
+   * @param row The sample's index, oldest first
+   * @return double The value
+   */
+  double getValue(size_t col, size_t row) const;
+
+  /**
+   * @brief Copy the samples into a table, with a time column first
+   *
+   * With a rollup of k > 1, every k samples are reduced to the min, max and
+   * mean of each column, in the columns <name>_min, <name>_max, <name>_mean.
+   *
+   * @param table The table to add the columns to
+   * @param rollup The number of samples per row (1: every sample)
+   */
+  void toTable(ColumnTable& table, size_t rollup) const;
+
+  /**
+   * @brief Write the samples as CSV, laid out as by toTable()
+   *
+   * @param out Where to write the samples to
+   * @param rollup The number of samples per row (1: every sample)
+   */
+  void write(std::ostream& out, size_t rollup) const;
+
+ private:
+  // the ring position of a row
+  size_t slot(size_t row) const;
+
+  // make room for more rows, up to the capacity
+  void grow();
+
+  double dt;
+  double nextTick;
+  std::vector<SampleMetric> metrics;
+  std::vector<std::string> names;
+
+  size_t capacity;  // the most rows kept
+  size_t head;      // the slot of the oldest row
+  size_t count;
+  long long dropped;
+  std::vector<double> times;
+  std::vector<std::vector<double>> columns;
+};
+
+/**
+ * @brief Parse a comma-separated list of metric names
+ *
+ * @param list e.g. "queue,busy"
+ * @param metrics Set to the metrics in the list
+ * @return true All names are known
+ * @return false A name is not one of queue, busy, util
+ */
+bool parseMetrics(const std::string& list, std::vector<SampleMetric>& metrics);
+
+#endif
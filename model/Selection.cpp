@@ -0,0 +1,169 @@
+#include "Selection.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+#include "LoadBalancing.h"
+#include "PerfCounters.h"
+#include "rngs.h"
+
+// the number of rngs streams, one per replication
+const int MAX_STREAMS{256};
+
+/**
+ * @brief Run one replication of an algorithm and measure it
+ *
+ * @param cfg The settings of the experiment
+ * @param lba The algorithm to simulate
+ * @param rep The index of the replication (selects the rngs stream)
+ * @return double The measured performance
+ */
+static double runReplication(const SelectionConfig& cfg, lba_alg lba,
+                             int rep) {
+  // every algorithm sees the same random numbers in replication 'rep'
+  PlantSeeds(cfg.seed);
+  SelectStream(rep);
+  resetArrival();
+
+  SimResult result{cfg.model == Model::mqms
+                       ? runMqms(cfg.nNodes, lba, cfg.qSize, cfg.nJobs,
+                                 cfg.opts)
+                       : runSqms(cfg.nNodes, lba, cfg.qSize, cfg.nJobs,
+                                 cfg.opts)};
+  SelectStream(0);
+
+  double measure{cfg.metric == SelectMetric::delay ? calcMeanDelay(result)
+                                                   : calcRejectRatio(result)};
+  perfLeave();
+  return measure;
+}
+
+SelectionResult selectBest(const SelectionConfig& cfg) {
+  int k{static_cast<int>(LBA_NAMES.size())};
+  int n0{std::max(cfg.n0, 2)};
+  int maxReps{std::min(std::max(cfg.maxReps, n0), MAX_STREAMS)};
+
+  SelectionResult result;
+  result.reps.assign(k, 0);
+  result.means.assign(k, 0.0);
+  result.eliminated.assign(k, 0);
+  result.totalReps = 0;
+
+  // the first-stage observations and the running sums of each algorithm
+  std::vector<std::vector<double>> first(k);
+  std::vector<double> sums(k, 0.0);
+
+  for (int ii = 0; ii < k; ii++) {
+    for (int rep = 0; rep < n0; rep++) {
+      double x{runReplication(cfg, ii, rep)};
+      first[ii].push_back(x);
+      sums[ii] += x;
+    }
+    result.reps[ii] = n0;
+    result.totalReps += n0;
+  }
+
+  // the indifference zone defaults to 5% of the best first-stage mean
+  double delta{cfg.delta};
+  if (delta <= 0.0) {
+    double best{sums[0]};
+    for (int ii = 1; ii < k; ii++) best = std::min(best, sums[ii]);
+    delta = std::max(std::fabs(best / n0) * 0.05, 1e-9);
+  }
+  result.delta = delta;
+
+  // the variance of the pairwise differences over the first stage
+  std::vector<std::vector<double>> varDiff(k, std::vector<double>(k, 0.0));
+  for (int ii = 0; ii < k; ii++) {
+    for (int ll = 0; ll < k; ll++) {
+      if (ii == ll) continue;
+      double mean{(sums[ii] - sums[ll]) / n0};
+      double ss{0.0};
+      for (int rep = 0; rep < n0; rep++) {
+        double diff{first[ii][rep] - first[ll][rep] - mean};
+        ss += diff * diff;
+      }
+      varDiff[ii][ll] = ss / (n0 - 1);
+    }
+  }
+
+  // the constants of the procedure
+  double alpha{1.0 - cfg.pcs};
+  double eta{0.5 * (std::pow(2.0 * alpha / (k - 1), -2.0 / (n0 - 1)) - 1.0)};
+  double hSq{2.0 * eta * (n0 - 1)};
+
+  std::vector<int> contenders;
+  for (int ii = 0; ii < k; ii++) contenders.push_back(ii);
+
+  int rep{n0};
+  while (true) {
+    // screen every contender against every other one
+    std::vector<int> survivors;
+    for (int ii : contenders) {
+      bool keep{true};
+      for (int ll : contenders) {
+        if (ii == ll) continue;
+        double w{delta / (2.0 * rep) *
+                 (hSq * varDiff[ii][ll] / (delta * delta) - rep)};
+        w = std::max(w, 0.0);
+        if (sums[ii] / rep > sums[ll] / rep + w) {
+          keep = false;
+          break;
+        }
+      }
+      if (keep) {
+        survivors.push_back(ii);
+      } else {
+        result.eliminated[ii] = rep;
+      }
+    }
+    contenders = survivors;
+
+    if (contenders.size() <= 1 || rep >= maxReps) break;
+
+    // take one more replication from the contenders only
+    for (int ii : contenders) {
+      sums[ii] += runReplication(cfg, ii, rep);
+      result.reps[ii]++;
+      result.totalReps++;
+    }
+    rep++;
+  }
+
+  for (int ii = 0; ii < k; ii++) result.means[ii] = sums[ii] / result.reps[ii];
+
+  // when the budget runs out, fall back to the best sample mean
+  result.best = contenders[0];
+  for (int ii : contenders) {
+    if (result.means[ii] < result.means[result.best]) result.best = ii;
+  }
+
+  return result;
+}
+
+void printSelection(const SelectionConfig& cfg, const SelectionResult& result) {
+  std::string unit{cfg.metric == SelectMetric::delay ? "avg_d" : "rejects%"};
+
+  std::cout << "Ranking and selection (KN), P(CS) >= " << cfg.pcs
+            << ", indifference zone " << result.delta << " (" << unit << ")"
+            << std::endl;
+
+  for (size_t ii = 0; ii < LBA_NAMES.size(); ii++) {
+    std::cout << std::setw(12) << LBA_NAMES[ii] << ": reps: " << std::setw(4)
+              << result.reps[ii] << ", " << unit << ": " << std::setw(8)
+              << result.means[ii];
+    if ((int)ii == result.best) {
+      std::cout << ", selected";
+    } else if (result.eliminated[ii] > 0) {
+      std::cout << ", eliminated after " << result.eliminated[ii] << " reps";
+    } else {
+      std::cout << ", still a contender after " << result.reps[ii] << " reps";
+    }
+    std::cout << std::endl;
+  }
+
+  std::cout << "Best algorithm: " << LBA_NAMES[result.best] << " ("
+            << result.totalReps << " replications in total)" << std::endl;
+}
@@ -0,0 +1,58 @@
+#ifndef SELECTION_H
+#define SELECTION_H
+
+#include <vector>
+
+#include "Simulation.h"
+
+// The performance measure the policies are ranked on (smaller is better)
+enum class SelectMetric { delay, rejects };
+
+// The settings of a ranking-and-selection experiment
+struct SelectionConfig {
+  Model model;          // the model to simulate
+  int nNodes;           // the number of nodes in the model
+  size_t qSize;         // the queue size
+  long long nJobs;      // the number of jobs per replication
+  long seed;            // the seed the replication streams are planted from
+  SelectMetric metric;  // the measure to minimize
+  double pcs;           // the desired probability of correct selection
+  double delta;         // the indifference zone (<= 0 picks 5% of the best)
+  int n0;               // the first-stage replications per policy
+  int maxReps;          // the most replications spent on a single policy
+  SimOptions opts;      // the options for every replication
+};
+
+// The outcome of a ranking-and-selection experiment
+struct SelectionResult {
+  lba_alg best;                  // the selected policy
+  double delta;                  // the indifference zone that was used
+  std::vector<int> reps;         // the replications run for each policy
+  std::vector<double> means;     // the sample mean of each policy
+  std::vector<int> eliminated;   // the stage each policy was dropped at
+  int totalReps;                 // the replications run over all policies
+};
+
+/**
+ * @brief Select the best load-balancing algorithm with the KN procedure
+ *
+ * Runs the fully sequential procedure of Kim & Nelson (2001) over all
+ * registered algorithms. After n0 replications of every algorithm, one more
+ * replication is taken only from the algorithms that are still contenders,
+ * until a single one is left. Replication r of every algorithm uses the same
+ * rngs stream (common random numbers), which the procedure allows for.
+ *
+ * @param cfg The settings of the experiment
+ * @return SelectionResult The selected algorithm and the effort spent
+ */
+SelectionResult selectBest(const SelectionConfig& cfg);
+
+/**
+ * @brief Print the outcome of a ranking-and-selection experiment
+ *
+ * @param cfg The settings of the experiment
+ * @param result The outcome of the experiment
+ */
+void printSelection(const SelectionConfig& cfg, const SelectionResult& result);
+
+#endif
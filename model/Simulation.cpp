@@ -0,0 +1,795 @@
+#include "Simulation.h"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <queue>
+
+#include "Branch.h"
+#include "Checkpoint.h"
+#include "LoadBalancing.h"
+#include "PerfCounters.h"
+#include "Pipeline.h"
+#include "Profile.h"
+#include "ResultCache.h"
+#include "ResultWriter.h"
+#include "rngs.h"
+#include "rvgs.h"
+
+const std::vector<std::string> LBA_NAMES = {"roundrobin", "random", "utilbased",
+                                            "leastcxns"};
+
+// the previous arrival time
+static double prevArr{START};
+// the arrival rate relative to the default
+static double arrivalRate{1.0};
+
+lba_alg name_to_index(std::string name) {
+  for (size_t ii = 0; ii < LBA_NAMES.size(); ii++) {
+    if (name == LBA_NAMES[ii]) return ii;
+  }
+  return -1;
+}
+
+// get a service time for a job
+double getArrival() {
+  PROF_SCOPE("getArrival");
+  double st{Uniform(0, HOUR_SEC / arrivalRate)};  // choose an arrival time
+  prevArr += st;                    // update the the
+
+  return prevArr;
+}
+
+void resetArrival() {
+  prevArr = START;
+  arrivalRate = 1.0;
+}
+
+void setArrivalRate(double rate) { arrivalRate = rate; }
+
+EngineState saveEngineState() {
+  EngineState state;
+  GetSeed(&state.rngSeed);
+  state.arrival = prevArr;
+  return state;
+}
+
+void restoreEngineState(const EngineState& state) {
+  PutSeed(state.rngSeed);
+  prevArr = state.arrival;
+}
+
+// The arrival process of the runs: uniform interarrival times, on the
+// process-wide arrival clock (the service times are drawn by Job)
+struct UniformArrivals {
+  double next() { return getArrival(); }
+};
+
+node_list buildNodeList(int nNodes, size_t qSz) {
+  node_list tempList;
+
+  for (int id = 0; id < nNodes; id++) {
+    tempList.push_back(ServiceNode(id, qSz));
+  }
+
+  return tempList;
+}
+
+void resetNodeList(node_list& nodes, int nNodes, size_t qSz) {
+  if ((int)nodes.size() > nNodes) {
+    nodes.erase(nodes.begin() + nNodes, nodes.end());
+  }
+
+  for (size_t id = 0; id < nodes.size(); id++) {
+    nodes[id].reset(id, qSz);
+  }
+  for (int id = nodes.size(); id < nNodes; id++) {
+    nodes.push_back(ServiceNode(id, qSz));
+  }
+}
+
+lba_func makePolicy(lba_alg lba) {
+  lba::AnyPolicy policy{lba};
+  return [policy](const node_list& nodes, double currT) mutable {
+    return policy.pick(nodes, currT);
+  };
+}
+
+// dispatcher will choose a node's index to send a job to. However, this will
+// not ignore nodes with a full queue. (I.e., if a job is sent to a full node,
+// that job won't be able to run unless the dispatcher picks a node with space.)
+int dispatcher(const node_list& nodes, const lba_func& alg, double currT) {
+  PROF_SCOPE("dispatcher");
+  int nodeIdx{-1};              // -1 as no node will have this index
+  nodeIdx = alg(nodes, currT);  // pick a node using the LBA
+
+  return nodeIdx;
+}
+
+stats_list collectStats(const node_list& nodes) {
+  stats_list stats;
+  stats.reserve(nodes.size());
+
+  for (const ServiceNode& node : nodes) {
+    stats.push_back(node.getStats());
+  }
+
+  return stats;
+}
+
+std::shared_ptr<Sampler> startSampler(const SimOptions& opts, int nNodes,
+                                      long long nJobs) {
+  if (opts.sampleDt <= 0.0) return nullptr;
+
+  // arrivals are on average half an hour apart (see getArrival())
+  double span{nJobs * (HOUR_SEC / 2.0)};
+  return std::make_shared<Sampler>(opts.sampleDt, prevArr, span, nNodes,
+                                   opts.sampleMetrics);
+}
+
+std::unique_ptr<EventLog::Buffer> startEvents(const SimOptions& opts,
+                                              Model model) {
+  if (!opts.eventLog) return nullptr;
+  return std::unique_ptr<EventLog::Buffer>(new EventLog::Buffer(
+      *opts.eventLog, static_cast<uint8_t>(model), opts.eventRate));
+}
+
+Telemetry* startTelemetry(const SimOptions& opts, Model model, lba_alg lba,
+                          int nNodes, long long nJobs) {
+  if (!opts.telemetry) return nullptr;
+  std::string label{(model == Model::mqms ? "mqms " : "sqms ") +
+                    LBA_NAMES[lba]};
+  opts.telemetry->beginRun(label, static_cast<int>(model), nNodes, nJobs);
+  return opts.telemetry;
+}
+
+void collectHistograms(const node_list& nodes, SimResult& result) {
+  result.delayHist.clear();
+  result.waitHist.clear();
+  for (const ServiceNode& node : nodes) {
+    result.delayHist.merge(node.getDelayHist());
+    result.waitHist.merge(node.getWaitHist());
+  }
+}
+
+/**
+ * @brief log information and utilization results of a simulation run
+ *
+ *  Call at end of mqmsSimulation and sqmsSimulation
+ *
+ *
+ * @param lba The load-balancing algorithm to use to choose a node
+ * @param nNodes The number of nodes to use in the simulation
+ * @param qSize The number of jobs allowed in each server's queue
+ * @param nJobs The number of jobs to "process" in the simulation
+ * @param stats The statistics of each node to get node utilizations.
+ * @return void Writes/ appends to a csv file to log info and utilization
+ * results
+ */
+void log_sim(std::string alg, int nNodes, int qSize, long long nJobs,
+             const stats_list& stats) {
+  // not sure if this will work, if not can just do if or case/switches to get
+  // name of alg std::string alg{std::to_string(lba)};
+  std::ofstream logfile;
+  logfile.open("simlog.csv", std::ios::app);
+  logfile << alg << "," << nJobs << "," << nNodes << "," << qSize;
+  for (int i = 0; i < nNodes; i++) {
+    logfile << "," << stats[i].util;
+  }
+  logfile << ",\n";
+  logfile.close();
+}
+
+/**
+ * @brief Switch a run over to the settings of its what-if branch
+ *
+ * Called when the run reaches the fork job. The statistics restart at the
+ * fork, so a branch only reports the jobs it ran itself.
+ *
+ * @param branches The branches of the run
+ * @param model The model of the run
+ * @param nodes The nodes of the run
+ * @param policy Switched to the branch's algorithm
+ * @param qSize Set to the branch's queue size
+ * @return true This process runs a branch; false in the parent, once all
+ * branches have finished
+ */
+static bool startBranch(BranchRunner& branches, Model model, node_list& nodes,
+                        lba::AnyPolicy& policy, size_t& qSize) {
+  const BranchSpec* spec{branches.fork()};
+  if (!spec) return false;
+
+  policy.select(spec->lba);
+  qSize = spec->qSize;
+  for (ServiceNode& node : nodes) {
+    if (model == Model::mqms) node.setMaxQueueLen(qSize);
+    node.resetStats(prevArr);
+  }
+  setArrivalRate(spec->rate);
+  return true;
+}
+
+// only lba::AnyPolicy can change its algorithm, so runs with branches are
+// always compiled for it (see runMqms())
+template <typename Policy>
+static bool startBranch(BranchRunner& branches, Model model, node_list& nodes,
+                        Policy& policy, size_t& qSize) {
+  std::cerr << "Branches need a run compiled for lba::AnyPolicy" << std::endl;
+  return false;
+}
+
+// The simulation will generate it's own list of nodes and use the LBA to send
+// nJobs to the nodes in the model. The loop is compiled for each policy and
+// arrival process, so their calls are inlined.
+template <typename Policy, typename Arrivals>
+static SimResult mqmsLoop(Policy& policy, Arrivals& arrivals, int nNodes,
+                          lba_alg lba, size_t qSize, long long nJobs,
+                          const SimOptions& opts, SimWorkspace* ws) {
+  PROF_SCOPE("runMqms");
+  PROF_COUNT("jobs", nJobs);
+  perfEnter(PerfPhase::setup);
+
+  // build node list (reusing the workspace's table if there is one)
+  SimWorkspace local;
+  node_list& nodes{ws ? ws->nodes : local.nodes};
+  resetNodeList(nodes, nNodes, qSize);
+
+  // track the total number of rejections
+  long long totalRejects{0};
+
+  // the warm-up detector observes the delay of every admitted job
+  WarmupDetector warmup;
+  long long resetJob{0};  // the first job counted in the statistics
+
+  std::shared_ptr<Sampler> sampler{startSampler(opts, nNodes, nJobs)};
+  std::unique_ptr<EventLog::Buffer> events{startEvents(opts, Model::mqms)};
+  Telemetry* telemetry{startTelemetry(opts, Model::mqms, lba, nNodes, nJobs)};
+
+  // the jobs before this one are counted in the warm-up phase
+  long long steadyJob{opts.detectWarmup ? nJobs : 0};
+
+  // continue from a checkpoint of this run, if there is one
+  long long ii{0};
+  Checkpointer* checkpoint{opts.checkpoint};
+  CheckpointKey key{Model::mqms, lba, nNodes, qSize, nJobs, opts.detectWarmup};
+  RunState state{ii,    totalRejects, resetJob,       steadyJob,
+                 warmup, nodes,       local.jobQueue, policy};
+  if (checkpoint) checkpoint->resume(key, state);
+  perfEnter(ii < steadyJob ? PerfPhase::warmup : PerfPhase::steady);
+
+  // run for the number of jobs
+  for (; ii < nJobs; ii++) {
+    if (checkpoint && checkpoint->isDue(ii)) checkpoint->save(key, state);
+
+    // fork the what-if branches once the run is warmed up
+    if (opts.branches && ii == opts.branches->getForkJob()) {
+      if (!startBranch(*opts.branches, Model::mqms, nodes, policy, qSize)) {
+        break;
+      }
+      totalRejects = 0;
+      resetJob = steadyJob = ii;
+    }
+
+    // get the next jobs arrival
+    Job job{arrivals.next()};
+
+    // record the state of the nodes once per tick
+    if (sampler && job.getArrival() >= sampler->getNextTick()) {
+      sampler->sample(job.getArrival(), nodes, 0);
+    }
+    if (telemetry && telemetry->isDue(ii)) {
+      telemetry->publish(job.getArrival(), ii, totalRejects, nodes, 0);
+    }
+
+    // determine receiving server based on lba
+    int receiver{policy.pick(nodes, job.getArrival())};
+    // std::cout << "Node " << receiver << " selected for job" << std::endl;
+
+    // the queue length the job finds, for the event log
+    bool isLogged{events && events->isSampled(ii)};
+    long long queued{0};
+    if (isLogged) {
+      nodes[receiver].advanceTo(job.getArrival());
+      queued = nodes[receiver].getQueueLevel();
+    }
+
+    // attempt to enter the job into the node
+    bool isEntered{nodes[receiver].enterNode(job)};
+    if (isEntered) {
+      // node added successfully
+      // std::cout << "Job successfully added" << std::endl;
+      if (opts.detectWarmup && warmup.observe(job.getDelay(), ii) &&
+          warmup.getTruncationObs() > 0) {
+        // drop everything seen so far from the statistics: the jobs
+        // between the truncation point and this one go too, as the node
+        // statistics can't be taken back to the point
+        for (ServiceNode& node : nodes) node.resetStats(job.getArrival());
+        totalRejects = 0;
+        resetJob = steadyJob = ii + 1;
+        perfEnter(PerfPhase::steady);
+      }
+    } else {
+      // node unable to be added, this is where different rejection
+      // techiniques could be used
+      // std::cout << "Job unsuccessfully added" << std::endl;
+
+      ++totalRejects;
+    }
+
+    if (isLogged) {
+      events->add(JobEvent{ii, job.getArrival(), receiver, queued,
+                           job.getDelay(),
+                           isEntered ? job.calcDeparture() : job.getArrival(),
+                           !isEntered});
+    }
+  }
+
+  if (telemetry) {
+    telemetry->publish(prevArr, nJobs, totalRejects, nodes, 0, true);
+  }
+
+  perfAddJobs(PerfPhase::warmup, steadyJob);
+  perfAddJobs(PerfPhase::steady, nJobs - steadyJob);
+  perfEnter(PerfPhase::output);
+
+  SimResult result{Model::mqms, collectStats(nodes), totalRejects,
+                   nJobs - resetJob, resetJob, warmup.getReport()};
+  collectHistograms(nodes, result);
+  result.samples = sampler;
+  return result;
+}
+
+SimResult runModel(Model model, int nNodes, lba_alg lba, size_t qSize,
+                   long long nJobs, const SimOptions& opts,
+                   SimWorkspace* ws) {
+  // run the simulation itself, without the cache
+  auto simulate = [&]() {
+    if (opts.pipelined) {
+      return runPipelined(model, nNodes, lba, qSize, nJobs, opts, ws);
+    }
+    return model == Model::mqms ? runMqms(nNodes, lba, qSize, nJobs, opts, ws)
+                                : runSqms(nNodes, lba, qSize, nJobs, opts, ws);
+  };
+
+  // the samples and events are not cached, so those runs always simulate
+  if (opts.cacheDir.empty() || opts.sampleDt > 0.0 || opts.eventLog) {
+    return simulate();
+  }
+
+  ResultCache cache{opts.cacheDir};
+  CacheKey key{model,          LBA_NAMES[lba],    nNodes,
+               qSize,          nJobs,             opts.detectWarmup,
+               opts.pipelined, saveEngineState()};
+
+  SimResult result;
+  EngineState end;
+  if (cache.load(key, result, end)) {
+    // continue as if the run had just been simulated
+    restoreEngineState(end);
+    return result;
+  }
+
+  result = simulate();
+  if (!cache.store(key, result, saveEngineState())) {
+    std::cerr << "Could not write to the result cache in " << opts.cacheDir
+              << std::endl;
+  }
+
+  return result;
+}
+
+void mqmsSimulation(int nNodes, lba_alg lba, size_t qSize, long long nJobs,
+                    const SimOptions& opts) {
+  PROF_SCOPE("mqmsSimulation");
+  std::string funcName{LBA_NAMES[lba]};
+  SimResult result{runModel(Model::mqms, nNodes, lba, qSize, nJobs, opts)};
+  perfEnter(PerfPhase::output);  // also when the run came from the cache
+
+  // get simulation results
+  if (opts.detectWarmup) printWarmup(result.warmup, result.resetJob);
+  printStats(result.stats, result.totalRejects, result.nJobs);
+
+  // write the results as .npz archives with --npz, as CSV files otherwise
+  if (opts.npz) {
+    accumNpz(result, funcName, opts.sampleRollup);
+  } else {
+    accumStats(result.stats, nJobs, Model::mqms, funcName);
+    accumPercentiles(result, funcName);
+    if (result.samples) accumSamples(result, funcName, opts.sampleRollup);
+  }
+  log_sim(funcName, nNodes, qSize, nJobs, result.stats);
+  perfLeave();
+}
+
+// The simulation will generate it's own list of nodes and use the LBA to send
+// nJobs to the nodes in the model. The loop is compiled for each policy and
+// arrival process, so their calls are inlined.
+template <typename Policy, typename Arrivals>
+static SimResult sqmsLoop(Policy& policy, Arrivals& arrivals, int nNodes,
+                          lba_alg lba, size_t qSize, long long nJobs,
+                          const SimOptions& opts, SimWorkspace* ws) {
+  PROF_SCOPE("runSqms");
+  PROF_COUNT("jobs", nJobs);
+  perfEnter(PerfPhase::setup);
+
+  // build node list (reusing the workspace's table if there is one)
+  SimWorkspace local;
+  node_list& nodes{ws ? ws->nodes : local.nodes};
+  resetNodeList(nodes, nNodes, 0);
+
+  // the total number of rejections
+  long long totalRejects{0};
+
+  // the dispatcher's queue
+  std::queue<Job>& jobQueue{ws ? ws->jobQueue : local.jobQueue};
+  while (!jobQueue.empty()) jobQueue.pop();
+
+  // the servers have no queue, so the warm-up detector observes the length of
+  // the dispatcher's queue instead
+  WarmupDetector warmup;
+  long long resetJob{0};  // the first job counted in the statistics
+
+  std::shared_ptr<Sampler> sampler{startSampler(opts, nNodes, nJobs)};
+  std::unique_ptr<EventLog::Buffer> events{startEvents(opts, Model::sqms)};
+  Telemetry* telemetry{startTelemetry(opts, Model::sqms, lba, nNodes, nJobs)};
+
+  // the jobs before this one are counted in the warm-up phase
+  long long steadyJob{opts.detectWarmup ? nJobs : 0};
+
+  // continue from a checkpoint of this run, if there is one
+  long long ii{0};
+  Checkpointer* checkpoint{opts.checkpoint};
+  CheckpointKey key{Model::sqms, lba, nNodes, qSize, nJobs, opts.detectWarmup};
+  RunState state{ii,     totalRejects, resetJob, steadyJob,
+                 warmup, nodes,        jobQueue, policy};
+  if (checkpoint) checkpoint->resume(key, state);
+  perfEnter(ii < steadyJob ? PerfPhase::warmup : PerfPhase::steady);
+
+  // run for the number of jobs
+  for (; ii < nJobs; ii++) {
+    if (checkpoint && checkpoint->isDue(ii)) checkpoint->save(key, state);
+
+    // fork the what-if branches once the run is warmed up
+    if (opts.branches && ii == opts.branches->getForkJob()) {
+      if (!startBranch(*opts.branches, Model::sqms, nodes, policy, qSize)) {
+        break;
+      }
+      totalRejects = 0;
+      resetJob = steadyJob = ii;
+    }
+
+    Job job{arrivals.next()};  // get a job's arrival time
+
+    // record the state of the nodes once per tick
+    if (sampler && job.getArrival() >= sampler->getNextTick()) {
+      sampler->sample(job.getArrival(), nodes, jobQueue.size());
+    }
+    if (telemetry && telemetry->isDue(ii)) {
+      telemetry->publish(job.getArrival(), ii, totalRejects, nodes,
+                         jobQueue.size());
+    }
+
+    // check to make sure the job can be queued
+    bool isQueued{jobQueue.size() < qSize};
+    if (isQueued) {
+      jobQueue.push(job);  // the job is able to enter the queue.
+    } else {
+      ++totalRejects;
+    }
+
+    // pick the service node to send the current job to
+    int receiver{policy.pick(nodes, job.getArrival())};
+
+    // send the job to the selected node
+    bool isEntered{nodes[receiver].enterNode(job)};
+    if (isEntered) {
+      jobQueue.pop();  // remove the job from the queue as it can be serviced
+    }
+
+    if (events && events->isSampled(ii)) {
+      events->add(JobEvent{ii, job.getArrival(), receiver,
+                           static_cast<long long>(jobQueue.size()),
+                           job.getDelay(),
+                           isEntered ? job.calcDeparture() : job.getArrival(),
+                           !isQueued});
+    }
+
+    if (opts.detectWarmup && warmup.observe(jobQueue.size(), ii) &&
+        warmup.getTruncationObs() > 0) {
+      // drop everything seen so far, as in runMqms()
+      for (ServiceNode& node : nodes) node.resetStats(job.getArrival());
+      totalRejects = 0;
+      resetJob = steadyJob = ii + 1;
+      perfEnter(PerfPhase::steady);
+    }
+  }
+
+  if (telemetry) {
+    telemetry->publish(prevArr, nJobs, totalRejects, nodes, jobQueue.size(),
+                       true);
+  }
+
+  perfAddJobs(PerfPhase::warmup, steadyJob);
+  perfAddJobs(PerfPhase::steady, nJobs - steadyJob);
+  perfEnter(PerfPhase::output);
+
+  SimResult result{Model::sqms, collectStats(nodes), totalRejects,
+                   nJobs - resetJob, resetJob, warmup.getReport()};
+  collectHistograms(nodes, result);
+  result.samples = sampler;
+  return result;
+}
+
+// the loops of both models with a fresh Policy and the default arrivals
+template <typename Policy>
+static SimResult runMqmsWith(int nNodes, lba_alg lba, size_t qSize,
+                             long long nJobs, const SimOptions& opts,
+                             SimWorkspace* ws) {
+  Policy policy;
+  UniformArrivals arrivals;
+  return mqmsLoop(policy, arrivals, nNodes, lba, qSize, nJobs, opts, ws);
+}
+
+template <typename Policy>
+static SimResult runSqmsWith(int nNodes, lba_alg lba, size_t qSize,
+                             long long nJobs, const SimOptions& opts,
+                             SimWorkspace* ws) {
+  Policy policy;
+  UniformArrivals arrivals;
+  return sqmsLoop(policy, arrivals, nNodes, lba, qSize, nJobs, opts, ws);
+}
+
+template <template <int> class Policy, int NODES>
+static RunLoops loopsFor() {
+  return RunLoops{NODES, runMqmsWith<Policy<NODES>>,
+                  runSqmsWith<Policy<NODES>>};
+}
+
+// the loops of a policy: for the small clusters whose node count is compiled
+// in, then for any count
+template <template <int> class Policy>
+static std::vector<RunLoops> allLoopsFor() {
+  return {loopsFor<Policy, 2>(), loopsFor<Policy, 4>(),
+          loopsFor<Policy, 8>(), loopsFor<Policy, 16>(),
+          loopsFor<Policy, 0>()};
+}
+
+const RunLoops* findRunLoops(const std::string& name, int nNodes) {
+  static const std::map<std::string, std::vector<RunLoops>> registry{
+      {LBA_NAMES[0], allLoopsFor<lba::RoundRobin>()},
+      {LBA_NAMES[1], allLoopsFor<lba::Random>()},
+      {LBA_NAMES[2], allLoopsFor<lba::UtilizationBased>()},
+      {LBA_NAMES[3], allLoopsFor<lba::LeastConnections>()}};
+
+  auto found = registry.find(name);
+  if (found == registry.end()) return nullptr;
+  for (const RunLoops& loops : found->second) {
+    if (loops.nNodes == nNodes || loops.nNodes == 0) return &loops;
+  }
+  return nullptr;
+}
+
+SimResult runMqms(int nNodes, lba_alg lba, size_t qSize, long long nJobs,
+                  const SimOptions& opts, SimWorkspace* ws) {
+  // the branches may switch to another algorithm
+  if (opts.branches) {
+    lba::AnyPolicy policy{lba};
+    UniformArrivals arrivals;
+    return mqmsLoop(policy, arrivals, nNodes, lba, qSize, nJobs, opts, ws);
+  }
+  return findRunLoops(LBA_NAMES[lba], nNodes)
+      ->mqms(nNodes, lba, qSize, nJobs, opts, ws);
+}
+
+SimResult runSqms(int nNodes, lba_alg lba, size_t qSize, long long nJobs,
+                  const SimOptions& opts, SimWorkspace* ws) {
+  if (opts.branches) {
+    lba::AnyPolicy policy{lba};
+    UniformArrivals arrivals;
+    return sqmsLoop(policy, arrivals, nNodes, lba, qSize, nJobs, opts, ws);
+  }
+  return findRunLoops(LBA_NAMES[lba], nNodes)
+      ->sqms(nNodes, lba, qSize, nJobs, opts, ws);
+}
+
+void sqmsSimulation(int nNodes, lba_alg lba, size_t qSize, long long nJobs,
+                    const SimOptions& opts) {
+  PROF_SCOPE("sqmsSimulation");
+  std::string funcName{LBA_NAMES[lba]};
+  SimResult result{runModel(Model::sqms, nNodes, lba, qSize, nJobs, opts)};
+  perfEnter(PerfPhase::output);  // also when the run came from the cache
+
+  // get simulation results
+  if (opts.detectWarmup) printWarmup(result.warmup, result.resetJob);
+  printStats(result.stats, result.totalRejects, result.nJobs);
+
+  if (opts.npz) {
+    accumNpz(result, funcName, opts.sampleRollup);
+  } else {
+    accumStats(result.stats, nJobs, Model::sqms, funcName);
+    accumPercentiles(result, funcName);
+    if (result.samples) accumSamples(result, funcName, opts.sampleRollup);
+  }
+  log_sim(funcName, nNodes, 0, nJobs, result.stats);
+  perfLeave();
+}
+
+double calcMeanDelay(const SimResult& result) {
+  RunningStat delay;
+  for (const NodeStats& node : result.stats) {
+    delay.merge(RunningStat{node.nJobs, node.avgD, node.sdD * node.sdD});
+  }
+  return delay.getMean();
+}
+
+double calcRejectRatio(const SimResult& result) {
+  return (static_cast<double>(result.totalRejects) / result.nJobs) * 100;
+}
+
+// report where the warm-up of a simulation was truncated
+void printWarmup(const WarmupReport& warmup, long long resetJob) {
+  if (warmup.detected && warmup.truncObs == 0) {
+    std::cout << "Warm-up (MSER-5): no transient detected, statistics cover "
+              << "the whole run" << std::endl;
+  } else if (warmup.detected) {
+    std::cout << "Warm-up (MSER-5): truncation point at job "
+              << warmup.truncJob << " (" << warmup.truncObs
+              << " observations), statistics reset at its detection, at "
+              << "job " << resetJob << " (the " << resetJob - warmup.truncJob
+              << " jobs in between are dropped too)" << std::endl;
+  } else {
+    std::cout << "Warm-up (MSER-5): no truncation point detected in "
+              << warmup.numObs << " observations" << std::endl;
+  }
+}
+
+void printStats(const stats_list& stats, long long totalRejects,
+                long long nJobs) {
+  // calculate the fraction of rejected jobs
+  double rejectRatio{(static_cast<double>(totalRejects) / nJobs) * 100};
+
+  // print the reject amount
+  std::cout << std::setprecision(5) 
+            << "Rejection amount: " << rejectRatio  << "%" << std::endl;
+  
+  // print the node-wise data
+  for (const NodeStats& node : stats) {
+    std::cout << node << std::endl;
+  }
+
+}
+
+void accumStats(const stats_list& stats, long long nJobs, Model modelName,
+                std::string funcName) {
+  PROF_SCOPE("accumStats");
+  std::string model = (modelName == Model::mqms) ? "mqms" : "sqms";
+  std::ofstream data(model + "_" + funcName + ".csv");
+
+  // write the headers
+  data << "sid,avg_x,avg_s,avg_q,avg_d,n_jobs,sd_s,avg_w,sd_w,sd_d,"
+       << "p50_d,p99_d,p999_d,p50_w,p99_w,p999_w" << std::endl;
+
+  // will need to get n_jobs
+  int nodeId{0};
+  for (const NodeStats& node : stats) {
+    data << nodeId++ << ","             // sid
+         << node.util << ","            // avg_x
+         << node.avgSt << ","           // avg_s
+         << node.avgQ << ","            // avg_q
+         << node.avgD << ","            // avg_d
+         << node.nJobs << ","           // n_jobs
+         << node.sdSt << ","            // sd_s
+         << node.avgW << ","            // avg_w
+         << node.sdW << ","             // sd_w
+         << node.sdD << ","             // sd_d
+         << node.pD50 << ","            // p50_d
+         << node.pD99 << ","            // p99_d
+         << node.pD999 << ","           // p999_d
+         << node.pW50 << ","            // p50_w
+         << node.pW99 << ","            // p99_w
+         << node.pW999 << std::endl;    // p999_w
+  }
+
+  data.close();
+}
+
+// write the run-wide percentiles of the delay and wait
+void accumPercentiles(const SimResult& result, std::string funcName) {
+  PROF_SCOPE("accumPercentiles");
+  std::string model = (result.model == Model::mqms) ? "mqms" : "sqms";
+  std::ofstream data(model + "_" + funcName + "_pct.csv");
+
+  data << "metric,n_jobs,p50,p90,p99,p999" << std::endl;
+
+  const Histogram* hists[]{&result.delayHist, &result.waitHist};
+  const char* names[]{"delay", "wait"};
+  for (int ii = 0; ii < 2; ii++) {
+    data << names[ii] << "," << hists[ii]->getCount() << ","
+         << hists[ii]->getPercentile(50.0) << ","
+         << hists[ii]->getPercentile(90.0) << ","
+         << hists[ii]->getPercentile(99.0) << ","
+         << hists[ii]->getPercentile(99.9) << std::endl;
+  }
+
+  data.close();
+}
+
+// write the state samples of a run
+void accumSamples(const SimResult& result, std::string funcName,
+                  size_t rollup) {
+  PROF_SCOPE("accumSamples");
+  std::string model = (result.model == Model::mqms) ? "mqms" : "sqms";
+  std::ofstream data(model + "_" + funcName + "_series.csv");
+  result.samples->write(data, rollup);
+  data.close();
+
+  if (result.samples->getNumDropped() > 0) {
+    std::cerr << "The " << model << " samples were too many to keep, the "
+              << result.samples->getNumDropped() << " oldest were dropped"
+              << std::endl;
+  }
+}
+
+// hand the results of a run to the background writer as .npz archives, with
+// the same columns as the CSV files
+void accumNpz(const SimResult& result, std::string funcName, size_t rollup) {
+  PROF_SCOPE("accumNpz");
+  std::string prefix{(result.model == Model::mqms ? "mqms_" : "sqms_") +
+                     funcName};
+  ResultWriter& writer{resultWriter()};
+
+  ColumnTable& nodes{writer.buffer()};
+  nodes.path = prefix + ".npz";
+  const char* names[]{"sid",   "avg_x", "avg_s",  "avg_q", "avg_d", "n_jobs",
+                      "sd_s",  "avg_w", "sd_w",   "sd_d",  "p50_d", "p99_d",
+                      "p999_d", "p50_w", "p99_w", "p999_w"};
+  std::vector<std::vector<double>*> cols;
+  for (const char* name : names) cols.push_back(&nodes.addColumn(name));
+  for (const NodeStats& node : result.stats) {
+    double row[]{static_cast<double>(node.id),
+                 node.util,
+                 node.avgSt,
+                 node.avgQ,
+                 node.avgD,
+                 static_cast<double>(node.nJobs),
+                 node.sdSt,
+                 node.avgW,
+                 node.sdW,
+                 node.sdD,
+                 node.pD50,
+                 node.pD99,
+                 node.pD999,
+                 node.pW50,
+                 node.pW99,
+                 node.pW999};
+    for (size_t col = 0; col < cols.size(); col++) {
+      cols[col]->push_back(row[col]);
+    }
+  }
+  writer.submit();
+
+  // one row for the delay, one for the wait
+  ColumnTable& pct{writer.buffer()};
+  pct.path = prefix + "_pct.npz";
+  std::vector<double>& count{pct.addColumn("n_jobs")};
+  std::vector<double>& p50{pct.addColumn("p50")};
+  std::vector<double>& p90{pct.addColumn("p90")};
+  std::vector<double>& p99{pct.addColumn("p99")};
+  std::vector<double>& p999{pct.addColumn("p999")};
+  for (const Histogram* hist : {&result.delayHist, &result.waitHist}) {
+    count.push_back(hist->getCount());
+    p50.push_back(hist->getPercentile(50.0));
+    p90.push_back(hist->getPercentile(90.0));
+    p99.push_back(hist->getPercentile(99.0));
+    p999.push_back(hist->getPercentile(99.9));
+  }
+  writer.submit();
+
+  if (result.samples) {
+    ColumnTable& series{writer.buffer()};
+    series.path = prefix + "_series.npz";
+    result.samples->toTable(series, rollup);
+    writer.submit();
+  }
+}
@@ -0,0 +1,355 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "Job.h"
+#include "EventLog.h"
+#include "Node.h"
+#include "Sampler.h"
+#include "Telemetry.h"
+#include "Warmup.h"
+
+// Type definition aliases
+typedef int node_idx;
+typedef std::function<node_idx(const std::vector<ServiceNode>&, double)>
+    lba_func;
+typedef std::vector<ServiceNode> node_list;
+typedef std::vector<NodeStats> stats_list;
+typedef int lba_alg;
+
+// GLOBAL VARIABLES
+const int DAY_SEC{24 * 60 * 60};   // seconds in a day
+const int NOON_TIME{DAY_SEC / 2};  // time of day for noon
+const int HOUR_SEC{DAY_SEC / 24};
+const double START{0.0};                 // start time for the simulation
+const double END{(double)DAY_SEC * 30};  // end time for the simulation
+enum class Model { mqms, sqms };         // model enums
+
+// the version of the simulation results, bump it whenever a change makes the
+// same inputs give different results (it invalidates the result cache)
+const char* const SIM_VERSION{"4"};
+
+// the names of the load-balancing algorithms, indexed by lba_alg
+extern const std::vector<std::string> LBA_NAMES;
+// =========================== END GLOBAL VARIABLES ============================
+
+class BranchRunner;
+class Checkpointer;
+
+// Options that change how a simulation is run
+struct SimOptions {
+  bool detectWarmup{false};  // reset the statistics once the warm-up is found
+  std::string cacheDir;      // the result cache directory (empty: no cache)
+  bool pipelined{false};     // run generation/dispatch/statistics in parallel
+  double sampleDt{0.0};      // the time between state samples (0: none)
+  std::vector<SampleMetric> sampleMetrics{SampleMetric::queue,
+                                          SampleMetric::busy};
+  size_t sampleRollup{1};    // the samples reduced to one row of output
+  bool npz{false};           // write the results as .npz instead of CSV
+  EventLog* eventLog{nullptr};    // where job events are logged (if anywhere)
+  double eventRate{1.0};          // the fraction of jobs logged
+  Telemetry* telemetry{nullptr};  // where progress is published (if anywhere)
+  Checkpointer* checkpoint{nullptr};  // saves and resumes runs (if anything)
+  BranchRunner* branches{nullptr};    // forks what-if branches (if any)
+};
+
+// The process-wide state a simulation continues from and leaves behind
+struct EngineState {
+  long rngSeed;    // the state of the current rngs stream
+  double arrival;  // the arrival clock
+};
+
+// Buffers that are reused from one run to the next
+struct SimWorkspace {
+  node_list nodes;           // the node table
+  std::queue<Job> jobQueue;  // the dispatcher's queue (sqms)
+};
+
+// The outcome of a single simulation run
+struct SimResult {
+  Model model;             // the model that was simulated
+  stats_list stats;        // the statistics of each node
+  long long totalRejects;  // the rejections counted in the statistics
+  long long nJobs;         // the jobs counted in the statistics
+  long long resetJob;      // the first job counted in the statistics: with
+                           // --warmup, the one after the truncation point
+                           // was detected, not the point itself
+  WarmupReport warmup;     // where the warm-up was truncated
+  Histogram delayHist;     // the delays over all nodes
+  Histogram waitHist;      // the waits over all nodes
+  std::shared_ptr<const Sampler> samples;  // the state samples (if any)
+};
+
+/**
+ * @brief Find a load-balancing algorithm by its name
+ *
+ * @param name One of LBA_NAMES
+ * @return lba_alg The algorithm's index, or -1 if there's no such algorithm
+ */
+lba_alg name_to_index(std::string name);
+
+/**
+ * @brief Get the next job's arrival time
+ *
+ * @return double The arrival time in seconds
+ */
+double getArrival();
+
+/**
+ * @brief Restart the arrival process at START, at the default rate
+ *
+ * Used to make simulations independent of the ones run before them.
+ */
+void resetArrival();
+
+/**
+ * @brief Scale the rate of the arrivals from now on
+ *
+ * @param rate The arrival rate relative to the default (2: twice as many
+ * jobs per hour)
+ */
+void setArrivalRate(double rate);
+
+/**
+ * @brief Capture the state the next simulation will start from
+ *
+ * @return EngineState The RNG and arrival state
+ */
+EngineState saveEngineState();
+
+/**
+ * @brief Continue from a previously captured state
+ *
+ * @param state A state returned by saveEngineState()
+ */
+void restoreEngineState(const EngineState& state);
+
+/**
+ * @brief Build a list of service nodes
+ *
+ * @param nNodes The number of nodes to include in the model
+ * @param qSz The queue size of the nodes
+ * @return std::vector<ServiceNode>
+ */
+node_list buildNodeList(int nNodes, size_t qSz);
+
+/**
+ * @brief Turn an existing list into a fresh list of service nodes
+ *
+ * The nodes already in the list are reset in place, so their memory is
+ * reused; nodes are only added or removed when the count changes.
+ *
+ * @param nodes The list to rebuild
+ * @param nNodes The number of nodes to include in the model
+ * @param qSz The queue size of the nodes
+ */
+void resetNodeList(node_list& nodes, int nNodes, size_t qSz);
+
+/**
+ * @brief Create a load-balancing algorithm behind a std::function
+ *
+ * For code that picks the algorithm at run time. Each call creates a policy
+ * with its own state (see LoadBalancing.h).
+ *
+ * @param lba The algorithm
+ * @return lba_func The policy
+ */
+lba_func makePolicy(lba_alg lba);
+
+/**
+ * @brief Pick a service node for the next job to go to
+ *
+ * @param nodes A list of usable service nodes (that may have full queues)
+ * @param alg The load-balancing algorithm to use to choose a node
+ * @param currT The current arrival time
+ * @return int The index of the node to send a job to
+ */
+node_idx dispatcher(const node_list& nodes, const lba_func& alg,
+                    double currT);
+
+/**
+ * @brief Take a snapshot of the statistics of every node
+ *
+ * @param nodes The nodes of the simulation
+ * @return stats_list The statistics of each node, in the order of the nodes
+ */
+stats_list collectStats(const node_list& nodes);
+
+/**
+ * @brief Create the event log buffer of a run, if the options ask for one
+ *
+ * @param opts The simulation options
+ * @param model The model of the run (identifies its events in the log)
+ * @return std::unique_ptr<EventLog::Buffer> The buffer, or nullptr
+ */
+std::unique_ptr<EventLog::Buffer> startEvents(const SimOptions& opts,
+                                              Model model);
+
+/**
+ * @brief Announce a run to the telemetry segment, if the options have one
+ *
+ * @param opts The simulation options
+ * @param model The model of the run
+ * @param lba The algorithm of the run
+ * @param nNodes The number of nodes of the run
+ * @param nJobs The number of jobs of the run
+ * @return Telemetry* Where to publish the run's progress, or nullptr
+ */
+Telemetry* startTelemetry(const SimOptions& opts, Model model, lba_alg lba,
+                          int nNodes, long long nJobs);
+
+/**
+ * @brief Merge the delay and wait histograms of every node into a result
+ *
+ * @param nodes The nodes of the simulation
+ * @param result The result to add the run-wide histograms to
+ */
+void collectHistograms(const node_list& nodes, SimResult& result);
+
+/**
+ * @brief Create the sampler for a run, if the options ask for one
+ *
+ * The columns are sized for the expected length of the run, starting from
+ * the current arrival time.
+ *
+ * @param opts The simulation options
+ * @param nNodes The number of nodes
+ * @param nJobs The number of jobs in the run
+ * @return std::shared_ptr<Sampler> The sampler, or nullptr
+ */
+std::shared_ptr<Sampler> startSampler(const SimOptions& opts, int nNodes,
+                                      long long nJobs);
+
+/**
+ * @brief Run a multi-queue, multi-server simulation without any output
+ *
+ * @param nNodes The number of nodes to use in the simulation
+ * @param lba The node balancing
+ * @param qSize The number of jobs allowed in each server's queue
+ * @param nJobs The number of jobs to "process" in the simulation
+ * @param opts The simulation options
+ * @param ws The buffers to reuse (nullptr to use fresh ones)
+ * @return SimResult The statistics of the run
+ */
+SimResult runMqms(int nNodes, lba_alg lba, size_t qSize, long long nJobs,
+                  const SimOptions& opts, SimWorkspace* ws = nullptr);
+
+/**
+ * @brief Run a single-queue, multi-server simulation without any output
+ *
+ * @param nNodes The number of nodes to use in the simulation
+ * @param lba The node balancing
+ * @param qSize The size of the dispatcher's queue
+ * @param nJobs The number of jobs to "process" in the simulation
+ * @param opts The simulation options
+ * @param ws The buffers to reuse (nullptr to use fresh ones)
+ * @return SimResult The statistics of the run
+ */
+SimResult runSqms(int nNodes, lba_alg lba, size_t qSize, long long nJobs,
+                  const SimOptions& opts, SimWorkspace* ws = nullptr);
+
+// A run loop compiled for one load-balancing policy (see findRunLoops())
+typedef SimResult (*run_loop)(int nNodes, lba_alg lba, size_t qSize,
+                              long long nJobs, const SimOptions& opts,
+                              SimWorkspace* ws);
+
+// The loops of both models compiled for one policy and node count
+struct RunLoops {
+  int nNodes;     // the node count they are compiled for (0: any count)
+  run_loop mqms;  // runs the multi-queue, multi-server model
+  run_loop sqms;  // runs the single-queue, multi-server model
+};
+
+/**
+ * @brief Find the run loops compiled for an algorithm
+ *
+ * Every algorithm has loops for any number of nodes, and loops for a few
+ * small clusters, whose node count is a compile-time constant. runMqms() and
+ * runSqms() go through here.
+ *
+ * @param name One of LBA_NAMES
+ * @param nNodes The number of nodes of the run
+ * @return const RunLoops* The loops compiled for nNodes if there are some,
+ * else the loops for any count; nullptr if there's no such algorithm
+ */
+const RunLoops* findRunLoops(const std::string& name, int nNodes);
+
+/**
+ * @brief Run a simulation of either model, going through the result cache
+ *
+ * With opts.pipelined the run is split into stages (see runPipelined()).
+ * When opts.cacheDir is set and the same run was done before, the stored
+ * statistics are returned and the engine state is moved to where the run
+ * would have left it. Otherwise the run is simulated and stored.
+ *
+ * @param model The model to simulate
+ * @param nNodes The number of nodes to use in the simulation
+ * @param lba The node balancing
+ * @param qSize The queue size
+ * @param nJobs The number of jobs to "process" in the simulation
+ * @param opts The simulation options
+ * @param ws The buffers to reuse (nullptr to use fresh ones)
+ * @return SimResult The statistics of the run
+ */
+SimResult runModel(Model model, int nNodes, lba_alg lba, size_t qSize,
+                   long long nJobs, const SimOptions& opts,
+                   SimWorkspace* ws = nullptr);
+
+/**
+ * @brief Run a multi-queue, multi-server simulation and report the results
+ *
+ * @param nNodes The number of nodes to use in the simulation
+ * @param lba The node balancing
+ * @param qSize The number of jobs allowed in each server's queue
+ * @param nJobs The number of jobs to "process" in the simulation
+ * @param opts The simulation options
+ */
+void mqmsSimulation(int nNodes, lba_alg lba, size_t qSize, long long nJobs,
+                    const SimOptions& opts = SimOptions());
+
+/**
+ * @brief Run a single-queue, multi-server simulation and report the results
+ *
+ * @param nNodes The number of nodes to use in the simulation
+ * @param lba The node balancing
+ * @param qSize The size of the dispatcher's queue
+ * @param nJobs The number of jobs to "process" in the simulation
+ * @param opts The simulation options
+ */
+void sqmsSimulation(int nNodes, lba_alg lba, size_t qSize, long long nJobs,
+                    const SimOptions& opts = SimOptions());
+
+/**
+ * @brief Calculate the average delay over all jobs of a run
+ *
+ * @param result The result of the run
+ * @return double The average delay weighted by each node's number of jobs
+ */
+double calcMeanDelay(const SimResult& result);
+
+/**
+ * @brief Calculate the percentage of rejected jobs of a run
+ *
+ * @param result The result of the run
+ * @return double The rejection ratio in percent
+ */
+double calcRejectRatio(const SimResult& result);
+
+void accumStats(const stats_list& stats, long long nJobs, Model modelName,
+                std::string funcName);
+void accumPercentiles(const SimResult& result, std::string funcName);
+void accumSamples(const SimResult& result, std::string funcName,
+                  size_t rollup);
+void accumNpz(const SimResult& result, std::string funcName, size_t rollup);
+void log_sim(std::string alg, int nNodes, int qSize, long long nJobs,
+             const stats_list& stats);
+void printStats(const stats_list& stats, long long totalRejects,
+                long long nJobs);
+void printWarmup(const WarmupReport& warmup, long long resetJob);
+
+#endif
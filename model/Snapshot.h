@@ -0,0 +1,136 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+// The binary encoding of the simulation's state (see Checkpoint.h).
+//
+// Values are stored as their raw bytes, in the order the classes write them,
+// so a snapshot is read back by the same build on the same kind of machine.
+// Every class with state to save has a saveState()/restoreState() pair.
+class SnapshotWriter {
+ public:
+  /**
+   * @brief Append the raw bytes of a value
+   *
+   * @param value The value (a number or a plain struct)
+   */
+  template <typename T>
+  void put(const T& value) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "only plain values can be put in a snapshot");
+    buf.append(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  /**
+   * @brief Append a string, after its length
+   *
+   * @param text The string
+   */
+  void putString(const std::string& text) {
+    put<uint32_t>(text.size());
+    buf.append(text);
+  }
+
+  /**
+   * @brief Get the bytes written so far
+   *
+   * @return const std::string& The snapshot
+   */
+  const std::string& data() const { return buf; }
+
+ private:
+  std::string buf;
+};
+
+// Reads values back from a snapshot, failing once it runs out.
+class SnapshotReader {
+ public:
+  /**
+   * @brief Construct a new Snapshot Reader object
+   *
+   * @param buf The snapshot (it must outlive the reader)
+   */
+  explicit SnapshotReader(const std::string& buf)
+      : buf{buf}, pos{0}, ok{true} {}
+
+  /**
+   * @brief Read the next value
+   *
+   * @return T The value, or a zero value once the snapshot ran out
+   */
+  template <typename T>
+  T get() {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "only plain values can be read from a snapshot");
+    T value{};
+    if (pos + sizeof(T) > buf.size()) {
+      ok = false;
+      return value;
+    }
+    std::memcpy(&value, buf.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return value;
+  }
+
+  /**
+   * @brief Read a string written by putString()
+   *
+   * @return std::string The string (empty once the snapshot ran out)
+   */
+  std::string getString() {
+    uint32_t len{get<uint32_t>()};
+    if (!ok || pos + len > buf.size()) {
+      ok = false;
+      return "";
+    }
+    std::string text{buf.substr(pos, len)};
+    pos += len;
+    return text;
+  }
+
+  /**
+   * @brief Read a count of items that follow, each at least minSize bytes
+   *
+   * Guards the allocations against a damaged count.
+   *
+   * @param minSize The fewest bytes an item takes
+   * @return size_t The count (0 once the snapshot ran out)
+   */
+  size_t getCount(size_t minSize) {
+    uint64_t count{get<uint64_t>()};
+    if (!ok || count > (buf.size() - pos) / (minSize > 0 ? minSize : 1)) {
+      ok = false;
+      return 0;
+    }
+    return count;
+  }
+
+  /**
+   * @brief Mark the snapshot as damaged (a value was out of range)
+   */
+  void fail() { ok = false; }
+
+  /**
+   * @brief Check whether every read so far succeeded
+   *
+   * @return true No read ran out of data
+   */
+  bool isGood() const { return ok; }
+
+  /**
+   * @brief Check whether the whole snapshot was read without errors
+   *
+   * @return true Every byte was read
+   */
+  bool isDone() const { return ok && pos == buf.size(); }
+
+ private:
+  const std::string& buf;
+  size_t pos;
+  bool ok;
+};
+
+#endif
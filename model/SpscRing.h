@@ -0,0 +1,106 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// A lock-free ring buffer with a single producer and a single consumer.
+//
+// Items are moved in bulk: a whole batch is copied in or out and published
+// with one atomic store, so the cost of the synchronization is shared by the
+// batch. The producer and consumer positions live on separate cache lines.
+template <typename T>
+class SpscRing {
+ public:
+  /**
+   * @brief Construct a new Spsc Ring object
+   *
+   * @param capacity The number of items (rounded up to a power of two)
+   */
+  explicit SpscRing(size_t capacity) : head{0}, tail{0}, closed{false} {
+    size_t size{1};
+    while (size < capacity) size <<= 1;
+    buffer.resize(size);
+    mask = size - 1;
+    cachedHead = 0;
+    cachedTail = 0;
+  }
+
+  /**
+   * @brief Copy as many items in as there is room for (producer only)
+   *
+   * @param items The items to add
+   * @param n The number of items
+   * @return size_t The number of items added
+   */
+  size_t push(const T* items, size_t n) {
+    size_t t{tail.load(std::memory_order_relaxed)};
+    size_t room{buffer.size() - (t - cachedHead)};
+    if (room < n) {
+      // only look at the consumer's position when the cached one is stale
+      cachedHead = head.load(std::memory_order_acquire);
+      room = buffer.size() - (t - cachedHead);
+    }
+    if (n > room) n = room;
+
+    for (size_t ii = 0; ii < n; ii++) buffer[(t + ii) & mask] = items[ii];
+    tail.store(t + n, std::memory_order_release);
+    return n;
+  }
+
+  /**
+   * @brief Copy up to n items out (consumer only)
+   *
+   * @param items Where the items are copied to
+   * @param n The most items to take
+   * @return size_t The number of items taken
+   */
+  size_t pop(T* items, size_t n) {
+    size_t h{head.load(std::memory_order_relaxed)};
+    size_t avail{cachedTail - h};
+    if (avail < n) {
+      cachedTail = tail.load(std::memory_order_acquire);
+      avail = cachedTail - h;
+    }
+    if (n > avail) n = avail;
+
+    for (size_t ii = 0; ii < n; ii++) items[ii] = buffer[(h + ii) & mask];
+    head.store(h + n, std::memory_order_release);
+    return n;
+  }
+
+  /**
+   * @brief Tell the consumer no more items will come (producer only)
+   */
+  void close() { closed.store(true, std::memory_order_release); }
+
+  /**
+   * @brief Check whether the producer is done and everything was taken
+   *
+   * @return true There is nothing left to pop, now or later
+   * @return false More items are or may become available
+   */
+  bool isDrained() const {
+    // read the flag first, so items pushed before close() are not missed
+    bool isClosed{closed.load(std::memory_order_acquire)};
+    return isClosed && tail.load(std::memory_order_acquire) ==
+                           head.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::vector<T> buffer;
+  size_t mask;
+
+  // the consumer's position, and its copy of the producer's position
+  alignas(64) std::atomic<size_t> head;
+  size_t cachedTail;
+
+  // the producer's position, and its copy of the consumer's position
+  alignas(64) std::atomic<size_t> tail;
+  size_t cachedHead;
+
+  alignas(64) std::atomic<bool> closed;
+};
+
+#endif
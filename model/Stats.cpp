@@ -0,0 +1,127 @@
+#include "Stats.h"
+
+#include <cmath>
+
+RunningStat::RunningStat() : n{0}, mean{0.0}, m2{0.0} {}
+
+RunningStat::RunningStat(long long n, double mean, double variance)
+    : n{n}, mean{n > 0 ? mean : 0.0}, m2{n > 1 ? variance * (n - 1) : 0.0} {}
+
+void RunningStat::add(double x) {
+  ++n;
+  double diff{x - mean};
+  mean += diff / n;
+  m2 += diff * (x - mean);
+}
+
+void RunningStat::merge(const RunningStat& other) {
+  if (other.n == 0) return;
+  if (n == 0) {
+    *this = other;
+    return;
+  }
+
+  // Chan et al.'s pairwise update
+  long long total{n + other.n};
+  double diff{other.mean - mean};
+  mean += diff * other.n / total;
+  m2 += other.m2 + diff * diff * (static_cast<double>(n) * other.n / total);
+  n = total;
+}
+
+void RunningStat::clear() { *this = RunningStat(); }
+
+void RunningStat::saveState(SnapshotWriter& out) const {
+  out.put(n);
+  out.put(mean);
+  out.put(m2);
+}
+
+void RunningStat::restoreState(SnapshotReader& in) {
+  n = in.get<long long>();
+  mean = in.get<double>();
+  m2 = in.get<double>();
+}
+
+long long RunningStat::getCount() const { return n; }
+
+double RunningStat::getMean() const { return mean; }
+
+double RunningStat::getVariance() const { return n > 1 ? m2 / (n - 1) : 0.0; }
+
+double RunningStat::getStdDev() const { return std::sqrt(getVariance()); }
+
+CompensatedSum::CompensatedSum() : sum{0.0}, compensation{0.0} {}
+
+void CompensatedSum::merge(const CompensatedSum& other) {
+  add(other.sum);
+  compensation += other.compensation;
+}
+
+void CompensatedSum::clear() { *this = CompensatedSum(); }
+
+void CompensatedSum::saveState(SnapshotWriter& out) const {
+  out.put(sum);
+  out.put(compensation);
+}
+
+void CompensatedSum::restoreState(SnapshotReader& in) {
+  sum = in.get<double>();
+  compensation = in.get<double>();
+}
+
+TimeAverage::TimeAverage()
+    : origin{0.0}, last{0.0}, level{0.0}, merged{0.0} {}
+
+void TimeAverage::update(double t, double delta) {
+  advance(t);
+  level += delta;
+}
+
+void TimeAverage::advance(double t) {
+  if (t <= last) return;
+  area.add(level * (t - last));
+  last = t;
+}
+
+void TimeAverage::restart(double t) {
+  advance(t);
+  origin = t;
+  last = t;
+  area.clear();
+  merged = 0.0;
+}
+
+void TimeAverage::merge(const TimeAverage& other) {
+  area.merge(other.area);
+  merged += other.getSpan();
+}
+
+void TimeAverage::clear() { *this = TimeAverage(); }
+
+void TimeAverage::saveState(SnapshotWriter& out) const {
+  out.put(origin);
+  out.put(last);
+  out.put(level);
+  area.saveState(out);
+  out.put(merged);
+}
+
+void TimeAverage::restoreState(SnapshotReader& in) {
+  origin = in.get<double>();
+  last = in.get<double>();
+  level = in.get<double>();
+  area.restoreState(in);
+  merged = in.get<double>();
+}
+
+double TimeAverage::getArea() const { return area.getSum(); }
+
+double TimeAverage::getSpan() const { return (last - origin) + merged; }
+
+double TimeAverage::getLevel() const { return level; }
+
+double TimeAverage::getMean() const {
+  double span{getSpan()};
+  return span > 0.0 ? getArea() / span : 0.0;
+}
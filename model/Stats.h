@@ -0,0 +1,262 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <cmath>
+
+#include "Snapshot.h"
+
+// The running mean and variance of a sample (Welford's algorithm).
+//
+// Nothing but the count, the mean and the sum of squared deviations is kept,
+// so the accumulator stays accurate over billions of observations where the
+// naive sum of x and x^2 would not. Two accumulators can be merged, e.g. the
+// per-node ones of a run or the ones kept by different threads.
+class RunningStat {
+ public:
+  /**
+   * @brief Construct an empty Running Stat object
+   */
+  RunningStat();
+
+  /**
+   * @brief Construct a Running Stat object from a summary
+   *
+   * @param n The number of observations
+   * @param mean Their mean
+   * @param variance Their (sample) variance
+   */
+  RunningStat(long long n, double mean, double variance);
+
+  /**
+   * @brief Add an observation
+   *
+   * @param x The observation
+   */
+  void add(double x);
+
+  /**
+   * @brief Add the observations of another accumulator to this one
+   *
+   * @param other The accumulator to merge in
+   */
+  void merge(const RunningStat& other);
+
+  /**
+   * @brief Forget all observations
+   */
+  void clear();
+
+  /**
+   * @brief Get the number of observations
+   *
+   * @return long long The number of observations
+   */
+  long long getCount() const;
+
+  /**
+   * @brief Get the mean of the observations
+   *
+   * @return double The mean (0 if there are none)
+   */
+  double getMean() const;
+
+  /**
+   * @brief Get the sample variance of the observations
+   *
+   * @return double The variance (0 with fewer than two observations)
+   */
+  double getVariance() const;
+
+  /**
+   * @brief Get the sample standard deviation of the observations
+   *
+   * @return double The standard deviation
+   */
+  double getStdDev() const;
+
+  /**
+   * @brief Append the state to a checkpoint
+   *
+   * @param out The snapshot being written
+   */
+  void saveState(SnapshotWriter& out) const;
+
+  /**
+   * @brief Replace the state with one written by saveState()
+   *
+   * @param in The snapshot being read
+   */
+  void restoreState(SnapshotReader& in);
+
+ private:
+  long long n;  // the number of observations
+  double mean;  // the running mean
+  double m2;    // the sum of squared deviations from the mean
+};
+
+// A running sum with Neumaier's compensation.
+//
+// The low-order bits each addition rounds away are collected in a second
+// term, so the sum of billions of terms stays as accurate as the terms
+// themselves, where a plain double loses more of them the longer a run goes.
+class CompensatedSum {
+ public:
+  /**
+   * @brief Construct a Compensated Sum object of 0
+   */
+  CompensatedSum();
+
+  /**
+   * @brief Add a term
+   *
+   * @param x The term
+   */
+  void add(double x) {
+    double total{sum + x};
+    // whichever of the two is smaller lost bits in the addition
+    if (std::fabs(sum) >= std::fabs(x)) {
+      compensation += (sum - total) + x;
+    } else {
+      compensation += (x - total) + sum;
+    }
+    sum = total;
+  }
+
+  /**
+   * @brief Add the terms of another sum to this one
+   *
+   * @param other The sum to merge in
+   */
+  void merge(const CompensatedSum& other);
+
+  /**
+   * @brief Start again from 0
+   */
+  void clear();
+
+  /**
+   * @brief Get the sum of the terms
+   *
+   * @return double The sum
+   */
+  double getSum() const { return sum + compensation; }
+
+  /**
+   * @brief Append the state to a checkpoint
+   *
+   * @param out The snapshot being written
+   */
+  void saveState(SnapshotWriter& out) const;
+
+  /**
+   * @brief Replace the state with one written by saveState()
+   *
+   * @param in The snapshot being read
+   */
+  void restoreState(SnapshotReader& in);
+
+ private:
+  double sum;           // the rounded sum
+  double compensation;  // what the rounding lost
+};
+
+// The time average of a piecewise-constant quantity, such as a queue length.
+//
+// The area under the quantity is integrated exactly at every change of its
+// level, in O(1), with a compensated sum. Merging adds up both the areas and
+// the time spans, so the merged mean is the time-weighted mean of the parts
+// (per node, or over windows simulated by different threads).
+class TimeAverage {
+ public:
+  /**
+   * @brief Construct a Time Average object starting at time 0, level 0
+   */
+  TimeAverage();
+
+  /**
+   * @brief Change the level at the given time
+   *
+   * @param t The time of the change (not before the last change)
+   * @param delta The change of the level
+   */
+  void update(double t, double delta);
+
+  /**
+   * @brief Integrate up to the given time without changing the level
+   *
+   * @param t The time to integrate up to
+   */
+  void advance(double t);
+
+  /**
+   * @brief Drop the area so far and start integrating again from a time
+   *
+   * The current level is kept.
+   *
+   * @param t The new origin
+   */
+  void restart(double t);
+
+  /**
+   * @brief Add the area and span of another average to this one
+   *
+   * @param other The average to merge in
+   */
+  void merge(const TimeAverage& other);
+
+  /**
+   * @brief Forget everything and start again from time 0, level 0
+   */
+  void clear();
+
+  /**
+   * @brief Get the area integrated so far
+   *
+   * @return double The integral of the level over the span
+   */
+  double getArea() const;
+
+  /**
+   * @brief Get the time span integrated so far
+   *
+   * @return double The span
+   */
+  double getSpan() const;
+
+  /**
+   * @brief Get the current level
+   *
+   * @return double The level
+   */
+  double getLevel() const;
+
+  /**
+   * @brief Get the time average of the level
+   *
+   * @return double The area over the span (0 if the span is empty)
+   */
+  double getMean() const;
+
+  /**
+   * @brief Append the state to a checkpoint
+   *
+   * @param out The snapshot being written
+   */
+  void saveState(SnapshotWriter& out) const;
+
+  /**
+   * @brief Replace the state with one written by saveState()
+   *
+   * @param in The snapshot being read
+   */
+  void restoreState(SnapshotReader& in);
+
+ private:
+  double origin;        // when the integration started
+  double last;          // the time of the last update
+  double level;         // the level since the last update
+  CompensatedSum area;  // the integral from origin to last
+  double merged;        // the span added by merge()
+};
+
+#endif
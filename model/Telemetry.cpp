@@ -0,0 +1,137 @@
+#include "Telemetry.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#include "WallClock.h"
+
+const long long Telemetry::CHECK_EVERY;
+constexpr double Telemetry::PUBLISH_INTERVAL;
+
+static_assert(offsetof(TelemetryHeader, seq) == 16, "seq moved");
+static_assert(offsetof(TelemetryHeader, jobs) == 40, "jobs moved");
+static_assert(sizeof(TelemetryHeader) == 128, "the header's size changed");
+
+Telemetry::Telemetry(const std::string& name, int maxNodes)
+    : name{"/" + name},
+      segment{nullptr},
+      size{sizeof(TelemetryHeader) +
+           std::max(maxNodes, 0) * sizeof(TelemetryNode)},
+      header{nullptr},
+      slots{nullptr},
+      startTime{wallTime()},
+      lastTime{0.0},
+      lastJobs{0} {
+  int fd{::shm_open(this->name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644)};
+  if (fd < 0) return;
+
+  if (::ftruncate(fd, size) == 0) {
+    void* mapped{
+        ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)};
+    if (mapped != MAP_FAILED) segment = mapped;
+  }
+  ::close(fd);  // the mapping stays valid
+  if (!segment) {
+    ::shm_unlink(this->name.c_str());
+    return;
+  }
+
+  // the segment starts zeroed
+  header = new (segment) TelemetryHeader;
+  std::memcpy(header->magic, "LBTELEM", 8);
+  header->version = VERSION;
+  header->maxNodes = std::max(maxNodes, 0);
+  header->seq.store(0, std::memory_order_release);
+  slots = reinterpret_cast<TelemetryNode*>(header + 1);
+}
+
+Telemetry::~Telemetry() {
+  if (!header) return;
+
+  uint64_t seq{beginWrite()};
+  header->state = 2;
+  header->wallTime = elapsed();
+  endWrite(seq);
+
+  ::munmap(segment, size);
+  ::shm_unlink(name.c_str());
+}
+
+bool Telemetry::isOk() const { return header != nullptr; }
+
+double Telemetry::elapsed() const { return wallTime() - startTime; }
+
+uint64_t Telemetry::beginWrite() {
+  // an odd seq tells the readers the fields are being changed
+  uint64_t seq{header->seq.load(std::memory_order_relaxed)};
+  header->seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  return seq;
+}
+
+void Telemetry::endWrite(uint64_t seq) {
+  header->seq.store(seq + 2, std::memory_order_release);
+}
+
+void Telemetry::beginRun(const std::string& label, int model, int nNodes,
+                         long long totalJobs) {
+  if (!header) return;
+
+  uint64_t seq{beginWrite()};
+
+  header->state = 1;
+  header->model = model;
+  header->nNodes = std::min<uint32_t>(nNodes, header->maxNodes);
+  header->dispatchQueue = 0;
+  header->jobs = 0;
+  header->totalJobs = totalJobs;
+  header->rejects = 0;
+  header->simTime = 0.0;
+  header->eventsPerSec = 0.0;
+  header->wallTime = elapsed();
+  std::memset(header->label, 0, sizeof(header->label));
+  std::strncpy(header->label, label.c_str(), sizeof(header->label) - 1);
+  std::memset(slots, 0, header->maxNodes * sizeof(TelemetryNode));
+
+  endWrite(seq);
+
+  lastTime = elapsed();
+  lastJobs = 0;
+}
+
+void Telemetry::publish(double simTime, long long jobs, long long rejects,
+                        std::vector<ServiceNode>& nodes, size_t dispatchQueue,
+                        bool force) {
+  if (!header) return;
+
+  double now{elapsed()};
+  if (!force && now - lastTime < PUBLISH_INTERVAL) return;
+
+  size_t nSlots{std::min<size_t>(nodes.size(), header->maxNodes)};
+  for (size_t ii = 0; ii < nSlots; ii++) nodes[ii].advanceTo(simTime);
+
+  uint64_t seq{beginWrite()};
+
+  header->dispatchQueue = dispatchQueue;
+  header->jobs = jobs;
+  header->rejects = rejects;
+  header->simTime = simTime;
+  if (now > lastTime) {
+    header->eventsPerSec = (jobs - lastJobs) / (now - lastTime);
+  }
+  header->wallTime = now;
+  for (size_t ii = 0; ii < nSlots; ii++) {
+    slots[ii].queue = nodes[ii].getQueueLevel();
+    slots[ii].util = nodes[ii].getUtilSoFar();
+  }
+
+  endWrite(seq);
+
+  lastTime = now;
+  lastJobs = jobs;
+}
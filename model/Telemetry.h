@@ -0,0 +1,134 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Node.h"
+
+// The start of the shared segment (all fields little-endian, at fixed
+// offsets so other languages can read them, see util/watch-telemetry.py).
+//
+// The fields are guarded by a seqlock: the simulation makes seq odd, writes,
+// then makes it even again. A reader copies the segment between two reads of
+// seq and retries if they differ or are odd, so the simulation never waits
+// for a reader.
+struct TelemetryHeader {
+  char magic[8];               // "LBTELEM"
+  uint32_t version;
+  uint32_t maxNodes;           // the node slots after the header
+  std::atomic<uint64_t> seq;
+  uint32_t state;              // 0 before the first run, 1 running, 2 done
+  uint32_t model;              // the Model of the current run
+  uint32_t nNodes;             // the nodes of the current run
+  uint32_t dispatchQueue;      // the dispatcher's queue (sqms)
+  int64_t jobs;                // the jobs dispatched so far in the run
+  int64_t totalJobs;           // the jobs of the run
+  int64_t rejects;             // the jobs rejected so far in the run
+  double simTime;              // the simulated time (the last arrival)
+  double eventsPerSec;         // jobs per second of wall time, lately
+  double wallTime;             // seconds since the segment was created
+  char label[40];              // the run's description
+};
+
+// The state of one node, after the header
+struct TelemetryNode {
+  double queue;  // the jobs waiting in the node's queue
+  double util;   // the node's utilization so far
+};
+
+// Publishes the progress of the runs in a POSIX shared memory segment.
+//
+// Publishing is cheap enough for the hot loop: isDue() only tests the job
+// index, and publish() reads the clock and writes at most every
+// PUBLISH_INTERVAL seconds.
+class Telemetry {
+ public:
+  static const uint32_t VERSION{1};
+  // the jobs between two looks at the clock (a power of two)
+  static const long long CHECK_EVERY{1024};
+  // the least wall time between two updates, in seconds
+  static constexpr double PUBLISH_INTERVAL{0.1};
+
+  /**
+   * @brief Create (or replace) the shared memory segment
+   *
+   * @param name The segment's name, without the leading '/'
+   * @param maxNodes The most nodes a run can publish
+   */
+  Telemetry(const std::string& name, int maxNodes);
+
+  /**
+   * @brief Mark the runs as done, then unmap and remove the segment
+   */
+  ~Telemetry();
+
+  Telemetry(const Telemetry&) = delete;
+  Telemetry& operator=(const Telemetry&) = delete;
+
+  /**
+   * @brief Check whether the segment was created
+   *
+   * @return true Updates are published
+   */
+  bool isOk() const;
+
+  /**
+   * @brief Start publishing a new run
+   *
+   * @param label A short description of the run
+   * @param model The run's Model
+   * @param nNodes The run's nodes
+   * @param totalJobs The jobs the run will dispatch
+   */
+  void beginRun(const std::string& label, int model, int nNodes,
+                long long totalJobs);
+
+  /**
+   * @brief Check whether a job is one to (maybe) publish at
+   *
+   * @param job The job's index in the run
+   * @return true publish() should be called
+   */
+  bool isDue(long long job) const { return (job & (CHECK_EVERY - 1)) == 0; }
+
+  /**
+   * @brief Publish the progress, unless the last update was too recent
+   *
+   * The nodes' time averages are brought up to the current time, which does
+   * not change the results.
+   *
+   * @param simTime The simulated time
+   * @param jobs The jobs dispatched so far
+   * @param rejects The jobs rejected so far
+   * @param nodes The nodes of the run
+   * @param dispatchQueue The length of the dispatcher's queue
+   * @param force Publish whatever the time since the last update
+   */
+  void publish(double simTime, long long jobs, long long rejects,
+               std::vector<ServiceNode>& nodes, size_t dispatchQueue,
+               bool force = false);
+
+ private:
+  // the wall time since the segment was created, in seconds
+  double elapsed() const;
+
+  // start changing the fields (the seqlock's write side), get the old seq
+  uint64_t beginWrite();
+  // finish changing the fields
+  void endWrite(uint64_t seq);
+
+  std::string name;
+  void* segment;
+  size_t size;
+  TelemetryHeader* header;
+  TelemetryNode* slots;
+  double startTime;
+  double lastTime;       // when the last update was published
+  long long lastJobs;    // the jobs at the last update
+};
+
+#endif
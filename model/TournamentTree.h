@@ -0,0 +1,180 @@
+#ifndef TOURNAMENT_TREE_H
+#define TOURNAMENT_TREE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// A tournament (winner) tree over the items 0..n-1, whose root is the item
+// with the smallest key.
+//
+// Key is a function object that looks an item's key up wherever it lives.
+// The tree keeps a copy of every item's key, in blocks of BLOCK items (a
+// cache line), and its leaves are the winners of the blocks. Every node keeps
+// its winner's key next to the winner, so update() replays the matches of one
+// item after its key changed, in O(log n), from the tree alone: only the item
+// is looked up, then its block scanned. Among equal keys the lowest index
+// wins, like a linear scan that only moves on to a strictly smaller key. The
+// blocks are the leaves of about n / BLOCK inner nodes (the bottom-up layout,
+// without rounding up to a power of two), so the nodes take a key and a 32-bit
+// index per block, small enough to stay in the cache of a large fleet.
+template <typename Key>
+class TournamentTree {
+ public:
+  /**
+   * @brief Construct a new Tournament Tree object and play every match
+   *
+   * @param n The number of items (at least one)
+   * @param key Gives the current key of an item
+   */
+  TournamentTree(int n, Key key)
+      : n{static_cast<uint32_t>(n)},
+        leaves{(this->n + BLOCK - 1) / BLOCK},
+        key{key} {
+    leaves += leaves & 1;
+    // one more block, to start the first on a cache line
+    itemKeys.resize((leaves + 1) * BLOCK);
+    size_t offset{reinterpret_cast<uintptr_t>(itemKeys.data()) % LINE};
+    firstKey = itemKeys.data() + (offset > 0 ? LINE - offset : 0) /
+                                     sizeof(Value);
+    for (uint32_t item = 0; item < leaves * BLOCK; item++) {
+      firstKey[item] = item < this->n ? key(item) : emptyKey();
+    }
+    keys.resize(2 * leaves);
+    winners.resize(2 * leaves);
+    for (uint32_t block = 0; block < leaves; block++) {
+      setMatch(block + leaves, scan(block));
+    }
+    for (uint32_t node = leaves - 1; node >= 1; node--) {
+      Match left{matchOf(2 * node)};
+      Match right{matchOf(2 * node + 1)};
+      setMatch(node, beats(right, left) ? right : left);
+    }
+  }
+
+  // not copied: firstKey points into itemKeys
+  TournamentTree(const TournamentTree&) = delete;
+  TournamentTree& operator=(const TournamentTree&) = delete;
+
+  /**
+   * @brief Get the item with the smallest key
+   *
+   * @return int The item's index
+   */
+  int getWinner() const { return winners[1]; }
+
+  /**
+   * @brief Get the memory the tree takes
+   *
+   * @return size_t The bytes of the items' keys and the nodes
+   */
+  size_t getBytes() const {
+    return (itemKeys.capacity() + keys.capacity()) * sizeof(Value) +
+           winners.capacity() * sizeof(uint32_t);
+  }
+
+  /**
+   * @brief Start fetching the block an update() of an item scans
+   *
+   * @param item The item's index
+   */
+  void prefetch(int item) const { __builtin_prefetch(&firstKey[item]); }
+
+  /**
+   * @brief Replay the matches of an item whose key changed
+   *
+   * @param item The item's index
+   */
+  void update(int item) {
+    // rescan the item's block, then carry its winner and key up, so each
+    // match only reads the other side's (written out, as this is where the
+    // policies spend their time)
+    firstKey[item] = key(item);
+    uint32_t child{static_cast<uint32_t>(item) / BLOCK + leaves};
+    Match winner{scan(child - leaves)};
+    Value* keyAt{keys.data()};
+    uint32_t* winnerAt{winners.data()};
+    keyAt[child] = winner.key;
+    winnerAt[child] = winner.winner;
+    for (; child > 1; child /= 2) {
+      uint32_t rival{child ^ 1};
+      Match other{keyAt[rival], winnerAt[rival]};
+      if (other.key < winner.key ||
+          (!(winner.key < other.key) && other.winner < winner.winner)) {
+        winner = other;
+      }
+      keyAt[child / 2] = winner.key;
+      winnerAt[child / 2] = winner.winner;
+    }
+  }
+
+ private:
+  using Value = decltype(std::declval<Key>()(0u));
+
+  // the winner of a block of padding items
+  static const uint32_t NONE{UINT32_MAX};
+  // the bytes of a cache line, and the items of a block, whose keys fill one
+  static const size_t LINE{64};
+  static const uint32_t BLOCK{LINE / sizeof(Value)};
+
+  // the winner below a node and its key
+  struct Match {
+    Value key;
+    uint32_t winner;
+  };
+
+  // the key of the padding leaf, which loses every match
+  static Value emptyKey() {
+    return std::numeric_limits<Value>::has_infinity
+               ? std::numeric_limits<Value>::infinity()
+               : std::numeric_limits<Value>::max();
+  }
+
+  // whether a match beats another: a smaller key, or the lower index among
+  // equal keys (the two sides of a node aren't ordered by index)
+  static bool beats(const Match& a, const Match& b) {
+    return a.key < b.key || (!(b.key < a.key) && a.winner < b.winner);
+  }
+
+  // the winner of a block, from its copy of the keys (without branches, as
+  // the smallest key is anywhere in it)
+  Match scan(uint32_t block) const {
+    const Value* keyAt{firstKey + block * BLOCK};
+    uint32_t best{0};
+    for (uint32_t idx = 1; idx < BLOCK; idx++) {
+      best = keyAt[idx] < keyAt[best] ? idx : best;
+    }
+    uint32_t item{block * BLOCK + best};
+    return Match{keyAt[best], item < n ? item : NONE};
+  }
+
+  // the match of a node (the nodes from 'leaves' on are the blocks)
+  Match matchOf(uint32_t node) const {
+    return Match{keys[node], winners[node]};
+  }
+
+  void setMatch(uint32_t node, const Match& match) {
+    keys[node] = match.key;
+    winners[node] = match.winner;
+  }
+
+  uint32_t n;
+  uint32_t leaves;                // the blocks, rounded up to even, so that a
+                                  // block's first match is its neighbour's
+  Key key;
+  std::vector<Value> itemKeys;    // of the items, then of padding
+  Value* firstKey;                // the first item's, on a cache line
+  std::vector<Value> keys;        // of the nodes' winners, the root at 1
+  std::vector<uint32_t> winners;  // of the nodes
+};
+
+template <typename Key>
+const uint32_t TournamentTree<Key>::NONE;
+template <typename Key>
+const size_t TournamentTree<Key>::LINE;
+template <typename Key>
+const uint32_t TournamentTree<Key>::BLOCK;
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef WALL_CLOCK_H
+#define WALL_CLOCK_H
+
+#include <chrono>
+
+/**
+ * @brief Read a monotonic wall clock, to time a run's loop or pace the work
+ *
+ * @return double The time in seconds (from an arbitrary start)
+ */
+inline double wallTime() {
+  return std::chrono::duration<double>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+#endif
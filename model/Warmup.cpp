@@ -0,0 +1,151 @@
+#include "Warmup.h"
+
+// the fewest batches MSER is evaluated on (fewer makes the statistic noisy)
+const size_t MIN_BATCHES{200};
+
+WarmupDetector::WarmupDetector(long batchSize, size_t maxBatches)
+    : batchSize{batchSize},
+      maxBatches{maxBatches},
+      partialSum{0.0},
+      partialCount{0},
+      partialJob{0},
+      nextCheck{MIN_BATCHES},
+      numObs{0},
+      truncObs{-1},
+      truncJob{-1} {
+  batchMeans.reserve(maxBatches);
+  batchJobs.reserve(maxBatches);
+}
+
+bool WarmupDetector::observe(double x, long long jobIdx) {
+  ++numObs;
+  if (isDetected()) return false;
+
+  // remember the first job of this batch
+  if (partialCount == 0) partialJob = jobIdx;
+
+  partialSum += x;
+  ++partialCount;
+  if (partialCount < batchSize) return false;
+
+  // the batch is complete
+  batchMeans.push_back(partialSum / partialCount);
+  batchJobs.push_back(partialJob);
+  partialSum = 0.0;
+  partialCount = 0;
+
+  if (batchMeans.size() == maxBatches) {
+    compact();
+  }
+
+  if (batchMeans.size() < nextCheck) return false;
+
+  // check again once the data has grown by another eighth
+  nextCheck = batchMeans.size() + batchMeans.size() / 8;
+
+  size_t dBest{findTruncation()};
+
+  // a minimum at the edge of the search window means the transient may still
+  // be going on, so wait for more data
+  if (dBest >= batchMeans.size() / 2) return false;
+
+  truncObs = static_cast<long long>(dBest) * batchSize;
+  truncJob = batchJobs[dBest];
+
+  // the buffers are not needed anymore
+  std::vector<double>().swap(batchMeans);
+  std::vector<long long>().swap(batchJobs);
+
+  return true;
+}
+
+void WarmupDetector::compact() {
+  size_t half{batchMeans.size() / 2};
+  for (size_t ii = 0; ii < half; ii++) {
+    batchMeans[ii] = (batchMeans[2 * ii] + batchMeans[2 * ii + 1]) / 2.0;
+    batchJobs[ii] = batchJobs[2 * ii];
+  }
+  batchMeans.resize(half);
+  batchJobs.resize(half);
+  batchSize *= 2;
+
+  nextCheck = half + half / 8;
+}
+
+size_t WarmupDetector::findTruncation() const {
+  size_t k{batchMeans.size()};
+  size_t dBest{0};
+  double best{-1.0};
+
+  // accumulate the suffix sums from the back so every d is O(1)
+  double sum{0.0};
+  double sumSq{0.0};
+  for (size_t d = k; d-- > 0;) {
+    sum += batchMeans[d];
+    sumSq += batchMeans[d] * batchMeans[d];
+
+    if (d > k / 2) continue;
+
+    double n{static_cast<double>(k - d)};
+    double mean{sum / n};
+    double ss{sumSq - n * mean * mean};
+    if (ss < 0.0) ss = 0.0;  // guard against rounding
+    double mser{ss / (n * n)};
+
+    // prefer the smaller truncation on ties
+    if (best < 0.0 || mser <= best) {
+      best = mser;
+      dBest = d;
+    }
+  }
+
+  return dBest;
+}
+
+bool WarmupDetector::isDetected() const { return truncObs >= 0; }
+
+long long WarmupDetector::getTruncationObs() const { return truncObs; }
+
+long long WarmupDetector::getTruncationJob() const { return truncJob; }
+
+long long WarmupDetector::getNumObs() const { return numObs; }
+
+WarmupReport WarmupDetector::getReport() const {
+  return WarmupReport{isDetected(), truncObs, truncJob, numObs};
+}
+
+void WarmupDetector::saveState(SnapshotWriter& out) const {
+  out.put(batchSize);
+  out.put<uint64_t>(maxBatches);
+  out.put<uint64_t>(batchMeans.size());
+  for (size_t ii = 0; ii < batchMeans.size(); ii++) {
+    out.put(batchMeans[ii]);
+    out.put(batchJobs[ii]);
+  }
+  out.put(partialSum);
+  out.put(partialCount);
+  out.put(partialJob);
+  out.put<uint64_t>(nextCheck);
+  out.put(numObs);
+  out.put(truncObs);
+  out.put(truncJob);
+}
+
+void WarmupDetector::restoreState(SnapshotReader& in) {
+  batchSize = in.get<long>();
+  maxBatches = in.get<uint64_t>();
+  size_t nBatches{in.getCount(sizeof(double) + sizeof(long long))};
+  batchMeans.clear();
+  batchJobs.clear();
+  for (size_t ii = 0; ii < nBatches; ii++) {
+    batchMeans.push_back(in.get<double>());
+    batchJobs.push_back(in.get<long long>());
+  }
+  partialSum = in.get<double>();
+  partialCount = in.get<long>();
+  partialJob = in.get<long long>();
+  nextCheck = in.get<uint64_t>();
+  numObs = in.get<long long>();
+  truncObs = in.get<long long>();
+  truncJob = in.get<long long>();
+}
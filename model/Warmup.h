@@ -0,0 +1,140 @@
+#ifndef WARMUP_H
+#define WARMUP_H
+
+#include <cstddef>
+#include <vector>
+
+#include "Snapshot.h"
+
+// A summary of where a run's warm-up was truncated
+struct WarmupReport {
+  bool detected;       // a truncation point was found
+  long long truncObs;  // the observations discarded
+  long long truncJob;  // the first job of the steady state
+  long long numObs;    // the observations seen
+};
+
+// Online warm-up (initial transient) detection using MSER-5.
+//
+// Observations are grouped into batches of 5 and only the batch means are
+// kept. The buffer of batch means has a fixed capacity; once it fills up,
+// neighbouring batches are merged pairwise (doubling the batch size), so the
+// memory used is constant no matter how long the run is.
+class WarmupDetector {
+ public:
+  /**
+   * @brief Construct a new Warmup Detector object
+   *
+   * @param batchSize The number of observations per batch (5 for MSER-5)
+   * @param maxBatches The capacity of the batch-mean buffer (must be even)
+   */
+  WarmupDetector(long batchSize = 5, size_t maxBatches = 1024);
+
+  /**
+   * @brief Add an observation to the detector.
+   *
+   * The MSER statistic is re-evaluated every time the number of batches has
+   * grown by an eighth, which keeps the cost amortized O(1) per observation.
+   *
+   * @param x The observed value (e.g. a job's delay)
+   * @param jobIdx The index of the job the observation belongs to
+   * @return true The truncation point was found with this observation
+   * @return false Still in the transient, or the point was already found
+   */
+  bool observe(double x, long long jobIdx);
+
+  /**
+   * @brief Check whether a truncation point has been detected.
+   *
+   * @return true A truncation point was found
+   * @return false The detector has not settled yet
+   */
+  bool isDetected() const;
+
+  /**
+   * @brief Get the detected truncation point in observations.
+   *
+   * @return long long The number of observations to discard
+   */
+  long long getTruncationObs() const;
+
+  /**
+   * @brief Get the detected truncation point as a job index.
+   *
+   * @return long long The index of the first job in the steady state
+   */
+  long long getTruncationJob() const;
+
+  /**
+   * @brief Get the number of observations seen so far.
+   *
+   * @return long long The number of observations
+   */
+  long long getNumObs() const;
+
+  /**
+   * @brief Summarize the detection for reporting.
+   *
+   * @return WarmupReport The truncation point and the observations seen
+   */
+  WarmupReport getReport() const;
+
+  /**
+   * @brief Append the detector's batches and state to a checkpoint
+   *
+   * @param out The snapshot being written
+   */
+  void saveState(SnapshotWriter& out) const;
+
+  /**
+   * @brief Replace the detector's state with one written by saveState()
+   *
+   * @param in The snapshot being read
+   */
+  void restoreState(SnapshotReader& in);
+
+ private:
+  /**
+   * @brief Merge neighbouring batches pairwise, doubling the batch size.
+   */
+  void compact();
+
+  /**
+   * @brief Evaluate MSER over the current batch means.
+   *
+   * MSER(d) = \Sum_{j>=d}(Z_j - \Bar{Z}_d)^2 / (k - d)^2 is minimized over
+   * d in [0, k/2].
+   *
+   * @return size_t The number of batches to truncate
+   */
+  size_t findTruncation() const;
+
+  // the number of observations per batch (grows as batches are merged)
+  long batchSize;
+
+  // the capacity of the batch-mean buffer
+  size_t maxBatches;
+
+  // the means of the completed batches
+  std::vector<double> batchMeans;
+
+  // the index of the first job of each completed batch
+  std::vector<long long> batchJobs;
+
+  // the running sum and count of the batch being filled
+  double partialSum;
+  long partialCount;
+  long long partialJob;
+
+  // the number of batches at which MSER will next be evaluated
+  size_t nextCheck;
+
+  // the number of observations seen
+  long long numObs;
+
+  // the detected truncation point (-1 until detected)
+  long long truncObs;
+  long long truncJob;
+};
+
+#endif
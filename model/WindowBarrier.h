@@ -0,0 +1,42 @@
+#ifndef WINDOW_BARRIER_H
+#define WINDOW_BARRIER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+// Where the threads of a windowed run meet: each wait() returns once all
+// 'count' threads have called it. Reusable from one window to the next.
+class WindowBarrier {
+ public:
+  /**
+   * @brief Construct a new Window Barrier object
+   *
+   * @param count The threads that meet at it
+   */
+  explicit WindowBarrier(int count) : count{count}, waiting{0}, generation{0} {}
+
+  /**
+   * @brief Wait for the other threads
+   */
+  void wait() {
+    std::unique_lock<std::mutex> lock{mutex};
+    uint64_t arrived{generation};
+    if (++waiting == count) {
+      waiting = 0;
+      ++generation;
+      cond.notify_all();
+      return;
+    }
+    cond.wait(lock, [&] { return generation != arrived; });
+  }
+
+ private:
+  std::mutex mutex;
+  std::condition_variable cond;
+  int count;
+  int waiting;
+  uint64_t generation;  // the meetings so far
+};
+
+#endif
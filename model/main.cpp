@@ -1,30 +1,33 @@
+#include <unistd.h>
+
+#include <algorithm>
 #include <cstdlib>
 #include <fstream>
 #include <functional>
 #include <iomanip>
 #include <iostream>
-#include <queue>
+#include <memory>
+#include <string>
 #include <vector>
 
+#include "Batch.h"
+#include "Branch.h"
+#include "Checkpoint.h"
+#include "Fleet.h"
 #include "Job.h"
+#include "Lifecycle.h"
+#include "MultiDispatch.h"
 #include "LoadBalancing.h"
 #include "Node.h"
+#include "Partition.h"
+#include "PerfCounters.h"
+#include "ResultWriter.h"
+#include "Selection.h"
+#include "Simulation.h"
 #include "rngs.h"
 #include "rvgs.h"
 
-// Type definition aliases
-typedef int node_idx;
-typedef std::function<node_idx(std::vector<ServiceNode>, double)> lba_func;
-typedef std::vector<ServiceNode> node_list;
-typedef int lba_alg;
-
 // GLOBAL VARIABLES
-const int DAY_SEC{24 * 60 * 60};   // seconds in a day
-const int NOON_TIME{DAY_SEC / 2};  // time of day for noon
-const int HOUR_SEC{DAY_SEC / 24};
-const double START{0.0};                 // start time for the simulation
-const double END{(double)DAY_SEC * 30};  // end time for the simulation
-enum class Model { mqms, sqms };         // model enums
 std::string alg{""};
 
 // NOTE: surely there must be a better way to deal with the below
@@ -34,19 +37,10 @@ const struct algs_t {
   const lba_alg util{2};
   const lba_alg cxns{3};
 } Algs;
-// this is a list that should be able to be indexed using the enumerator
-const std::vector<lba_func> LBA_FUNCTIONS = {
-    lba::roundrobin, lba::random, lba::utilizationbased, lba::leastconnections};
-const std::vector<std::string> LBA_NAMES = {"roundrobin", "random", "utilbased",
-                                            "leastcxns"};
-// =========================== END GLOBAL VARIABLES ============================
 
-lba_alg name_to_index(std::string name) {
-  for (size_t ii = 0; ii < LBA_NAMES.size(); ii++) {
-    if (name == LBA_NAMES[ii]) return ii;
-  }
-  return -1;
-}
+// the name used in place of an algorithm to rank all of them
+const std::string SELECT_NAME{"select"};
+// =========================== END GLOBAL VARIABLES ============================
 
 // tests a load balancing algorithm with 'nodes', 'num_iter' times
 void test_lba(std::function<int(std::vector<ServiceNode>)> lba,
@@ -58,28 +52,267 @@ void test_lba(std::function<int(std::vector<ServiceNode>)> lba,
 }
 
 // Function declarations
-double getArrival();
-node_list buildNodeList(int nNodes, size_t qSz);
-node_idx dispatcher(node_list nodes, lba_func lba);
-void log_sim(lba_func lba, int nNodes, int qSize, int nJobs, node_list nodes);
-
-/* TO-DO:
- * Implement the function declartions below this list....
- */
-void sqmsSimulation(int nNodes, lba_alg lba, size_t qSize, int nJobs);
-void mqmsSimulation(int nNodes, lba_alg lba, size_t qSize, int nJobs);
-void accumStats(node_list nodes, int nJobs, Model modelName,
-                std::string funcName);
 void serverDistribution(int nNodes, int nJobs);
-void log_sim(std::string alg, int nNodes, int qSize, int nJobs,
-             node_list nodes);
-void printStats(node_list nodes, int totalRejects, int nJobs);
 
 int main(int argc, char* argv[]) {
+  // the defaults of the ranking-and-selection mode
+  SelectionConfig select;
+  select.model = Model::mqms;
+  select.metric = SelectMetric::delay;
+  select.pcs = 0.95;
+  select.delta = 0.0;
+  select.n0 = 10;
+  select.maxReps = 256;
+  bool metricGiven{false};
+
+  // split the flags from the positional arguments
+  std::vector<char*> args;
+  SimOptions opts;
+  std::string batchFile;
+  BatchWorkers workers;
+  std::string eventFile;
+  std::string telemetryName;
+  std::string checkpointFile;
+  double checkpointEvery{600.0};
+  std::string resumeFile;
+  std::string branchFile;
+  long long warmJobs{-1};
+  int maxParallel{static_cast<int>(sysconf(_SC_NPROCESSORS_ONLN))};
+  bool isFleet{false};
+  double load{0.0};
+  bool isLifecycle{false};
+  LifecycleOptions lifecycle;
+  PartitionConfig partition;
+  bool isPartitioned{false};
+  DispatchConfig dispatch;
+  bool isDispatching{false};
+  std::string commandLine;  // kept in the event log's header
+  for (int ii = 0; ii < argc; ii++) {
+    commandLine += (ii > 0 ? " " : "") + std::string(argv[ii]);
+  }
+  for (int ii = 0; ii < argc; ii++) {
+    std::string arg{argv[ii]};
+    bool hasValue{ii + 1 < argc};
+    if (arg == "--warmup") {
+      opts.detectWarmup = true;
+    } else if (arg == "--pipeline") {
+      opts.pipelined = true;
+    } else if (arg == "--fleet") {
+      isFleet = true;
+    } else if (arg == "--load" && hasValue) {
+      load = atof(argv[++ii]);
+    } else if (arg == "--lifecycle") {
+      isLifecycle = true;
+    } else if (arg == "--retries" && hasValue) {
+      lifecycle.maxRetries = std::max(atoi(argv[++ii]), 0);
+    } else if (arg == "--backoff" && hasValue) {
+      lifecycle.backoff = atof(argv[++ii]);
+    } else if (arg == "--ckpt-interval" && hasValue) {
+      lifecycle.ckptInterval = atof(argv[++ii]);
+    } else if (arg == "--ckpt-cost" && hasValue) {
+      lifecycle.ckptCost = atof(argv[++ii]);
+    } else if (arg == "--partitions" && hasValue) {
+      partition.partitions = atoi(argv[++ii]);
+      isPartitioned = true;
+    } else if (arg == "--threads" && hasValue) {
+      partition.threads = atoi(argv[++ii]);
+      dispatch.threads = partition.threads;
+    } else if (arg == "--dispatchers" && hasValue) {
+      dispatch.dispatchers = atoi(argv[++ii]);
+      isDispatching = true;
+    } else if (arg == "--sync-dt" && hasValue) {
+      dispatch.syncDt = atof(argv[++ii]);
+    } else if (arg == "--npz") {
+      opts.npz = true;
+    } else if (arg == "--perf") {
+      std::string error;
+      if (!enablePerf(error)) std::cerr << "--perf: " << error << std::endl;
+    } else if (arg == "--event-log" && hasValue) {
+      eventFile = argv[++ii];
+    } else if (arg == "--telemetry" && hasValue) {
+      telemetryName = argv[++ii];
+    } else if (arg == "--checkpoint" && hasValue) {
+      checkpointFile = argv[++ii];
+    } else if (arg == "--checkpoint-every" && hasValue) {
+      checkpointEvery = atof(argv[++ii]);
+    } else if (arg == "--resume" && hasValue) {
+      resumeFile = argv[++ii];
+    } else if (arg == "--branches" && hasValue) {
+      branchFile = argv[++ii];
+    } else if (arg == "--warm-jobs" && hasValue) {
+      warmJobs = atoll(argv[++ii]);
+    } else if (arg == "--parallel" && hasValue) {
+      maxParallel = atoi(argv[++ii]);
+    } else if (arg == "--event-rate" && hasValue) {
+      opts.eventRate = atof(argv[++ii]);
+    } else if (arg == "--sample-dt" && hasValue) {
+      opts.sampleDt = atof(argv[++ii]);
+    } else if (arg == "--sample-rollup" && hasValue) {
+      opts.sampleRollup = atoi(argv[++ii]);
+    } else if (arg == "--sample-metrics" && hasValue) {
+      if (!parseMetrics(argv[++ii], opts.sampleMetrics)) {
+        std::cerr << "Unknown sample metric in " << argv[ii]
+                  << " (use queue, busy, util)" << std::endl;
+        return 1;
+      }
+    } else if (arg == "--cache" && hasValue) {
+      opts.cacheDir = argv[++ii];
+    } else if (arg == "--batch" && hasValue) {
+      batchFile = argv[++ii];
+    } else if (arg == "--workers" && hasValue) {
+      workers.count = std::max(atoi(argv[++ii]), 1);
+    } else if (arg == "--no-pin") {
+      workers.pin = false;
+    } else if (arg == "--huge-pages") {
+      workers.hugePages = true;
+    } else if (arg == "--pcs" && hasValue) {
+      select.pcs = atof(argv[++ii]);
+    } else if (arg == "--delta" && hasValue) {
+      select.delta = atof(argv[++ii]);
+    } else if (arg == "--n0" && hasValue) {
+      select.n0 = atoi(argv[++ii]);
+    } else if (arg == "--max-reps" && hasValue) {
+      select.maxReps = atoi(argv[++ii]);
+    } else if (arg == "--model" && hasValue) {
+      select.model = std::string(argv[++ii]) == "sqms" ? Model::sqms
+                                                        : Model::mqms;
+    } else if (arg == "--metric" && hasValue) {
+      select.metric = std::string(argv[++ii]) == "rejects"
+                          ? SelectMetric::rejects
+                          : SelectMetric::delay;
+      metricGiven = true;
+    } else {
+      args.push_back(argv[ii]);
+    }
+  }
+  argc = args.size();
+  argv = args.data();
+
+  // only the loops of a single run can be saved and resumed
+  bool isCheckpointing{!checkpointFile.empty() || !resumeFile.empty()};
+  if (isCheckpointing &&
+      (!batchFile.empty() || (argc > 2 && argv[2] == SELECT_NAME) ||
+       opts.pipelined || opts.sampleDt > 0.0 || !eventFile.empty())) {
+    std::cerr << "--checkpoint and --resume only apply to a single run "
+              << "without --pipeline, --sample-dt or --event-log" << std::endl;
+    return 1;
+  }
+
+  // the branches are forked processes, which can't share these
+  if (!branchFile.empty() &&
+      (!batchFile.empty() || (argc > 2 && argv[2] == SELECT_NAME) ||
+       isCheckpointing || opts.pipelined || opts.sampleDt > 0.0 ||
+       !eventFile.empty() || !telemetryName.empty() || opts.npz)) {
+    std::cerr << "--branches only applies to a single run without "
+              << "--checkpoint, --resume, --pipeline, --sample-dt, "
+              << "--event-log, --telemetry or --npz" << std::endl;
+    return 1;
+  }
+
+  // the fleet mode keeps aggregates only, which none of these work with
+  if (isFleet &&
+      (!batchFile.empty() || (argc > 2 && argv[2] == SELECT_NAME) ||
+       isCheckpointing || !branchFile.empty() || opts.detectWarmup ||
+       !opts.cacheDir.empty() || opts.pipelined || opts.npz ||
+       opts.sampleDt > 0.0 || !eventFile.empty() || !telemetryName.empty())) {
+    std::cerr << "--fleet only applies to a single run without --warmup, "
+              << "--cache, --pipeline, --npz, --sample-dt, --event-log, "
+              << "--telemetry, --checkpoint, --resume or --branches"
+              << std::endl;
+    return 1;
+  }
+
+  // the lifecycle model runs on its own calendar, with its own statistics
+  if (isLifecycle &&
+      (isFleet || !batchFile.empty() || (argc > 2 && argv[2] == SELECT_NAME) ||
+       isCheckpointing || !branchFile.empty() || opts.detectWarmup ||
+       !opts.cacheDir.empty() || opts.pipelined || opts.npz ||
+       opts.sampleDt > 0.0 || !eventFile.empty() || !telemetryName.empty())) {
+    std::cerr << "--lifecycle only applies to a single run without --fleet, "
+              << "--warmup, --cache, --pipeline, --npz, --sample-dt, "
+              << "--event-log, --telemetry, --checkpoint, --resume or "
+              << "--branches" << std::endl;
+    return 1;
+  }
+
+  // the partitions run the multi-queue model's loop on their own threads
+  if (isPartitioned &&
+      (isFleet || isLifecycle || !batchFile.empty() ||
+       (argc > 2 && argv[2] == SELECT_NAME) || isCheckpointing ||
+       !branchFile.empty() || opts.detectWarmup || !opts.cacheDir.empty() ||
+       opts.pipelined || opts.npz || opts.sampleDt > 0.0 ||
+       !eventFile.empty() || !telemetryName.empty())) {
+    std::cerr << "--partitions only applies to a single run without "
+              << "--fleet, --lifecycle, --warmup, --cache, --pipeline, "
+              << "--npz, --sample-dt, --event-log, --telemetry, "
+              << "--checkpoint, --resume or --branches" << std::endl;
+    return 1;
+  }
+
+  // the dispatchers run the multi-queue model's loop on their own threads
+  if (isDispatching &&
+      (isFleet || isLifecycle || isPartitioned || !batchFile.empty() ||
+       (argc > 2 && argv[2] == SELECT_NAME) || isCheckpointing ||
+       !branchFile.empty() || opts.detectWarmup || !opts.cacheDir.empty() ||
+       opts.pipelined || opts.npz || opts.sampleDt > 0.0 ||
+       !eventFile.empty() || !telemetryName.empty())) {
+    std::cerr << "--dispatchers only applies to a single run without "
+              << "--fleet, --lifecycle, --partitions, --warmup, --cache, "
+              << "--pipeline, --npz, --sample-dt, --event-log, --telemetry, "
+              << "--checkpoint, --resume or --branches" << std::endl;
+    return 1;
+  }
+  if (load > 0.0 && !isFleet && !isPartitioned && !isDispatching) {
+    std::cerr << "--load only applies to --fleet, --partitions and "
+              << "--dispatchers" << std::endl;
+    return 1;
+  }
+
+  // run the scenarios of a file ('-' for stdin) instead
+  if (!batchFile.empty()) {
+    if (batchFile == "-") {
+      return runBatch(std::cin, std::cout, opts, workers) > 0;
+    }
+
+    std::ifstream scenarios(batchFile);
+    if (!scenarios) {
+      std::cerr << "Could not open the scenario file " << batchFile
+                << std::endl;
+      return 1;
+    }
+    return runBatch(scenarios, std::cout, opts, workers) > 0;
+  }
+
   // get command line arguments
   if (argc < 5) {
     std::cout << "Usage: " << argv[0] << " ";
-    std::cout << "<nNodes> <lba_alg> <qSize> <nJobs> <seed>" << std::endl;
+    std::cout << "<nNodes> <lba_alg> <qSize> <nJobs> <seed> [--warmup] "
+              << "[--cache dir] [--pipeline] [--npz] [--sample-dt sec] "
+              << "[--sample-metrics queue,busy,util] [--sample-rollup k] "
+              << "[--event-log file] [--event-rate r] [--perf] "
+              << "[--telemetry name] [--checkpoint file] "
+              << "[--checkpoint-every sec] [--resume file] "
+              << "[--branches <file|->] [--warm-jobs n] [--parallel k]"
+              << std::endl;
+    std::cout << "       " << argv[0] << " <nNodes> <lba_alg> <qSize> "
+              << "<nJobs> <seed> --fleet [--load rho] [--perf]" << std::endl;
+    std::cout << "       " << argv[0] << " <nNodes> <lba_alg> <qSize> "
+              << "<nJobs> <seed> --lifecycle [--retries n] [--backoff sec] "
+              << "[--ckpt-interval sec] [--ckpt-cost sec] [--perf]"
+              << std::endl;
+    std::cout << "       " << argv[0] << " <nNodes> <lba_alg> <qSize> "
+              << "<nJobs> <seed> --partitions p [--threads k] [--load rho] "
+              << "[--perf]" << std::endl;
+    std::cout << "       " << argv[0] << " <nNodes> <lba_alg> <qSize> "
+              << "<nJobs> <seed> --dispatchers k [--sync-dt sec] "
+              << "[--threads k] [--load rho] [--perf]" << std::endl;
+    std::cout << "       " << argv[0] << " --batch <file|-> [--warmup] "
+              << "[--cache dir] [--pipeline] [--perf] [--workers k] "
+              << "[--no-pin] [--huge-pages]" << std::endl;
+    std::cout << "       " << argv[0] << " ";
+    std::cout << "<nNodes> " << SELECT_NAME << " <qSize> <nJobs> <seed> "
+              << "[--pcs p] [--delta d] [--n0 n] [--max-reps n] "
+              << "[--model mqms|sqms] [--metric delay|rejects]" << std::endl;
     return 1;
   }
 
@@ -88,225 +321,221 @@ int main(int argc, char* argv[]) {
   // set the seed (check that seed was given)
   long int seed{argc < 6 ? 123456789 : atol(argv[5])};
 
+  int qSize{atoi(argv[3])};
+  long long nJobs{atoll(argv[4])};
+
+  // rank all algorithms instead of running a single one
+  if (argv[2] == SELECT_NAME) {
+    // outside (1/k, 1) the procedure guarantees nothing (at 1 it never
+    // eliminates a policy)
+    double pcsMin{1.0 / LBA_NAMES.size()};
+    if (!(select.pcs > pcsMin && select.pcs < 1.0)) {
+      std::cerr << "--pcs must be between " << pcsMin << " and 1, both "
+                << "excluded" << std::endl;
+      return 1;
+    }
+    select.nNodes = nNodes;
+    select.qSize = qSize;
+    select.nJobs = nJobs;
+    select.seed = seed;
+    select.opts = opts;
+    // the servers of the sqms model have no queue, so there is no delay
+    if (!metricGiven && select.model == Model::sqms) {
+      select.metric = SelectMetric::rejects;
+    }
+
+    std::cout << "Selecting the best algorithm with: " << nNodes << " Nodes, "
+              << qSize << " Queue length, " << nJobs << " Jobs, " << seed
+              << " Seed." << std::endl;
+    printSelection(select, selectBest(select));
+    return 0;
+  }
 
   // pick the user's LBA
   lba_alg lbaChoice{name_to_index(argv[2])};
-  if (lbaChoice < 0 || lbaChoice > (int)LBA_FUNCTIONS.size()) {
+  if (lbaChoice < 0 || lbaChoice > (int)LBA_NAMES.size()) {
     std::cerr << "Invalid load balancing algorithm: " << argv[2] << std::endl;
     std::cerr << "Possible choices are: ";
     for (auto choice : LBA_NAMES) std::cout << choice << " ";
-    std::cout << std::endl;
+    std::cout << SELECT_NAME << std::endl;
     return 1;
   }
-  int qSize{atoi(argv[3])};
-  int nJobs{atoi(argv[4])};
   std::cout << "Running simulation with: " << nNodes << " Nodes, " << argv[2]
             << " Algorithm, " << qSize << " Queue length, " << nJobs
             << " Jobs, " << seed << " Seed." << std::endl;
 
   PutSeed(seed);  // seed the RNG
 
-  // testing mqms simulation
-  std::cout << "-------------------------------------------------" << std::endl;
-  std::cout << "MQMS SIMULATION:" << std::endl;
-  mqmsSimulation(nNodes, lbaChoice, qSize, nJobs);
-  
-  // testing sqms simulation
-  std::cout << "-------------------------------------------------" << std::endl;
-  std::cout << "SQMS SIMULATION:" << std::endl;
-  sqmsSimulation(nNodes, lbaChoice, qSize, nJobs);
-}
-
-// get a service time for a job
-double getArrival() {
-  static double prevArr{START};     // the previous arrival time
-  double st{Uniform(0, HOUR_SEC)};  // choose an arrival time
-  prevArr += st;                    // update the the
-
-  return prevArr;
-}
-
-/**
- * @brief Build a list of service nodes
- *
- * @param nNodes The number of nodes to include in the model
- * @param qSz The queue size of the nodes
- * @return std::vector<ServiceNode>
- */
-node_list buildNodeList(int nNodes, size_t qSz) {
-  node_list tempList;
-
-  for (int id = 0; id < nNodes; id++) {
-    tempList.push_back(ServiceNode(id, qSz));
+  // a multi-queue run of a very large cluster, reported in aggregate
+  if (isFleet) {
+    if (nNodes < 1 || qSize < 0 || qSize > (int)FLEET_MAX_QUEUE ||
+        nJobs > FLEET_MAX_JOBS) {
+      std::cerr << "--fleet needs at least one node, a queue size of at "
+                << "most " << FLEET_MAX_QUEUE << " and at most "
+                << FLEET_MAX_JOBS << " jobs" << std::endl;
+      return 1;
+    }
+    std::cout << "-------------------------------------------------"
+              << std::endl;
+    std::cout << "FLEET SIMULATION:" << std::endl;
+    fleetSimulation(nNodes, lbaChoice, qSize, nJobs, load);
+    return 0;
   }
 
-  return tempList;
-}
-
-/**
- * @brief Pick a service node for the next job to go to
- *
- * dispatcher will choose a node's index to send a job to. However, this will
- * not ignore nodes with a full queue. (I.e., if a job is sent to a full node,
- * that job won't be able to run unless the dispatcher picks a node with space.)
- *
- * @param nodes A list of usable service nodes (that may have full queues)
- * @param lba The load-balancing algorithm to use to choose a node
- * @return int The index of the node to send a job to
- */
-int dispatcher(node_list nodes, lba_func alg, double currT) {
-  int nodeIdx{-1};              // -1 as no node will have this index
-  nodeIdx = alg(nodes, currT);  // pick a node using the LBA
-
-  return nodeIdx;
-}
-
-/**
- * @brief log information and utilization results of a simulation run
- *
- *  Call at end of mqmsSimulation and sqmsSimulation
- *
- *
- * @param lba The load-balancing algorithm to use to choose a node
- * @param nNodes The number of nodes to use in the simulation
- * @param qSize The number of jobs allowed in each server's queue
- * @param nJobs The number of jobs to "process" in the simulation
- * @param nodes node_list of nodes to get node utilizations.
- * @return void Writes/ appends to a csv file to log info and utilization
- * results
- */
-void log_sim(std::string alg, int nNodes, int qSize, int nJobs,
-             node_list nodes) {
-  // not sure if this will work, if not can just do if or case/switches to get
-  // name of alg std::string alg{std::to_string(lba)};
-  std::ofstream logfile;
-  logfile.open("simlog.csv", std::ios::app);
-  logfile << alg << "," << nJobs << "," << nNodes << "," << qSize;
-  for (int i = 0; i < nNodes; i++) {
-    logfile << "," << nodes[i].getUtil();
+  // the jobs as processes: retries, waits, service and checkpoints
+  if (isLifecycle) {
+    if (nNodes < 1 || qSize < 0 || lifecycle.backoff <= 0.0 ||
+        lifecycle.ckptInterval < 0.0 || lifecycle.ckptCost < 0.0) {
+      std::cerr << "--lifecycle needs at least one node, a queue size of at "
+                << "least 0, a positive backoff and checkpoint times of at "
+                << "least 0" << std::endl;
+      return 1;
+    }
+    std::cout << "-------------------------------------------------"
+              << std::endl;
+    std::cout << "LIFECYCLE SIMULATION:" << std::endl;
+    lifecycleSimulation(nNodes, lbaChoice, qSize, nJobs, lifecycle);
+    return 0;
   }
-  logfile << ",\n";
-  logfile.close();
-}
-
-/**
- * @brief Run a multi-queue, multi-server simulation
- *
- * The simulation will generate it's own list of nodes and use the LBA to send
- * nJobs to the nodes in the model.
- *
- * @param nNodes The number of nodes to use in the simulation
- * @param qSize The number of jobs allowed in each server's queue
- * @param lba The node balancing
- * @param nJobs The number of jobs to "process" in the simulation
- */
-void mqmsSimulation(int nNodes, lba_alg lba, size_t qSize, int nJobs) {
-  // select the algorithm besing used
-  lba_func alg{LBA_FUNCTIONS[lba]};
-  std::string funcName{LBA_NAMES[lba]};
-
-  // build node list
-  node_list nodes{buildNodeList(nNodes, qSize)};
-
-  // track the total number of rejections
-  int totalRejects{0};
-
-  // run for the number of jobs
-  for (int ii = 0; ii < nJobs; ii++) {
-    // get the next jobs arrival
-    Job job{getArrival()};
-
-    // determine receiving server based on lba
-    int receiver{dispatcher(nodes, alg, job.getArrival())};
-    // std::cout << "Node " << receiver << " selected for job" << std::endl;
-
-    // attempt to enter the job into the node
-    if (nodes[receiver].enterNode(job)) {
-      // node added successfully
-      // std::cout << "Job successfully added" << std::endl;
-    } else {
-      // node unable to be added, this is where different rejection
-      // techiniques could be used
-      // std::cout << "Job unsuccessfully added" << std::endl;
 
-      ++totalRejects;
+  // the multi-queue model with each partition of the nodes on a thread
+  if (isPartitioned) {
+    if (nNodes < 1 || qSize < 0 || partition.partitions < 1 ||
+        partition.threads < 1) {
+      std::cerr << "--partitions needs at least one node and partition, a "
+                << "queue size of at least 0 and at least one thread"
+                << std::endl;
+      return 1;
     }
+    if (partition.partitions > 1 && !isPartitionable(lbaChoice)) {
+      std::cerr << "--partitions over 1 needs roundrobin or random: the "
+                << "other policies pick from the state of every node"
+                << std::endl;
+      return 1;
+    }
+    if (load > 0.0) setArrivalRate(loadToRate(nNodes, load));
+    std::cout << "-------------------------------------------------"
+              << std::endl;
+    std::cout << "PARTITIONED MQMS SIMULATION:" << std::endl;
+    partitionedSimulation(nNodes, lbaChoice, qSize, nJobs, partition);
+    return 0;
   }
 
-  // get simulation results
-  printStats(nodes, totalRejects, nJobs);
-
-  // TODO: make this dependent on CLI flag
-  // also, need better way to get alg name
-  accumStats(nodes, nJobs, Model::mqms, funcName);
-  log_sim(funcName, nNodes, qSize, nJobs, nodes);
-}
-
-/**
- * @brief Run a single-queue, multi-server simulation
- *
- * The simulation will generate it's own list of nodes and use the LBA to send
- * nJobs to the nodes in the model.
- *
- * @param nNodes The number of nodes to use in the simulation
- * @param lba The node balancing
- * @param qSize The size of the dispatcher's queue
- * @param nJobs The number of jobs to "process" in the simulation
- */
-void sqmsSimulation(int nNodes, lba_alg lba, size_t qSize, int nJobs) {
-  // select the algorithm besing used
-  lba_func alg{LBA_FUNCTIONS[lba]};
-  std::string funcName{LBA_NAMES[lba]};
-
-  // build node list
-  node_list nodes{buildNodeList(nNodes, 0)};
-
-  // the total number of rejections
-  int totalRejects{0};
+  // the multi-queue model with several dispatchers, each on a thread
+  if (isDispatching) {
+    if (nNodes < 1 || qSize < 0 || dispatch.dispatchers < 1 ||
+        dispatch.syncDt <= 0.0 || dispatch.threads < 1) {
+      std::cerr << "--dispatchers needs at least one node and dispatcher, "
+                << "a queue size of at least 0, a positive --sync-dt and "
+                << "at least one thread" << std::endl;
+      return 1;
+    }
+    if (load > 0.0) setArrivalRate(loadToRate(nNodes, load));
+    std::cout << "-------------------------------------------------"
+              << std::endl;
+    std::cout << "MULTI-DISPATCHER MQMS SIMULATION:" << std::endl;
+    dispatchersSimulation(nNodes, lbaChoice, qSize, nJobs, dispatch);
+    return 0;
+  }
 
-  // the dispatcher's queue
-  std::queue<Job> jobQueue;
+  // warm up once, then fork the what-if branches from there
+  if (!branchFile.empty()) {
+    std::vector<BranchSpec> specs;
+    std::ifstream file;
+    if (branchFile != "-") file.open(branchFile);
+    if (branchFile != "-" && !file) {
+      std::cerr << "Could not open the branch file " << branchFile
+                << std::endl;
+      return 1;
+    }
+    int errors{readBranches(branchFile == "-" ? std::cin : file, specs)};
+    if (specs.empty()) {
+      std::cerr << "No branches in " << branchFile << std::endl;
+      return 1;
+    }
 
-  // run for the number of jobs
-  for (int ii = 0; ii < nJobs; ii++) {
-    Job job{getArrival()};  // get a job's arrival time
+    // by default the first fifth of the jobs warms the cluster up
+    if (warmJobs < 0) warmJobs = nJobs / 5;
+    if (warmJobs >= nJobs) {
+      std::cerr << "--warm-jobs must be less than nJobs" << std::endl;
+      return 1;
+    }
+    runBranches(nNodes, lbaChoice, qSize, nJobs, specs, warmJobs, maxParallel,
+                opts);
+    return errors > 0;
+  }
 
-    // check to make sure the job can be queued
-    if (jobQueue.size() < qSize) {
-      jobQueue.push(job);  // the job is able to enter the queue.
-    } else {
-      ++totalRejects;
+  // log the jobs of both runs to one file
+  std::unique_ptr<EventLog> eventLog;
+  if (!eventFile.empty()) {
+    eventLog.reset(new EventLog(eventFile, LBA_NAMES[lbaChoice], commandLine));
+    if (!eventLog->isOk()) {
+      std::cerr << "Could not create the event log " << eventFile << std::endl;
+      return 1;
     }
+    opts.eventLog = eventLog.get();
+  }
 
-    // pick the service node to send the current job to
-    int receiver{dispatcher(nodes, alg, job.getArrival())};
+  // publish the progress for util/watch-telemetry.py
+  std::unique_ptr<Telemetry> telemetry;
+  if (!telemetryName.empty()) {
+    telemetry.reset(new Telemetry(telemetryName, nNodes));
+    if (!telemetry->isOk()) {
+      std::cerr << "Could not create the shared memory segment /"
+                << telemetryName << std::endl;
+      return 1;
+    }
+    opts.telemetry = telemetry.get();
+  }
 
-    // send the job to the selected node
-    if (nodes[receiver].enterNode(job)) {
-      jobQueue.pop();  // remove the job from the queue as it can be serviced
+  // save the runs as they go, and pick up where a previous process stopped
+  std::unique_ptr<Checkpointer> checkpoint;
+  if (isCheckpointing) {
+    checkpoint.reset(new Checkpointer(checkpointFile, checkpointEvery));
+    opts.checkpoint = checkpoint.get();
+  }
+  if (!resumeFile.empty()) {
+    std::string error;
+    if (!checkpoint->load(resumeFile, error)) {
+      std::cerr << "Could not resume: " << error << std::endl;
+      return 1;
+    }
+    const CheckpointKey& key{checkpoint->getResumeKey()};
+    if (key.lba != lbaChoice || key.nNodes != nNodes ||
+        key.qSize != static_cast<size_t>(qSize) || key.nJobs != nJobs ||
+        key.detectWarmup != opts.detectWarmup) {
+      std::cerr << "Could not resume: " << resumeFile << " is a checkpoint "
+                << "of a run with other settings" << std::endl;
+      return 1;
     }
+    // the cache is keyed on the state a run starts from, which a resumed
+    // process doesn't have for the runs it skips
+    opts.cacheDir.clear();
   }
 
-  // get simulation results
-  printStats(nodes, totalRejects, nJobs);
+  // testing mqms simulation
+  std::cout << "-------------------------------------------------" << std::endl;
+  std::cout << "MQMS SIMULATION:" << std::endl;
+  if (checkpoint && checkpoint->hasResume() &&
+      checkpoint->getResumeKey().model == Model::sqms) {
+    // its results were written before the checkpoint was taken
+    std::cout << "Finished before the checkpoint, skipped" << std::endl;
+  } else {
+    mqmsSimulation(nNodes, lbaChoice, qSize, nJobs, opts);
+  }
 
-  accumStats(nodes, nJobs, Model::sqms, funcName);
-  log_sim(funcName, nNodes, 0, nJobs, nodes);
-}
+  // testing sqms simulation
+  std::cout << "-------------------------------------------------" << std::endl;
+  std::cout << "SQMS SIMULATION:" << std::endl;
+  sqmsSimulation(nNodes, lbaChoice, qSize, nJobs, opts);
 
-void printStats(node_list nodes, int totalRejects, int nJobs) {
-  // calculate the fraction of rejected jobs
-  double rejectRatio{(static_cast<double>(totalRejects) / nJobs) * 100};
-
-  // print the reject amount
-  std::cout << std::setprecision(5) 
-            << "Rejection amount: " << rejectRatio  << "%" << std::endl;
-  
-  // print the node-wise data
-  for (ServiceNode node : nodes) {
-    std::cout << node << std::endl;
+  if (eventLog && !eventLog->close()) {
+    std::cerr << "Could not write the event log " << eventFile << std::endl;
+    return 1;
   }
 
+  // wait for the background writer to finish the result files
+  if (opts.npz && resultWriter().flush() > 0) return 1;
 }
 
 /**
@@ -319,13 +548,11 @@ void serverDistribution(int nNodes, int nJobs) {
   std::cout << "> Testing node choice distribution..." << std::endl;
   node_list nodes{buildNodeList(nNodes, 0)};  // queue size doesn't matter
 
-  // list of available load-balancing algorithms
-  std::vector<lba_func> funcs = {lba::roundrobin, lba::random,
-                                 lba::utilizationbased, lba::leastconnections};
-
   std::ofstream lba_dat("lba-data.csv");
 
-  for (lba_func alg : funcs) {
+  // each of the available load-balancing algorithms
+  for (size_t lba = 0; lba < LBA_NAMES.size(); lba++) {
+    lba_func alg{makePolicy(lba)};
     for (int i = 0; i < nJobs - 1; i++) {
       lba_dat << alg(nodes, 0 /*lbas depend on dynamic state*/) << ",";
     }
@@ -336,25 +563,3 @@ void serverDistribution(int nNodes, int nJobs) {
 
   std::cout << "> ... done" << std::endl;
 }
-
-void accumStats(node_list nodes, int nJobs, Model modelName,
-                std::string funcName) {
-  std::string model = (modelName == Model::mqms) ? "mqms" : "sqms";
-  std::ofstream data(model + "_" + funcName + ".csv");
-
-  // write the headers
-  data << "sid,avg_x,avg_s,avg_q,avg_d,n_jobs" << std::endl;
-
-  // will need to get n_jobs
-  int nodeId{0};
-  for (ServiceNode node : nodes) {
-    data << nodeId++ << ","                      // sid
-         << node.getUtil() << ","                // avg_x
-         << node.calcAvgSt() << ","              // avg_s
-         << node.calcAvgQueue() << ","           // avg_q
-         << node.calcAvgDelay() << ","           // avg_d
-         << node.getNumProcJobs() << std::endl;  // n_jobs
-  }
-
-  data.close();
-}
@@ -35,6 +35,7 @@
 #include <stdio.h>
 #include <time.h>
 #include "rngs.h"
+#include "Profile.h"
 
 #define MODULUS    2147483647 /* DON'T CHANGE THIS VALUE                  */
 #define MULTIPLIER 48271      /* DON'T CHANGE THIS VALUE                  */
@@ -43,9 +44,16 @@
 #define A256       22925      /* jump multiplier, DON'T CHANGE THIS VALUE */
 #define DEFAULT    123456789  /* initial seed, use 0 < DEFAULT < MODULUS  */
       
-static long seed[STREAMS] = {DEFAULT};  /* current state of each stream   */
-static int  stream        = 0;          /* stream index, 0 is the default */
-static int  initialized   = 0;          /* test for stream initialization */
+/* every thread has its own set of streams, so threads can draw in parallel */
+#if defined(__cplusplus)
+#define THREAD_LOCAL thread_local
+#else
+#define THREAD_LOCAL _Thread_local
+#endif
+
+static THREAD_LOCAL long seed[STREAMS] = {DEFAULT};  /* state of each stream */
+static THREAD_LOCAL int  stream        = 0;          /* stream index         */
+static THREAD_LOCAL int  initialized   = 0;          /* streams planted?     */
 
 
    double Random(void)
@@ -59,6 +67,7 @@ static int  initialized   = 0;          /* test for stream initialization */
   const long R = MODULUS % MULTIPLIER;
         long t;
 
+  PROF_SCOPE("Random");
   t = MULTIPLIER * (seed[stream] % Q) - R * (seed[stream] / Q);
   if (t > 0) 
     seed[stream] = t;
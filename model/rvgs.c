@@ -36,6 +36,7 @@
 #include <math.h>
 #include "rngs.h"
 #include "rvgs.h"
+#include "Profile.h"
 
 
    long Bernoulli(double p)
@@ -130,6 +131,7 @@
  * =========================================================
  */
 {
+  PROF_SCOPE("Exponential");
   return (-m * log(1.0 - Random()));
 }
 
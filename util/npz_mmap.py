@@ -0,0 +1,49 @@
+import os
+import zipfile
+
+import numpy as np
+
+
+def load_npz_mmap(path):
+  """Memory-map every column of a result archive written with --npz.
+
+  np.load() reads the members of an .npz into memory (it ignores mmap_mode
+  for archives). The simulation stores the members uncompressed, so each one
+  can be mapped straight from the file instead, without copying or parsing.
+  Returns a dict of read-only arrays, one per column.
+  """
+  columns = {}
+  with zipfile.ZipFile(path) as archive, open(path, 'rb') as f:
+    for info in archive.infolist():
+      if info.compress_type != zipfile.ZIP_STORED:
+        raise ValueError('{} is compressed, it cannot be mapped'.format(
+          info.filename))
+
+      # skip the member's local header to get to its .npy header
+      f.seek(info.header_offset)
+      local = f.read(30)
+      name_len = int.from_bytes(local[26:28], 'little')
+      extra_len = int.from_bytes(local[28:30], 'little')
+      f.seek(info.header_offset + 30 + name_len + extra_len)
+
+      version = np.lib.format.read_magic(f)
+      if version == (1, 0):
+        shape, fortran, dtype = np.lib.format.read_array_header_1_0(f)
+      else:
+        shape, fortran, dtype = np.lib.format.read_array_header_2_0(f)
+
+      name = os.path.splitext(info.filename)[0]
+      columns[name] = np.memmap(path, dtype=dtype, mode='r', offset=f.tell(),
+                                shape=shape, order='F' if fortran else 'C')
+  return columns
+
+
+def load_results(prefix):
+  """Load a result table by its name without the extension.
+
+  The .npz written with --npz is mapped if there is one, otherwise the CSV is
+  parsed. Either way the columns are looked up by name, e.g. data['avg_x'].
+  """
+  if os.path.exists(prefix + '.npz'):
+    return load_npz_mmap(prefix + '.npz')
+  return np.genfromtxt(prefix + '.csv', delimiter=',', names=True)
@@ -0,0 +1,38 @@
+import matplotlib.pyplot as plt
+import numpy as np
+
+# open the summaries written by analyze.out (analyze.out --out events ...)
+prefix = '../model/events'
+hours = np.genfromtxt(prefix + '_hours.csv', delimiter=',', names=True,
+  dtype=None, encoding='utf-8')
+timeline = np.genfromtxt(prefix + '_timeline.csv', delimiter=',', names=True,
+  dtype=None, encoding='utf-8')
+
+# one row of plots per model: the p99 delay by hour of the day, and the
+# share of rejected jobs over the whole run
+models = sorted(set(hours['model']))
+fig, axs = plt.subplots(len(models), 2, figsize=(16, 4.5 * len(models)),
+  squeeze=False)
+
+for row, model in enumerate(models):
+  for policy in sorted(set(hours['policy'])):
+    rows = hours[(hours['model'] == model) & (hours['policy'] == policy)]
+    axs[row, 0].plot(rows['hour'], rows['p99_d'], marker='.', label=policy)
+
+    rows = timeline[(timeline['model'] == model) &
+      (timeline['policy'] == policy)]
+    share = rows['n_rej'] / np.maximum(rows['n_jobs'], 1)
+    axs[row, 1].plot(rows['hour'], share, linewidth=0.75, label=policy)
+
+  axs[row, 0].set_title('{}: p99 delay by hour of the day'.format(model))
+  axs[row, 0].set_xlabel('hour of the day')
+  axs[row, 0].set_ylabel('time (s)')
+  axs[row, 1].set_title('{}: rejected jobs'.format(model))
+  axs[row, 1].set_xlabel('hour')
+  axs[row, 1].set_ylabel('share of the jobs')
+  axs[row, 0].legend()
+plt.tight_layout()
+
+
+# save the figure
+plt.savefig("events.png", dpi=300)
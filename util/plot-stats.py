@@ -2,17 +2,20 @@ import matplotlib.pyplot as plt
 import matplotlib.figure as fig
 import numpy as np
 
-# open the data
-dist_data = np.genfromtxt('../model/mqms_random.csv', delimiter=',')
-print(dist_data.shape)
+from npz_mmap import load_results
+
+# open the data (mqms_random.npz if the simulation ran with --npz)
+dist_data = load_results('../model/mqms_random')
+columns = ['avg_x', 'avg_s', 'n_jobs']
+print(len(dist_data['sid']))
 
 # set up the plot's axes
 w, h = fig.figaspect(1/3)
 fig, axs = plt.subplots(1, 3, figsize=(w, h))
 titles = [ # the titles for the subplots
-  'Utilization mean={:.2f}, sd={:.2f}'.format(np.mean(dist_data[1:, 1]), np.std(dist_data[1:, 1])),
-  'Service Time (s) mean={:.2f}, sd={:.2f}'.format(np.mean(dist_data[1:, 2]), np.std(dist_data[1:, 2])),
-  'Number of Jobs mean={:.2f}, sd={:.2f}'.format(np.mean(dist_data[1:, 3]), np.std(dist_data[1:, 3]))
+  'Utilization mean={:.2f}, sd={:.2f}'.format(np.mean(dist_data['avg_x']), np.std(dist_data['avg_x'])),
+  'Service Time (s) mean={:.2f}, sd={:.2f}'.format(np.mean(dist_data['avg_s']), np.std(dist_data['avg_s'])),
+  'Number of Jobs mean={:.2f}, sd={:.2f}'.format(np.mean(dist_data['n_jobs']), np.std(dist_data['n_jobs']))
 ]
 ylabels = [
   'utilization (%)',
@@ -28,13 +31,13 @@ for i, ax in enumerate(axs.flat):
 
   # plot the histogram
   # ax.scatter(dist_data[1:,0], dist_data[1:,i+1], c='k', marker='o', s=1)
-  ax.stem(dist_data[1:,0], dist_data[1:,i+1], linefmt='k-', markerfmt='k.', \
+  ax.stem(dist_data['sid'], dist_data[columns[i]], linefmt='k-', markerfmt='k.', \
     basefmt=' ', bottom=0)
   ax.set_title(titles[i])
   ax.set_ylabel(ylabels[i])
   ax.set_xlabel('Server ID')
-  ax.set_xticks(dist_data[1:,0])
-  maxVal = np.max(dist_data[1:,i+1])
+  ax.set_xticks(dist_data['sid'])
+  maxVal = np.max(dist_data[columns[i]])
   maxVal += maxVal * 0.05
   ax.set_ylim([0, maxVal])
   # plt.setp(markerline, markersize = 3)
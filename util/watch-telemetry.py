@@ -0,0 +1,89 @@
+import mmap
+import os
+import struct
+import sys
+import time
+
+# the layout of model/Telemetry.h
+HEADER = struct.Struct('<8sIIQIIIIqqqddd40s')
+NODE = struct.Struct('<dd')
+MODELS = ['mqms', 'sqms']
+STATES = ['waiting', 'running', 'done']
+
+
+def read_snapshot(segment):
+  """Copy a consistent snapshot of the segment (the seqlock's read side).
+
+  Retries while the simulation is writing (seq is odd) or wrote in between
+  the two reads of seq. Returns the header's fields and the nodes' (queue,
+  utilization) pairs.
+  """
+  while True:
+    seq, = struct.unpack_from('<Q', segment, 16)
+    if seq % 2 == 1:
+      continue
+    data = segment[:]
+    if struct.unpack_from('<Q', segment, 16)[0] == seq:
+      break
+
+  fields = HEADER.unpack_from(data)
+  header = dict(zip(['magic', 'version', 'max_nodes', 'seq', 'state',
+    'model', 'n_nodes', 'dispatch_queue', 'jobs', 'total_jobs', 'rejects',
+    'sim_time', 'events_per_sec', 'wall_time', 'label'], fields))
+  header['label'] = header['label'].rstrip(b'\0').decode()
+  nodes = [NODE.unpack_from(data, HEADER.size + ii * NODE.size)
+    for ii in range(min(header['n_nodes'], header['max_nodes']))]
+  return header, nodes
+
+
+def show(header, nodes):
+  total = max(header['total_jobs'], 1)
+  print('\033[2J\033[H', end='')  # clear the terminal
+  print('{} [{}]  {:.1f} s'.format(header['label'] or '-',
+    STATES[min(header['state'], 2)], header['wall_time']))
+  print('jobs {:,}/{:,} ({:.1%})  rejected {:,}  {:,.0f} jobs/s'.format(
+    header['jobs'], header['total_jobs'], header['jobs'] / total,
+    header['rejects'], header['events_per_sec']))
+  print('simulated time {:,.0f} s ({:.1f} days)'.format(header['sim_time'],
+    header['sim_time'] / 86400))
+  if MODELS[header['model'] % 2] == 'sqms':
+    print('dispatcher queue {}'.format(header['dispatch_queue']))
+  print()
+  print('{:>5} {:>8} {:>6}  utilization'.format('node', 'queue', 'util'))
+  for sid, (queue, util) in enumerate(nodes):
+    bar = '#' * int(round(util * 40))
+    print('{:>5} {:>8.2f} {:>6.1%}  {}'.format(sid, queue, util, bar))
+
+
+def main():
+  if len(sys.argv) < 2:
+    print('Usage: {} <name> [interval]'.format(sys.argv[0]))
+    print('  attaches to a run started with main.out ... --telemetry <name>')
+    return 1
+  path = '/dev/shm/' + sys.argv[1]
+  interval = float(sys.argv[2]) if len(sys.argv) > 2 else 0.5
+
+  # wait for the run to create the segment
+  while not os.path.exists(path):
+    time.sleep(interval)
+
+  with open(path, 'rb') as f:
+    segment = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+  if segment[:7] != b'LBTELEM':
+    print('{} is not a telemetry segment'.format(path))
+    return 1
+
+  try:
+    while True:
+      header, nodes = read_snapshot(segment)
+      show(header, nodes)
+      if header['state'] == 2 or not os.path.exists(path):
+        break
+      time.sleep(interval)
+  except KeyboardInterrupt:
+    pass
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main())